@@ -0,0 +1,104 @@
+/* bufstat - report the use of the buffers of inet
+ *
+ * Usage: bufstat
+ *
+ * Bufstat asks inet for its "bf_stat" parameter and prints for each buffer
+ * pool how large the buffers are, how many there are, how many are in use,
+ * the most that were ever in use at once, and how many times one was
+ * allocated.  It then shows how often inet ran out of buffers and had to ask
+ * TCP, IP, and ARP to free some, at each priority, and how much they freed.
+ * Rounds at priority 7 or higher throw away data of TCP connections.  Use
+ * the 'buffers' statement in inet.conf to give inet more buffers.
+ */
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/svrctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/netlib.h>
+#include <net/gen/buf_stat.h>
+
+_PROTOTYPE(int main, (int argc, char **argv));
+_PROTOTYPE(int hexval, (int c));
+_PROTOTYPE(void usage, (void));
+
+char *pool_name[BF_POOL_NR] = { "512", "2K", "32K", "rx", "acc" };
+
+int main(argc, argv)
+int argc;
+char **argv;
+{
+  static bf_stat_t st;
+  static char param[] = "bf_stat";
+  static char value[2 * sizeof(st) + 1];
+  struct svrqueryparam qpar;
+  bf_pool_stat_t *bps;
+  unsigned char *bp;
+  char *ip_device, *vp;
+  int fd, i;
+
+  if (argc != 1) usage();
+
+  if ((ip_device = getenv("IP_DEVICE")) == NULL) ip_device = IP_DEVICE;
+  if ((fd = open(ip_device, O_RDWR)) < 0) {
+	fprintf(stderr, "bufstat: %s: %s\n", ip_device, strerror(errno));
+	exit(1);
+  }
+  qpar.param = param;
+  qpar.psize = sizeof(param) - 1;
+  qpar.value = value;
+  qpar.vsize = sizeof(value);
+  if (ioctl(fd, NWIOQUERYPARAM, &qpar) < 0) {
+	fprintf(stderr, "bufstat: %s: %s\n", ip_device, strerror(errno));
+	exit(1);
+  }
+  close(fd);
+
+  /* Inet returns the bytes of the variable in hex. */
+  vp = value;
+  for (bp = (unsigned char *) &st; bp < (unsigned char *) (&st + 1); bp++) {
+	if (hexval(vp[0]) < 0 || hexval(vp[1]) < 0) {
+		fprintf(stderr, "bufstat: inet does not know bf_stat\n");
+		exit(1);
+	}
+	*bp = hexval(vp[0]) << 4 | hexval(vp[1]);
+	vp += 2;
+  }
+
+  printf("pool    size     nr  inuse  hiwat     allocs\n");
+  for (i = 0; i < BF_POOL_NR; i++) {
+	bps = &st.bfs_pool[i];
+	if (bps->bps_nr == 0) continue;
+	printf("%-4s %7lu %6lu %6lu %6lu %10lu\n", pool_name[i],
+		(unsigned long) bps->bps_size, (unsigned long) bps->bps_nr,
+		(unsigned long) bps->bps_inuse, (unsigned long) bps->bps_hiwat,
+		(unsigned long) bps->bps_allocs);
+  }
+  printf("\nout of buffers %lu, out of accessors %lu, no receive buffer %lu\n",
+	(unsigned long) st.bfs_memfail, (unsigned long) st.bfs_accfail,
+	(unsigned long) st.bfs_rxfail);
+  printf("freed %lu bytes, rounds by priority:", (unsigned long) st.bfs_freed);
+  for (i = 0; i < BF_PRI_NR; i++)
+	printf(" %lu", (unsigned long) st.bfs_freereq[i]);
+  printf("\n");
+  return(0);
+}
+
+int hexval(c)
+int c;
+{
+  if (c >= '0' && c <= '9') return(c - '0');
+  if (c >= 'A' && c <= 'F') return(c - 'A' + 10);
+  return(-1);
+}
+
+void usage()
+{
+  fprintf(stderr, "Usage: bufstat\n");
+  exit(1);
+}
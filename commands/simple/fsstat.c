@@ -0,0 +1,124 @@
+/* fsstat - report file system statistics
+ *
+ * Usage: fsstat [interval [count]]
+ *
+ * Fsstat fetches the statistics block of FS and prints one line with what
+ * happened since FS started.  With an interval in seconds it prints another
+ * line every interval with what happened during it, 'count' times or until
+ * interrupted, like vmstat does.  The columns are:
+ *
+ *	reqs	requests handled by FS
+ *	kc/req	average time per request in units of 1024 CPU cycles
+ *	meta%	cache hit rate of inode, directory, indirect and map blocks
+ *	data%	cache hit rate of data blocks
+ *	miss	blocks that were not in the cache
+ *	ra	blocks read ahead
+ *	used%	fraction of those that were used afterwards
+ *	devict	dirty blocks that had to be written to reuse their buffer
+ *	scat	blocks written or read ahead in scattered I/O
+ *	blk/io	average number of those per device transfer
+ *	dirty	dirty buffers at the moment of sampling
+ */
+
+#include <sys/types.h>
+#include <minix/config.h>
+#include <minix/const.h>
+#include <minix/type.h>
+#include <minix/com.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+_PROTOTYPE(int main, (int argc, char **argv));
+_PROTOTYPE(void report, (struct fs_stats *new, struct fs_stats *old));
+_PROTOTYPE(unsigned percent, (unsigned long part, unsigned long total));
+_PROTOTYPE(void usage, (void));
+
+int main(argc, argv)
+int argc;
+char **argv;
+{
+  static struct fs_stats stats[2];
+  int interval = 0;
+  long count = -1;
+  int cur = 0;
+
+  if (argc > 3) usage();
+  if (argc > 1 && (interval = atoi(argv[1])) <= 0) usage();
+  if (argc > 2 && (count = atol(argv[2])) <= 0) usage();
+
+  printf("   reqs kc/req meta%% data%%   miss     ra used%% devict   scat blk/io dirty\n");
+  for (;;) {
+	if (getsysinfo(FS_PROC_NR, SI_FS_STATS, &stats[cur]) != 0) {
+		perror("fsstat: getsysinfo");
+		exit(1);
+	}
+	report(&stats[cur], &stats[!cur]);
+	fflush(stdout);
+
+	if (interval == 0 || (count > 0 && --count == 0)) break;
+	sleep(interval);
+	cur = !cur;
+  }
+  return(0);
+}
+
+void report(new, old)
+struct fs_stats *new;		/* the sample just taken */
+struct fs_stats *old;		/* the previous one, or all zeros */
+{
+/* Print the difference between two samples.  The counters wrap around, but
+ * unsigned subtraction still gives the right difference.
+ */
+  unsigned long meta_hits, meta_total, data_hits, data_total, misses;
+  unsigned long calls, ra, scat, xfers;
+  int t;
+
+  meta_hits = meta_total = data_hits = data_total = misses = 0;
+  for (t = 0; t < _NR_BLOCK_TYPES; t++) {
+	unsigned long hits = new->fss_hits[t] - old->fss_hits[t];
+	unsigned long miss = new->fss_misses[t] - old->fss_misses[t];
+
+	if (t <= 3) {		/* INODE_BLOCK up to MAP_BLOCK */
+		meta_hits += hits;
+		meta_total += hits + miss;
+	} else {
+		data_hits += hits;
+		data_total += hits + miss;
+	}
+	misses += miss;
+  }
+  calls = new->fss_calls - old->fss_calls;
+  ra = new->fss_ra_blocks - old->fss_ra_blocks;
+  scat = new->fss_scatter_blocks - old->fss_scatter_blocks;
+  xfers = new->fss_scatter_xfers - old->fss_scatter_xfers;
+
+  printf("%7lu %6lu %5u %5u %6lu %6lu %5u %6lu %6lu %6lu %5d\n",
+	calls,
+	calls == 0 ? 0L : (new->fss_call_kcycles - old->fss_call_kcycles) / calls,
+	percent(meta_hits, meta_total),
+	percent(data_hits, data_total),
+	misses,
+	ra,
+	percent(new->fss_ra_hits - old->fss_ra_hits, ra),
+	(unsigned long) (new->fss_dirty_evicts - old->fss_dirty_evicts),
+	scat,
+	xfers == 0 ? 0L : scat / xfers,
+	new->fss_dirty);
+}
+
+unsigned percent(part, total)
+unsigned long part;
+unsigned long total;
+{
+  if (total == 0) return(0);
+  if (part > total) part = total;	/* used read ahead from before */
+  if (total > 10000000L) return((unsigned) (part / (total / 100)));
+  return((unsigned) (part * 100 / total));
+}
+
+void usage()
+{
+  fprintf(stderr, "Usage: fsstat [interval [count]]\n");
+  exit(1);
+}
@@ -18,6 +18,10 @@
  * |------------|----------|---------|----------|---------|---------|
  * | DL_READV	| port nr  | proc nr | count    |         | address |
  * |------------|----------|---------|----------|---------|---------|
+ * | DL_WRITEVB	| port nr  | proc nr | count    | mode    | address |
+ * |------------|----------|---------|----------|---------|---------|
+ * | DL_READVB	| port nr  | proc nr | count    |         | address |
+ * |------------|----------|---------|----------|---------|---------|
  * | DL_INIT	| port nr  | proc nr | mode     |         | address |
  * |------------|----------|---------|----------|---------|---------|
  * | DL_GETSTAT	| port nr  | proc nr |          |         | address |
@@ -109,6 +113,8 @@ _PROTOTYPE( static void pci_conf, (void)				);
 _PROTOTYPE( static void do_vwrite, (message *mp, int from_int,
 							int vectored)	);
 _PROTOTYPE( static void do_vread, (message *mp, int vectored)		);
+_PROTOTYPE( static void do_vwriteb, (message *mp, int from_int)		);
+_PROTOTYPE( static void do_vreadb, (message *mp)			);
 _PROTOTYPE( static void do_init, (message *mp)				);
 _PROTOTYPE( static void do_int, (dpeth_t *dep)				);
 _PROTOTYPE( static void do_getstat, (message *mp)			);
@@ -121,6 +127,8 @@ _PROTOTYPE( static void dp_reset, (dpeth_t *dep)			);
 _PROTOTYPE( static void dp_check_ints, (dpeth_t *dep)			);
 _PROTOTYPE( static void dp_recv, (dpeth_t *dep)				);
 _PROTOTYPE( static void dp_send, (dpeth_t *dep)				);
+_PROTOTYPE( static void dp_sendq_put, (dpeth_t *dep, int size)		);
+_PROTOTYPE( static void dp_read_pack, (dpeth_t *dep, int pack)		);
 _PROTOTYPE( static void dp8390_stop, (void)				);
 _PROTOTYPE( static void dp_getblock, (dpeth_t *dep, int page,
 				size_t offset, size_t size, void *dst)	);
@@ -211,6 +219,8 @@ int main(int argc, char *argv[])
 		case DL_WRITEV:	do_vwrite(&m, FALSE, TRUE);	break;
 		case DL_READ:	do_vread(&m, FALSE);		break;
 		case DL_READV:	do_vread(&m, TRUE);		break;
+		case DL_WRITEVB: do_vwriteb(&m, FALSE);		break;
+		case DL_READVB:	do_vreadb(&m);			break;
 		case DL_INIT:	do_init(&m);			break;
 		case DL_GETSTAT: do_getstat(&m);		break;
 		case DL_GETNAME: do_getname(&m); 		break;
@@ -442,24 +452,7 @@ int vectored;
 	{
 		panic("", "dp8390: invalid packet size", size);
 	}
-	(dep->de_user2nicf)(dep, &dep->de_write_iovec, 0,
-		dep->de_sendq[sendq_head].sq_sendpage * DP_PAGESIZE,
-		size);
-	dep->de_sendq[sendq_head].sq_filled= TRUE;
-	if (dep->de_sendq_tail == sendq_head)
-	{
-		outb_reg0(dep, DP_TPSR, dep->de_sendq[sendq_head].sq_sendpage);
-		outb_reg0(dep, DP_TBCR1, size >> 8);
-		outb_reg0(dep, DP_TBCR0, size & 0xff);
-		outb_reg0(dep, DP_CR, CR_TXP | CR_EXTRA);/* there it goes.. */
-	}
-	else
-		dep->de_sendq[sendq_head].sq_size= size;
-	
-	if (++sendq_head == dep->de_sendq_nr)
-		sendq_head= 0;
-	assert(sendq_head < SENDQ_NR);
-	dep->de_sendq_head= sendq_head;
+	dp_sendq_put(dep, size);
 
 	dep->de_flags |= DEF_PACK_SEND;
 
@@ -542,6 +535,143 @@ int vectored;
 	reply(dep, OK, FALSE);
 }
 
+/*===========================================================================*
+ *				do_vwriteb				     *
+ *===========================================================================*/
+static void do_vwriteb(mp, from_int)
+message *mp;
+int from_int;
+{
+/* Send a batch of packets.  They go into the send queue as it empties; the
+ * reply with DL_PACK_SEND comes when the last one is in it.
+ */
+	int port, count, size;
+	dpeth_t *dep;
+	dl_pack_t *dlp;
+
+	port = mp->DL_PORT;
+	count = mp->DL_COUNT;
+	if (port < 0 || port >= DE_PORT_NR)
+		panic("", "dp8390: illegal port", port);
+	if (count <= 0 || count > DL_BATCH_MAX)
+		panic("", "dp8390: illegal batch size", count);
+	dep= &de_table[port];
+	dep->de_client= mp->DL_PROC;
+
+	if (dep->de_mode == DEM_SINK)
+	{
+		assert(!from_int);
+		dep->de_flags |= DEF_PACK_SEND;
+		reply(dep, OK, FALSE);
+		return;
+	}
+	assert(dep->de_mode == DEM_ENABLED);
+	assert(dep->de_flags & DEF_ENABLED);
+	if (dep->de_flags & DEF_SEND_AVAIL)
+		panic("", "dp8390: send already in progress", NO_NUM);
+
+	if (!from_int)
+	{
+		assert(!(dep->de_flags & DEF_PACK_SEND));
+		get_userdata(mp->DL_PROC, (vir_bytes) mp->DL_ADDR,
+			count * sizeof(dep->de_write_pack[0]),
+			dep->de_write_pack);
+		dep->de_write_packs= count;
+		dep->de_write_done= 0;
+	}
+
+	while (dep->de_write_done < dep->de_write_packs)
+	{
+		if (dep->de_sendq[dep->de_sendq_head].sq_filled)
+		{
+			/* Continue when the send queue has room again. */
+			if (!from_int)
+				dep->de_sendmsg= *mp;
+			dep->de_flags |= DEF_SEND_AVAIL;
+			if (!from_int)
+				reply(dep, OK, FALSE);
+			return;
+		}
+
+		dlp= &dep->de_write_pack[dep->de_write_done];
+		count= dlp->dlp_count;
+		get_userdata(mp->DL_PROC, dlp->dlp_iovec,
+			(count > IOVEC_NR ? IOVEC_NR : count) *
+			sizeof(iovec_t), dep->de_write_iovec.iod_iovec);
+		dep->de_write_iovec.iod_iovec_s = count;
+		dep->de_write_iovec.iod_proc_nr = mp->DL_PROC;
+		dep->de_write_iovec.iod_iovec_addr = dlp->dlp_iovec;
+
+		dep->de_tmp_iovec = dep->de_write_iovec;
+		size = calc_iovec_size(&dep->de_tmp_iovec);
+		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
+		{
+			panic("", "dp8390: invalid packet size", size);
+		}
+		dp_sendq_put(dep, size);
+		dep->de_write_done++;
+	}
+
+	dep->de_flags |= DEF_PACK_SEND;
+
+	if (from_int)
+		return;
+	reply(dep, OK, FALSE);
+}
+
+/*===========================================================================*
+ *				do_vreadb				     *
+ *===========================================================================*/
+static void do_vreadb(mp)
+message *mp;
+{
+/* Receive up to DL_COUNT packets, each into the buffer of its own
+ * descriptor.  The reply comes as soon as there is at least one packet,
+ * with the number of packets in DL_COUNT and their sizes in the descriptors.
+ */
+	int port, count;
+	dpeth_t *dep;
+
+	port = mp->DL_PORT;
+	count = mp->DL_COUNT;
+	if (port < 0 || port >= DE_PORT_NR)
+		panic("", "dp8390: illegal port", port);
+	if (count <= 0 || count > DL_BATCH_MAX)
+		panic("", "dp8390: illegal batch size", count);
+	dep= &de_table[port];
+	dep->de_client= mp->DL_PROC;
+	if (dep->de_mode == DEM_SINK)
+	{
+		reply(dep, OK, FALSE);
+		return;
+	}
+	assert(dep->de_mode == DEM_ENABLED);
+	assert(dep->de_flags & DEF_ENABLED);
+
+	if(dep->de_flags & DEF_READING)
+		panic("", "dp8390: read already in progress", NO_NUM);
+
+	get_userdata(mp->DL_PROC, (vir_bytes) mp->DL_ADDR,
+		count * sizeof(dep->de_read_pack[0]), dep->de_read_pack);
+	dep->de_read_packs= count;
+	dep->de_read_pack_addr= (vir_bytes) mp->DL_ADDR;
+	dep->de_read_iovec.iod_proc_nr = mp->DL_PROC;
+	dp_read_pack(dep, 0);
+	dep->de_flags |= DEF_READING | DEF_READ_BATCH;
+
+	dp_recv(dep);
+
+	if ((dep->de_flags & (DEF_READING|DEF_STOPPED)) ==
+		(DEF_READING|DEF_STOPPED))
+	{
+		/* The chip is stopped, and all arrived packets are 
+		 * delivered.
+		 */
+		dp_reset(dep);
+	}
+	reply(dep, OK, FALSE);
+}
+
 /*===========================================================================*
  *				do_init					     *
  *===========================================================================*/
@@ -588,7 +718,7 @@ message *mp;
 		dp_confaddr(dep);
 		reply_mess.m_type = DL_INIT_REPLY;
 		reply_mess.m3_i1 = mp->DL_PORT;
-		reply_mess.m3_i2 = DE_PORT_NR;
+		reply_mess.m3_i2 = DE_PORT_NR | DL_BATCH;
 		*(ether_addr_t *) reply_mess.m3_ca1 = dep->de_address;
 		mess_reply(mp, &reply_mess);
 		return;
@@ -610,7 +740,7 @@ message *mp;
 
 	reply_mess.m_type = DL_INIT_REPLY;
 	reply_mess.m3_i1 = mp->DL_PORT;
-	reply_mess.m3_i2 = DE_PORT_NR;
+	reply_mess.m3_i2 = DE_PORT_NR | DL_BATCH;
 	*(ether_addr_t *) reply_mess.m3_ca1 = dep->de_address;
 
 	mess_reply(mp, &reply_mess);
@@ -1132,7 +1262,8 @@ dpeth_t *dep;
 			if (r != OK)
 				return;
 
-			packet_processed = TRUE;
+			/* A batched read takes packets until it is full */
+			packet_processed = !(dep->de_flags & DEF_READING);
 			dep->de_stat.ets_packetR++;
 		}
 		if (next == dep->de_startpage)
@@ -1159,12 +1290,73 @@ dpeth_t *dep;
 	{
 	case DL_WRITE:	do_vwrite(&dep->de_sendmsg, TRUE, FALSE);	break;
 	case DL_WRITEV:	do_vwrite(&dep->de_sendmsg, TRUE, TRUE);	break;
+	case DL_WRITEVB: do_vwriteb(&dep->de_sendmsg, TRUE);		break;
 	default:
 		panic("", "dp8390: wrong type:", dep->de_sendmsg.m_type);
 		break;
 	}
 }
 
+/*===========================================================================*
+ *				dp_sendq_put				     *
+ *===========================================================================*/
+static void dp_sendq_put(dep, size)
+dpeth_t *dep;
+int size;
+{
+/* Copy the packet described by de_write_iovec to the buffer at the head of
+ * the send queue, and start sending it if the queue was empty.
+ */
+	int sendq_head;
+
+	sendq_head= dep->de_sendq_head;
+	assert(!dep->de_sendq[sendq_head].sq_filled);
+
+	(dep->de_user2nicf)(dep, &dep->de_write_iovec, 0,
+		dep->de_sendq[sendq_head].sq_sendpage * DP_PAGESIZE,
+		size);
+	dep->de_sendq[sendq_head].sq_filled= TRUE;
+	if (dep->de_sendq_tail == sendq_head)
+	{
+		outb_reg0(dep, DP_TPSR, dep->de_sendq[sendq_head].sq_sendpage);
+		outb_reg0(dep, DP_TBCR1, size >> 8);
+		outb_reg0(dep, DP_TBCR0, size & 0xff);
+		outb_reg0(dep, DP_CR, CR_TXP | CR_EXTRA);/* there it goes.. */
+	}
+	else
+		dep->de_sendq[sendq_head].sq_size= size;
+	
+	if (++sendq_head == dep->de_sendq_nr)
+		sendq_head= 0;
+	assert(sendq_head < SENDQ_NR);
+	dep->de_sendq_head= sendq_head;
+}
+
+/*===========================================================================*
+ *				dp_read_pack				     *
+ *===========================================================================*/
+static void dp_read_pack(dep, pack)
+dpeth_t *dep;
+int pack;
+{
+/* Make de_read_iovec describe the buffer of a packet of a batched read. */
+	dl_pack_t *dlp;
+	int count, size;
+
+	dlp= &dep->de_read_pack[pack];
+	count= dlp->dlp_count;
+	get_userdata(dep->de_read_iovec.iod_proc_nr, dlp->dlp_iovec,
+		(count > IOVEC_NR ? IOVEC_NR : count) *
+		sizeof(iovec_t), dep->de_read_iovec.iod_iovec);
+	dep->de_read_iovec.iod_iovec_s = count;
+	dep->de_read_iovec.iod_iovec_addr = dlp->dlp_iovec;
+
+	dep->de_tmp_iovec = dep->de_read_iovec;
+	size= calc_iovec_size(&dep->de_tmp_iovec);
+	if (size < ETH_MAX_PACK_SIZE_TAGGED)
+		panic("", "dp8390: wrong packet size", size);
+}
+
 /*===========================================================================*
  *				dp_getblock				     *
  *===========================================================================*/
@@ -1258,6 +1450,21 @@ int page, length;
 			sizeof(dp_rcvhdr_t), &dep->de_read_iovec, 0, length);
 	}
 
+	if (dep->de_flags & DEF_READ_BATCH)
+	{
+		/* de_read_s counts the packets, the descriptors have the
+		 * sizes. Go on with the next buffer, if any.
+		 */
+		dep->de_read_pack[dep->de_read_s].dlp_size = length;
+		dep->de_read_s++;
+		dep->de_flags |= DEF_PACK_RECV;
+		if (dep->de_read_s < dep->de_read_packs)
+			dp_read_pack(dep, dep->de_read_s);
+		else
+			dep->de_flags &= ~DEF_READING;
+		return OK;
+	}
+
 	dep->de_read_s = length;
 	dep->de_flags |= DEF_PACK_RECV;
 	dep->de_flags &= ~DEF_READING;
@@ -1821,6 +2028,15 @@ int may_block;
 	if (dep->de_flags & DEF_PACK_RECV)
 		status |= DL_PACK_RECV;
 
+	if ((dep->de_flags & (DEF_PACK_RECV|DEF_READ_BATCH)) ==
+		(DEF_PACK_RECV|DEF_READ_BATCH))
+	{
+		put_userdata(dep->de_read_iovec.iod_proc_nr,
+			dep->de_read_pack_addr,
+			dep->de_read_s * sizeof(dep->de_read_pack[0]),
+			dep->de_read_pack);
+	}
+
 	reply.m_type = DL_TASK_REPLY;
 	reply.DL_PORT = dep - de_table;
 	reply.DL_PROC = dep->de_client;
@@ -1840,6 +2056,9 @@ int may_block;
 	if (r < 0)
 		panic("", "dp8390: send failed:", r);
 	
+	/* A batched read ends with the reply, even if not full */
+	if (status & DL_PACK_RECV)
+		dep->de_flags &= ~(DEF_READING | DEF_READ_BATCH);
 	dep->de_read_s = 0;
 	dep->de_flags &= ~(DEF_PACK_SEND | DEF_PACK_RECV);
 }
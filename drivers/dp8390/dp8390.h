@@ -266,6 +266,14 @@ typedef struct dpeth
 	vir_bytes de_read_s;
 	int de_client;
 	message de_sendmsg;
+
+	/* Batched requests */
+	dl_pack_t de_read_pack[DL_BATCH_MAX];
+	int de_read_packs;		/* descriptors in de_read_pack */
+	vir_bytes de_read_pack_addr;	/* where they go back to */
+	dl_pack_t de_write_pack[DL_BATCH_MAX];
+	int de_write_packs;		/* descriptors in de_write_pack */
+	int de_write_done;		/* packets put in the send queue */
 	dp_user2nicf_t de_user2nicf; 
 	dp_nic2userf_t de_nic2userf; 
 	dp_getblock_t de_getblockf; 
@@ -283,6 +291,7 @@ typedef struct dpeth
 #define DEF_BROAD	0x100
 #define DEF_ENABLED	0x200
 #define DEF_STOPPED	0x400
+#define DEF_READ_BATCH	0x800
 
 #define DEM_DISABLED	0x0
 #define DEM_SINK	0x1
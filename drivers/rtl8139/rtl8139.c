@@ -20,6 +20,10 @@
  * |------------|----------|---------|----------|---------|---------|
  * | DL_READV	| port nr  | proc nr | count    |         | address |
  * |------------|----------|---------|----------|---------|---------|
+ * | DL_WRITEVB	| port nr  | proc nr | count    | mode    | address |
+ * |------------|----------|---------|----------|---------|---------|
+ * | DL_READVB	| port nr  | proc nr | count    |         | address |
+ * |------------|----------|---------|----------|---------|---------|
  * | DL_INIT	| port nr  | proc nr | mode     |         | address |
  * |------------|----------|---------|----------|---------|---------|
  * | DL_GETSTAT	| port nr  | proc nr |          |         | address |
@@ -157,6 +161,9 @@ typedef struct re
 	message re_tx_mess;
 	char re_name[sizeof("rtl8139#n")];
 	iovec_t re_iovec[IOVEC_NR];
+	dl_pack_t re_rx_pack[DL_BATCH_MAX];	/* DL_READVB descriptors */
+	dl_pack_t re_tx_pack[DL_BATCH_MAX];	/* DL_WRITEVB descriptors */
+	int re_tx_done;			/* DL_WRITEVB packets started */
 }
 re_t;
 
@@ -239,8 +246,16 @@ _PROTOTYPE( static void rl_confaddr, (re_t *rep)			);
 _PROTOTYPE( static void rl_rec_mode, (re_t *rep)			);
 _PROTOTYPE( static void rl_readv, (message *mp, int from_int, 
 							int vectored)	);
+_PROTOTYPE( static void rl_readvb, (message *mp, int from_int)	);
+_PROTOTYPE( static unsigned rl_get_pack, (re_t *rep, int re_client,
+					vir_bytes iov_addr, int count)	);
 _PROTOTYPE( static void rl_writev, (message *mp, int from_int,
 							int vectored)	);
+_PROTOTYPE( static void rl_writevb, (message *mp, int from_int)	);
+_PROTOTYPE( static int rl_tx_avail, (re_t *rep)				);
+_PROTOTYPE( static int rl_copy_iov, (re_t *rep, int re_client,
+			vir_bytes iov_addr, int count, char *ret)	);
+_PROTOTYPE( static void rl_start_tx, (re_t *rep, int size)		);
 _PROTOTYPE( static void rl_check_ints, (re_t *rep)			);
 _PROTOTYPE( static void rl_report_link, (re_t *rep)			);
 _PROTOTYPE( static void mii_print_techab, (U16_t techab)		);
@@ -318,10 +333,12 @@ int main(int argc, char *argv[])
 		case DEV_PING: notify(m.m_source);		continue;
 		case DL_WRITEV:	rl_writev(&m, FALSE, TRUE);	break;
 		case DL_WRITE:	rl_writev(&m, FALSE, FALSE);	break;
+		case DL_WRITEVB: rl_writevb(&m, FALSE);		break;
 #if 0
 		case DL_READ:	do_vread(&m, FALSE);		break;
 #endif
 		case DL_READV:	rl_readv(&m, FALSE, TRUE);	break;
+		case DL_READVB:	rl_readvb(&m, FALSE);		break;
 		case DL_INIT:	rl_init(&m);			break;
 		case DL_GETSTAT: rl_getstat(&m);		break;
 		case DL_GETNAME: rl_getname(&m);		break;
@@ -515,7 +532,7 @@ message *mp;
 
 	reply_mess.m_type = DL_INIT_REPLY;
 	reply_mess.m3_i1 = mp->DL_PORT;
-	reply_mess.m3_i2 = RE_PORT_NR;
+	reply_mess.m3_i2 = RE_PORT_NR | DL_BATCH;
 	*(ether_addr_t *) reply_mess.m3_ca1 = rep->re_address;
 
 	mess_reply(mp, &reply_mess);
@@ -984,15 +1001,10 @@ message *mp;
 int from_int;
 int vectored;
 {
-	int i, j, n, o, s, s1, dl_port, re_client, count, size;
+	int dl_port, re_client, count;
 	port_t port;
-	unsigned amount, totlen, packlen;
-	phys_bytes src_phys, dst_phys, iov_src;
-	u16_t d_start, d_end;
-	u32_t l, rxstat = 0x12345678;
+	unsigned packlen;
 	re_t *rep;
-	iovec_t *iovp;
-	int cps;
 
 	dl_port = mp->DL_PORT;
 	count = mp->DL_COUNT;
@@ -1018,6 +1030,142 @@ int vectored;
 		goto suspend;
 	}
 
+	assert(vectored);
+	packlen= rl_get_pack(rep, re_client, (vir_bytes) mp->DL_ADDR, count);
+	if (packlen == 0)
+		goto suspend;
+
+	rep->re_read_s= packlen;
+	rep->re_flags= (rep->re_flags & ~REF_READING) | REF_PACK_RECV;
+
+	if (!from_int)
+		reply(rep, OK, FALSE);
+
+	return;
+
+suspend:
+	if (from_int)
+	{
+		assert(rep->re_flags & REF_READING);
+
+		/* No need to store any state */
+		return;
+	}
+
+	rep->re_rx_mess= *mp;
+	assert(!(rep->re_flags & REF_READING));
+	rep->re_flags |= REF_READING;
+
+	reply(rep, OK, FALSE);
+}
+
+/*===========================================================================*
+ *				rl_readvb				     *
+ *===========================================================================*/
+static void rl_readvb(mp, from_int)
+message *mp;
+int from_int;
+{
+/* Receive as many packets as there are in the buffer, up to the number of
+ * descriptors.  The size of each is stored in its descriptor and the number
+ * of packets is returned in DL_COUNT.
+ */
+	int n, dl_port, re_client, count;
+	port_t port;
+	unsigned packlen;
+	re_t *rep;
+	dl_pack_t *dlp;
+	int cps;
+
+	dl_port = mp->DL_PORT;
+	count = mp->DL_COUNT;
+	if (dl_port < 0 || dl_port >= RE_PORT_NR)
+		panic("rtl8139"," illegal port", dl_port);
+	if (count <= 0 || count > DL_BATCH_MAX)
+		panic("rtl8139","illegal batch size", count);
+	rep= &re_table[dl_port];
+	re_client= mp->DL_PROC;
+	rep->re_client= re_client;
+
+	if (rep->re_clear_rx)
+		goto suspend;	/* Buffer overflow */
+
+	assert(rep->re_mode == REM_ENABLED);
+	assert(rep->re_flags & REF_ENABLED);
+
+	port= rep->re_base_port;
+
+	cps = sys_vircopy(re_client, D, (vir_bytes) mp->DL_ADDR,
+		SELF, D, (vir_bytes) rep->re_rx_pack,
+		count * sizeof(rep->re_rx_pack[0]));
+	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
+
+	for (n= 0, dlp= rep->re_rx_pack; n<count; n++, dlp++)
+	{
+		/* rl_check_ints did the check for the first packet */
+		if ((n > 0 || !from_int) &&
+			(rl_inb(port, RL_CR) & RL_CR_BUFE))
+		{
+			break;
+		}
+		packlen= rl_get_pack(rep, re_client, dlp->dlp_iovec,
+			dlp->dlp_count);
+		if (packlen == 0)
+			break;
+		dlp->dlp_size= packlen;
+	}
+	if (n == 0)
+		goto suspend;
+
+	cps = sys_vircopy(SELF, D, (vir_bytes) rep->re_rx_pack,
+		re_client, D, (vir_bytes) mp->DL_ADDR,
+		n * sizeof(rep->re_rx_pack[0]));
+	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
+
+	rep->re_read_s= n;
+	rep->re_flags= (rep->re_flags & ~REF_READING) | REF_PACK_RECV;
+
+	if (!from_int)
+		reply(rep, OK, FALSE);
+
+	return;
+
+suspend:
+	if (from_int)
+	{
+		assert(rep->re_flags & REF_READING);
+		return;
+	}
+
+	rep->re_rx_mess= *mp;
+	assert(!(rep->re_flags & REF_READING));
+	rep->re_flags |= REF_READING;
+
+	reply(rep, OK, FALSE);
+}
+
+/*===========================================================================*
+ *				rl_get_pack				     *
+ *===========================================================================*/
+static unsigned rl_get_pack(rep, re_client, iov_addr, count)
+re_t *rep;
+int re_client;
+vir_bytes iov_addr;		/* I/O vector of the client */
+int count;			/* number of elements in it */
+{
+/* Copy the next packet in the receive buffer to the client.  Return the size
+ * of the packet, or 0 if it is not complete yet or the buffer overflowed.
+ */
+	int i, j, n, o, s, s1, size;
+	port_t port;
+	unsigned amount, totlen, packlen;
+	u16_t d_start, d_end;
+	u32_t l, rxstat = 0x12345678;
+	iovec_t *iovp;
+	int cps, iov_offset;
+
+	port= rep->re_base_port;
+
 	d_start= rl_inw(port, RL_CAPR) + RL_CAPR_DATA_OFF;
 	d_end= rl_inw(port, RL_CBR) % RX_BUFSIZE;
 
@@ -1035,20 +1183,12 @@ int vectored;
 
 	rxstat = *(u32_t *) (rep->v_re_rx_buf + d_start);
 
-#if DEAD_CODE
-	src_phys= rep->re_rx_buf + d_start;
-	cps = sys_physcopy(
-		NONE, PHYS_SEG, src_phys,
-		SELF, D, (vir_bytes) &rxstat, sizeof(rxstat));
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#endif
-
 	if (rep->re_clear_rx)
 	{
 #if 0
 		printf("rl_readv: late buffer overflow\n");
 #endif
-		goto suspend;	/* Buffer overflow */
+		return 0;	/* Buffer overflow */
 	}
 
 	/* Should convert from little endian to host byte order */
@@ -1081,317 +1221,156 @@ int vectored;
 	if (totlen+4 > amount)
 	{
 		printf("rl_readv: packet not yet ready\n");
-		goto suspend;
+		return 0;
 	}
 
 	/* Should subtract the CRC */
 	packlen= totlen - ETH_CRC_SIZE;
 
-	if (vectored)
-	{
-		int iov_offset = 0;
-#if 0
-		if ((cps = sys_umap(re_client, D, (vir_bytes) mp->DL_ADDR,
-			count * sizeof(rep->re_iovec[0]), &iov_src)) != OK)
-			printf("sys_umap failed: %d\n", cps);
-#endif
-
-		size= 0;
-		o= d_start+4;
-		src_phys= rep->re_rx_buf;
-		for (i= 0; i<count; i += IOVEC_NR,
-			iov_src += IOVEC_NR * sizeof(rep->re_iovec[0]),
-			iov_offset += IOVEC_NR * sizeof(rep->re_iovec[0]))
-		{
-			n= IOVEC_NR;
-			if (i+n > count)
-				n= count-i;
-#if 0
-			cps = sys_physcopy(NONE, PHYS_SEG, iov_src, SELF, D, (vir_bytes) rep->re_iovec, 
-				n * sizeof(rep->re_iovec[0]));
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
-			cps = sys_vircopy(re_client, D, (vir_bytes) mp->DL_ADDR + iov_offset,
-				SELF, D, (vir_bytes) rep->re_iovec, n * sizeof(rep->re_iovec[0]));
+	size= 0;
+	o= d_start+4;
+	iov_offset= 0;
+	for (i= 0; i<count; i += IOVEC_NR,
+		iov_offset += IOVEC_NR * sizeof(rep->re_iovec[0]))
+	{
+		n= IOVEC_NR;
+		if (i+n > count)
+			n= count-i;
+		cps = sys_vircopy(re_client, D, iov_addr + iov_offset,
+			SELF, D, (vir_bytes) rep->re_iovec, n * sizeof(rep->re_iovec[0]));
 	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
-#endif
 
-			for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
+		for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
+		{
+			s= iovp->iov_size;
+			if (size + s > packlen)
 			{
-				s= iovp->iov_size;
-				if (size + s > packlen)
-				{
-					assert(packlen > size);
-					s= packlen-size;
-				}
-
-#if 0
-				if (sys_umap(re_client, D, iovp->iov_addr, s, &dst_phys) != OK)
-				  panic("rtl8139","umap_local failed\n", NO_NUM);
-#endif
+				assert(packlen > size);
+				s= packlen-size;
+			}
 
-				if (o >= RX_BUFSIZE)
-				{
-					o -= RX_BUFSIZE;
-					assert(o < RX_BUFSIZE);
-				}
+			if (o >= RX_BUFSIZE)
+			{
+				o -= RX_BUFSIZE;
+				assert(o < RX_BUFSIZE);
+			}
 
-				if (o+s > RX_BUFSIZE)
-				{
-					assert(o<RX_BUFSIZE);
-					s1= RX_BUFSIZE-o;
+			if (o+s > RX_BUFSIZE)
+			{
+				assert(o<RX_BUFSIZE);
+				s1= RX_BUFSIZE-o;
 
-#if 0
-					cps = sys_abscopy(src_phys+o, dst_phys, s1);
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-					cps = sys_abscopy(src_phys, dst_phys+s1, s-s1);
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
-					cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf+o,
-					re_client, D, iovp->iov_addr, s1);
+				cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf+o,
+				re_client, D, iovp->iov_addr, s1);
 	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
-					cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf,
-					re_client, D, iovp->iov_addr+s1, s-s1);
+				cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf,
+				re_client, D, iovp->iov_addr+s1, s-s1);
 	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
-#endif
-				}
-				else
-				{
-#if 0
-					cps = sys_abscopy(src_phys+o, dst_phys, s);
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
-					cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf+o,
-					re_client, D, iovp->iov_addr, s);
+			}
+			else
+			{
+				cps = sys_vircopy(SELF, D, (vir_bytes) rep->v_re_rx_buf+o,
+				re_client, D, iovp->iov_addr, s);
 	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d (%d)\n", cps, __LINE__);
-#endif
-				}
-
-				size += s;
-				if (size == packlen)
-					break;
-				o += s;
 			}
+
+			size += s;
 			if (size == packlen)
 				break;
+			o += s;
 		}
-		if (size < packlen)
-		{
-			assert(0);
-		}
+		if (size == packlen)
+			break;
 	}
-	else
-	{  
+	if (size < packlen)
+	{
 		assert(0);
-#if 0
-		size= mp->DL_COUNT;
-		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
-			panic("rtl8139","invalid packet size", size);
-		if (OK != sys_umap(re_client, D, (vir_bytes)mp->DL_ADDR, size, &phys_user))
-			panic("rtl8139","umap_local failed", NO_NUM);
+	}
 
-		p= rep->re_tx[tx_head].ret_buf;
-		cps = sys_abscopy(phys_user, p, size);
-		if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
+	if (rep->re_clear_rx)
+	{
+		/* For some reason the receiver FIFO is not stopped when
+		 * the buffer is full.
+		 */
+#if 0
+		printf("rl_readv: later buffer overflow\n");
 #endif
-		}
-
-		if (rep->re_clear_rx)
-		{
-			/* For some reason the receiver FIFO is not stopped when
-			 * the buffer is full.
-			 */
-	#if 0
-			printf("rl_readv: later buffer overflow\n");
-	#endif
-			goto suspend;	/* Buffer overflow */
-		}
-
-		rep->re_stat.ets_packetR++;
-		rep->re_read_s= packlen;
-		rep->re_flags= (rep->re_flags & ~REF_READING) | REF_PACK_RECV;
-
-		/* Avoid overflow in 16-bit computations */
-		l= d_start;
-		l += totlen+4;
-		l= (l+3) & ~3;	/* align */
-		if (l >= RX_BUFSIZE)
-		{
-			l -= RX_BUFSIZE;
-			assert(l < RX_BUFSIZE);
-		}
-		rl_outw(port, RL_CAPR, l-RL_CAPR_DATA_OFF);
-
-		if (!from_int)
-			reply(rep, OK, FALSE);
-
-		return;
-
-	suspend:
-		if (from_int)
-		{
-			assert(rep->re_flags & REF_READING);
-
-			/* No need to store any state */
-			return;
-		}
+		return 0;	/* Buffer overflow */
+	}
 
-		rep->re_rx_mess= *mp;
-		assert(!(rep->re_flags & REF_READING));
-		rep->re_flags |= REF_READING;
+	rep->re_stat.ets_packetR++;
 
-		reply(rep, OK, FALSE);
+	/* Avoid overflow in 16-bit computations */
+	l= d_start;
+	l += totlen+4;
+	l= (l+3) & ~3;	/* align */
+	if (l >= RX_BUFSIZE)
+	{
+		l -= RX_BUFSIZE;
+		assert(l < RX_BUFSIZE);
 	}
+	rl_outw(port, RL_CAPR, l-RL_CAPR_DATA_OFF);
 
-	/*===========================================================================*
-	 *				rl_writev				     *
-	 *===========================================================================*/
-	static void rl_writev(mp, from_int, vectored)
-	message *mp;
-	int from_int;
-	int vectored;
-	{
-		phys_bytes p, iov_src, phys_user;
-		int i, j, n, s, port, count, size;
-		int tx_head, re_client;
-		re_t *rep;
-		iovec_t *iovp;
-		char *ret;
-		int cps;
-
-		port = mp->DL_PORT;
-		count = mp->DL_COUNT;
-		if (port < 0 || port >= RE_PORT_NR)
-			panic("rtl8139","illegal port", port);
-		rep= &re_table[port];
-		re_client= mp->DL_PROC;
-		rep->re_client= re_client;
-
-		assert(rep->re_mode == REM_ENABLED);
-		assert(rep->re_flags & REF_ENABLED);
-
-		if (from_int)
-		{
-			assert(rep->re_flags & REF_SEND_AVAIL);
-			rep->re_flags &= ~REF_SEND_AVAIL;
-			rep->re_send_int= FALSE;
-			rep->re_tx_alive= TRUE;
-		}
-
-		tx_head= rep->re_tx_head;
-		if (rep->re_tx[tx_head].ret_busy)
-		{
-			assert(!(rep->re_flags & REF_SEND_AVAIL));
-			rep->re_flags |= REF_SEND_AVAIL;
-			if (rep->re_tx[tx_head].ret_busy)
-				goto suspend;
-
-			/* Race condition, the interrupt handler may clear re_busy
-			 * before we got a chance to set REF_SEND_AVAIL. Checking
-			 * ret_busy twice should be sufficient.
-			 */
-	#if 0
-			printf("rl_writev: race detected\n");
-	#endif
-			rep->re_flags &= ~REF_SEND_AVAIL;
-			rep->re_send_int= FALSE;
-		}
+	return packlen;
+}
 
-		assert(!(rep->re_flags & REF_SEND_AVAIL));
-		assert(!(rep->re_flags & REF_PACK_SENT));
+	/*===========================================================================*
+ *				rl_writev				     *
+ *===========================================================================*/
+static void rl_writev(mp, from_int, vectored)
+message *mp;
+int from_int;
+int vectored;
+{
+	int port, count, size;
+	int tx_head, re_client;
+	re_t *rep;
+	char *ret;
+	int cps;
 
-		if (vectored)
-		{
-			int iov_offset = 0;
+	port = mp->DL_PORT;
+	count = mp->DL_COUNT;
+	if (port < 0 || port >= RE_PORT_NR)
+		panic("rtl8139","illegal port", port);
+	rep= &re_table[port];
+	re_client= mp->DL_PROC;
+	rep->re_client= re_client;
 
-#if 0
-			if (OK != sys_umap(re_client, D, (vir_bytes)mp->DL_ADDR,
-				count * sizeof(rep->re_iovec[0]), &iov_src))
-				panic("rtl8139","umap_local failed", NO_NUM);
-#endif
+	assert(rep->re_mode == REM_ENABLED);
+	assert(rep->re_flags & REF_ENABLED);
 
-			size= 0;
-#if 0
-			p= rep->re_tx[tx_head].ret_buf;
-#else
-			ret = rep->re_tx[tx_head].v_ret_buf;
-#endif
-			for (i= 0; i<count; i += IOVEC_NR,
-				iov_src += IOVEC_NR * sizeof(rep->re_iovec[0]),
-				iov_offset += IOVEC_NR * sizeof(rep->re_iovec[0]))
-			{
-				n= IOVEC_NR;
-				if (i+n > count)
-					n= count-i;
-#if 0
-				cps = sys_physcopy(NONE, PHYS_SEG, iov_src, SELF, D, (vir_bytes) rep->re_iovec, 
-					n * sizeof(rep->re_iovec[0]));
-		if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
-				cps = sys_vircopy(re_client, D, ((vir_bytes) mp->DL_ADDR) + iov_offset,
-					SELF, D, (vir_bytes) rep->re_iovec, 
-					n * sizeof(rep->re_iovec[0]));
-	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d\n", cps);
-#endif
+	if (from_int)
+	{
+		assert(rep->re_flags & REF_SEND_AVAIL);
+		rep->re_flags &= ~REF_SEND_AVAIL;
+		rep->re_send_int= FALSE;
+		rep->re_tx_alive= TRUE;
+	}
 
-			for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
-			{
-				s= iovp->iov_size;
-				if (size + s > ETH_MAX_PACK_SIZE_TAGGED)
-				{
-				  panic("rtl8139","invalid packet size",
-			  	    NO_NUM);
-				}
+	if (!rl_tx_avail(rep))
+		goto suspend;
 
-				if (OK != sys_umap(re_client, D, iovp->iov_addr, s, &phys_user))
-				  panic("rtl8139","umap_local failed\n", NO_NUM);
+	assert(!(rep->re_flags & REF_SEND_AVAIL));
+	assert(!(rep->re_flags & REF_PACK_SENT));
 
-#if 0
-				cps = sys_abscopy(phys_user, p, s);
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
-				cps = sys_vircopy(re_client, D, iovp->iov_addr,
-					SELF, D, (vir_bytes) ret, s);
-		if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d\n", cps);
-#endif
-				size += s;
-#if 0
-				p += s;
-#endif
-				ret += s;
-			}
-		}
-		if (size < ETH_MIN_PACK_SIZE)
-			panic("rtl8139","invalid packet size", size);
+	tx_head= rep->re_tx_head;
+	if (vectored)
+	{
+		size= rl_copy_iov(rep, re_client, (vir_bytes) mp->DL_ADDR,
+			count, rep->re_tx[tx_head].v_ret_buf);
 	}
 	else
 	{  
 		size= mp->DL_COUNT;
 		if (size < ETH_MIN_PACK_SIZE || size > ETH_MAX_PACK_SIZE_TAGGED)
 			panic("rtl8139","invalid packet size", size);
-#if 0
-		if (OK != sys_umap(re_client, D, (vir_bytes)mp->DL_ADDR, size, &phys_user))
-			panic("rtl8139","umap_local failed\n", NO_NUM);
-
-		p= rep->re_tx[tx_head].ret_buf;
-		cps = sys_abscopy(phys_user, p, size);
-	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#else
 		ret = rep->re_tx[tx_head].v_ret_buf;
 		cps = sys_vircopy(re_client, D, (vir_bytes)mp->DL_ADDR, 
 			SELF, D, (vir_bytes) ret, size);
 	if (cps != OK) printf("RTL8139: warning, sys_abscopy failed: %d\n", cps);
-#endif
 	}
 
-	rl_outl(rep->re_base_port, RL_TSD0+tx_head*4, 
-		rep->re_ertxth | size);
-	rep->re_tx[tx_head].ret_busy= TRUE;
-
-	if (++tx_head == N_TX_BUF)
-		tx_head= 0;
-	assert(tx_head < RL_N_TX);
-	rep->re_tx_head= tx_head;
+	rl_start_tx(rep, size);
 
 	rep->re_flags |= REF_PACK_SENT;
 
@@ -1405,15 +1384,15 @@ int vectored;
 
 suspend:
 #if 0
-		printf("rl_writev: head %d, tail %d, busy: %d %d %d %d\n",
-			tx_head, rep->re_tx_tail,
-			rep->re_tx[0].ret_busy, rep->re_tx[1].ret_busy,
-			rep->re_tx[2].ret_busy, rep->re_tx[3].ret_busy);
-		printf("rl_writev: TSD: 0x%x, 0x%x, 0x%x, 0x%x\n",
-			rl_inl(rep->re_base_port, RL_TSD0+0*4),
-			rl_inl(rep->re_base_port, RL_TSD0+1*4),
-			rl_inl(rep->re_base_port, RL_TSD0+2*4),
-			rl_inl(rep->re_base_port, RL_TSD0+3*4));
+	printf("rl_writev: head %d, tail %d, busy: %d %d %d %d\n",
+		rep->re_tx_head, rep->re_tx_tail,
+		rep->re_tx[0].ret_busy, rep->re_tx[1].ret_busy,
+		rep->re_tx[2].ret_busy, rep->re_tx[3].ret_busy);
+	printf("rl_writev: TSD: 0x%x, 0x%x, 0x%x, 0x%x\n",
+		rl_inl(rep->re_base_port, RL_TSD0+0*4),
+		rl_inl(rep->re_base_port, RL_TSD0+1*4),
+		rl_inl(rep->re_base_port, RL_TSD0+2*4),
+		rl_inl(rep->re_base_port, RL_TSD0+3*4));
 #endif
 
 	if (from_int)
@@ -1423,6 +1402,188 @@ suspend:
 	reply(rep, OK, FALSE);
 }
 
+/*===========================================================================*
+ *				rl_writevb				     *
+ *===========================================================================*/
+static void rl_writevb(mp, from_int)
+message *mp;
+int from_int;
+{
+/* Send a batch of packets.  As many as there are free transmit buffers are
+ * started right away, the rest when buffers become free.  The reply with
+ * DL_PACK_SEND comes when the last packet is started.
+ */
+	int port, count, size;
+	int re_client;
+	re_t *rep;
+	dl_pack_t *dlp;
+	int cps;
+
+	port = mp->DL_PORT;
+	count = mp->DL_COUNT;
+	if (port < 0 || port >= RE_PORT_NR)
+		panic("rtl8139","illegal port", port);
+	if (count <= 0 || count > DL_BATCH_MAX)
+		panic("rtl8139","illegal batch size", count);
+	rep= &re_table[port];
+	re_client= mp->DL_PROC;
+	rep->re_client= re_client;
+
+	assert(rep->re_mode == REM_ENABLED);
+	assert(rep->re_flags & REF_ENABLED);
+
+	if (from_int)
+	{
+		assert(rep->re_flags & REF_SEND_AVAIL);
+		rep->re_flags &= ~REF_SEND_AVAIL;
+		rep->re_send_int= FALSE;
+		rep->re_tx_alive= TRUE;
+	}
+	else
+	{
+		assert(!(rep->re_flags & REF_PACK_SENT));
+		cps = sys_vircopy(re_client, D, (vir_bytes) mp->DL_ADDR,
+			SELF, D, (vir_bytes) rep->re_tx_pack,
+			count * sizeof(rep->re_tx_pack[0]));
+	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d\n", cps);
+		rep->re_tx_done= 0;
+	}
+
+	while (rep->re_tx_done < count)
+	{
+		if (!rl_tx_avail(rep))
+			goto suspend;
+
+		dlp= &rep->re_tx_pack[rep->re_tx_done];
+		size= rl_copy_iov(rep, re_client, dlp->dlp_iovec,
+			dlp->dlp_count, rep->re_tx[rep->re_tx_head].v_ret_buf);
+		rl_start_tx(rep, size);
+		rep->re_tx_done++;
+	}
+
+	rep->re_flags |= REF_PACK_SENT;
+
+	if (from_int)
+		return;
+	reply(rep, OK, FALSE);
+	return;
+
+suspend:
+	if (from_int)
+		return;
+
+	rep->re_tx_mess= *mp;
+	reply(rep, OK, FALSE);
+}
+
+/*===========================================================================*
+ *				rl_tx_avail				     *
+ *===========================================================================*/
+static int rl_tx_avail(rep)
+re_t *rep;
+{
+/* Return TRUE if the next transmit buffer is free.  If it is not, set
+ * REF_SEND_AVAIL to get a call from the interrupt handler when it is.
+ */
+	int tx_head;
+
+	tx_head= rep->re_tx_head;
+	if (rep->re_tx[tx_head].ret_busy)
+	{
+		assert(!(rep->re_flags & REF_SEND_AVAIL));
+		rep->re_flags |= REF_SEND_AVAIL;
+		if (rep->re_tx[tx_head].ret_busy)
+			return FALSE;
+
+		/* Race condition, the interrupt handler may clear re_busy
+		 * before we got a chance to set REF_SEND_AVAIL. Checking
+		 * ret_busy twice should be sufficient.
+		 */
+#if 0
+		printf("rl_writev: race detected\n");
+#endif
+		rep->re_flags &= ~REF_SEND_AVAIL;
+		rep->re_send_int= FALSE;
+	}
+	return TRUE;
+}
+
+/*===========================================================================*
+ *				rl_copy_iov				     *
+ *===========================================================================*/
+static int rl_copy_iov(rep, re_client, iov_addr, count, ret)
+re_t *rep;
+int re_client;
+vir_bytes iov_addr;		/* I/O vector of the client */
+int count;			/* number of elements in it */
+char *ret;			/* transmit buffer */
+{
+/* Gather a packet from the client into a transmit buffer and return its
+ * size.
+ */
+	phys_bytes phys_user;
+	int i, j, n, s, size;
+	iovec_t *iovp;
+	int cps, iov_offset;
+
+	size= 0;
+	iov_offset= 0;
+	for (i= 0; i<count; i += IOVEC_NR,
+		iov_offset += IOVEC_NR * sizeof(rep->re_iovec[0]))
+	{
+		n= IOVEC_NR;
+		if (i+n > count)
+			n= count-i;
+		cps = sys_vircopy(re_client, D, iov_addr + iov_offset,
+			SELF, D, (vir_bytes) rep->re_iovec, 
+			n * sizeof(rep->re_iovec[0]));
+	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d\n", cps);
+
+		for (j= 0, iovp= rep->re_iovec; j<n; j++, iovp++)
+		{
+			s= iovp->iov_size;
+			if (size + s > ETH_MAX_PACK_SIZE_TAGGED)
+			{
+			  panic("rtl8139","invalid packet size",
+			    NO_NUM);
+			}
+
+			if (OK != sys_umap(re_client, D, iovp->iov_addr, s, &phys_user))
+			  panic("rtl8139","umap_local failed\n", NO_NUM);
+
+			cps = sys_vircopy(re_client, D, iovp->iov_addr,
+				SELF, D, (vir_bytes) ret, s);
+	if (cps != OK) printf("RTL8139: warning, sys_vircopy failed: %d\n", cps);
+			size += s;
+			ret += s;
+		}
+	}
+	if (size < ETH_MIN_PACK_SIZE)
+		panic("rtl8139","invalid packet size", size);
+	return size;
+}
+
+/*===========================================================================*
+ *				rl_start_tx				     *
+ *===========================================================================*/
+static void rl_start_tx(rep, size)
+re_t *rep;
+int size;
+{
+/* Start transmitting the packet in the buffer at the head. */
+	int tx_head;
+
+	tx_head= rep->re_tx_head;
+	rl_outl(rep->re_base_port, RL_TSD0+tx_head*4, 
+		rep->re_ertxth | size);
+	rep->re_tx[tx_head].ret_busy= TRUE;
+
+	if (++tx_head == N_TX_BUF)
+		tx_head= 0;
+	assert(tx_head < RL_N_TX);
+	rep->re_tx_head= tx_head;
+}
+
 /*===========================================================================*
  *				rl_check_ints				     *
  *===========================================================================*/
@@ -1480,6 +1641,8 @@ re_t *rep;
 			rl_readv(&rep->re_rx_mess, TRUE /* from int */,
 				TRUE /* vectored */);
 		}
+		else if (rep->re_rx_mess.m_type == DL_READVB)
+			rl_readvb(&rep->re_rx_mess, TRUE /* from int */);
 		else
 		{
 			assert(rep->re_rx_mess.m_type == DL_READ);
@@ -1500,6 +1663,8 @@ re_t *rep;
 			rl_writev(&rep->re_tx_mess, TRUE /* from int */,
 				TRUE /* vectored */);
 		}
+		else if (rep->re_tx_mess.m_type == DL_WRITEVB)
+			rl_writevb(&rep->re_tx_mess, TRUE /* from int */);
 		else
 		{
 			assert(rep->re_tx_mess.m_type == DL_WRITE);
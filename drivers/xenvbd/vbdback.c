@@ -0,0 +1,302 @@
+/**
+ * vbdback - user-space stand-in for the Xen block backend
+ *
+ * Usage: vbdback [-b pages] [-n batches] image
+ *
+ * This program services the blkif ring of <xen/blkif.h> from a disk image
+ * file, so the ring protocol that xenvbd speaks can be tried without Xen.
+ * It is a demonstration of the protocol, not a test of xenvbd: the frontend
+ * below, queue() and complete(), is its own copy of the way xenvbd fills
+ * and drains the ring, and a change to xenvbd.c is not exercised here until
+ * it is made in both places. It runs on the development host, not on MINIX,
+ * and must be compiled for 32 bits because the ring layout uses longs:
+ *
+ *	cc -m32 -o vbdback vbdback.c
+ *
+ * A shared mapping plays the role of guest memory. Page 0 holds the ring,
+ * and the other pages are the "machine frames" named in request segments.
+ * Two pipes play the event channels. The backend is a child process. The
+ * parent is a frontend that drives the ring the way xenvbd does: each batch
+ * is cut into requests of up to BLKIF_MAX_SEGMENTS_PER_REQUEST pages and is
+ * followed by a single notification. The frontend writes a pattern over the
+ * disk, reads it back and compares it, then reports how many requests and
+ * notifications were needed.
+ *
+ * Copyright (c) 2006, Ivan Kelly
+ */
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef unsigned char u8_t;
+typedef unsigned short u16_t;
+typedef short i16_t;
+typedef unsigned int u32_t;
+typedef struct { u32_t _[2]; } u64_t;	/* as in MINIX <sys/types.h> */
+#define PACKED				/* as in <xen/xenasm.h> */
+#include "../../include/xen/blkif.h"
+
+#define PAGE_SIZE	4096
+#define PAGE_SHIFT	12
+#define SECTOR_SIZE	512
+#define SECT_PER_PAGE	(PAGE_SIZE / SECTOR_SIZE)
+#define MAX_PAGES	(BLKIF_RING_SIZE * BLKIF_MAX_SEGMENTS_PER_REQUEST)
+
+/* The ring must look the same as in the 32-bit MINIX driver. */
+extern int dummy[(sizeof(blkif_request_t) == 60) ? 1 : -1];
+
+static blkif_ring_t *ring;		/* page 0 of the shared memory */
+static u8_t *frames;			/* the shared memory itself */
+static int fe_evtchn[2], be_evtchn[2];	/* frontend -> backend and back */
+static int image;			/* the disk image */
+static unsigned long capacity;		/* size of the image in sectors */
+
+static BLKIF_RING_IDX req_prod, resp_cons;
+static unsigned long nr_requests, nr_notify, nr_segments;
+
+static void backend(void);
+static int service(blkif_request_t *req);
+static void notify(int *evtchn);
+static void wait_event(int *evtchn);
+static void queue(int operation, unsigned long sector, unsigned pages);
+static int complete(void);
+static void fatal(char *msg);
+
+/*===========================================================================*
+ *				main					     *
+ *===========================================================================*/
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+  unsigned batch_pages = 64;	/* pages per batch, as in xenvbd */
+  unsigned long batches, max_batches = 0;
+  unsigned long sector, off;
+  unsigned i;
+  pid_t pid;
+  int c, status, errors = 0;
+
+  while ((c = getopt(argc, argv, "b:n:")) != -1) {
+    switch (c) {
+    case 'b': batch_pages = atoi(optarg); break;
+    case 'n': max_batches = atol(optarg); break;
+    default: goto usage;
+    }
+  }
+  if (optind != argc - 1 || batch_pages < 1 || batch_pages > MAX_PAGES) {
+usage:
+    fprintf(stderr, "Usage: vbdback [-b pages] [-n batches] image\n");
+    exit(1);
+  }
+
+  if ((image = open(argv[optind], O_RDWR)) < 0) fatal(argv[optind]);
+  capacity = lseek(image, (off_t) 0, SEEK_END) / SECTOR_SIZE;
+
+  frames = mmap(NULL, (size_t) (MAX_PAGES + 1) * PAGE_SIZE,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (frames == MAP_FAILED) fatal("mmap");
+  ring = (blkif_ring_t *) frames;
+  if (pipe(fe_evtchn) < 0 || pipe(be_evtchn) < 0) fatal("pipe");
+
+  if ((pid = fork()) < 0) fatal("fork");
+  if (pid == 0) {
+    backend();
+    exit(0);
+  }
+
+  /* Write a pattern over the disk in batches, then read it back. */
+  for (c = BLKIF_OP_WRITE; c >= BLKIF_OP_READ; c--) {
+    batches = 0;
+    for (sector = 0; sector + SECT_PER_PAGE <= capacity;
+	 sector += batch_pages * SECT_PER_PAGE) {
+      if (max_batches != 0 && batches++ == max_batches) break;
+      if ((capacity - sector) / SECT_PER_PAGE < batch_pages)
+	batch_pages = (capacity - sector) / SECT_PER_PAGE;
+
+      for (i = 0; i < batch_pages; i++) {
+	off = (i + 1) * PAGE_SIZE;
+	if (c == BLKIF_OP_WRITE)
+	  memset(frames + off, (int) ((sector / SECT_PER_PAGE + i) & 0xFF),
+		 PAGE_SIZE);
+	else
+	  memset(frames + off, 0, PAGE_SIZE);
+      }
+      queue(c, sector, batch_pages);
+      if (complete() != 0) errors++;
+
+      for (i = 0; c == BLKIF_OP_READ && i < batch_pages; i++) {
+	off = (i + 1) * PAGE_SIZE;
+	if (frames[off] != ((sector / SECT_PER_PAGE + i) & 0xFF)
+	    || frames[off + PAGE_SIZE - 1] != frames[off])
+	  errors++;
+      }
+    }
+  }
+
+  close(fe_evtchn[1]);		/* backend sees EOF and stops */
+  waitpid(pid, &status, 0);
+
+  printf("%lu requests, %lu segments, %lu notifications, %d errors\n",
+	 nr_requests, nr_segments, nr_notify, errors);
+  return (errors == 0 ? 0 : 1);
+}
+
+/*===========================================================================*
+ *				queue					     *
+ *===========================================================================*/
+static void queue(operation, sector, pages)
+int operation;
+unsigned long sector;
+unsigned pages;
+{
+  /* Put one batch on the ring, like vbd_queue() in xenvbd. */
+  blkif_request_t *req;
+  unsigned page = 0;
+  int seg;
+
+  while (page < pages) {
+    req = &ring->ring[MASK_BLKIF_IDX(req_prod)].req;
+    req->operation = operation;
+    req->device = 0;
+    req->id = req_prod;
+    req->sector_number._[0] = sector;
+    req->sector_number._[1] = 0;
+    for (seg = 0; seg < BLKIF_MAX_SEGMENTS_PER_REQUEST && page < pages;
+	 seg++, page++) {
+      req->frame_and_sects[seg] = ((page + 1) << PAGE_SHIFT)
+	| (SECT_PER_PAGE - 1);
+      sector += SECT_PER_PAGE;
+      nr_segments++;
+    }
+    req->nr_segments = seg;
+    req_prod++;
+    nr_requests++;
+  }
+  __sync_synchronize();
+  ring->req_prod = req_prod;
+  notify(fe_evtchn);
+}
+
+/*===========================================================================*
+ *				complete				     *
+ *===========================================================================*/
+static int complete()
+{
+  /* Wait for the responses to a batch, like vbd_complete() in xenvbd. */
+  blkif_response_t *resp;
+  int errors = 0;
+
+  while (resp_cons != req_prod) {
+    wait_event(be_evtchn);
+    __sync_synchronize();
+    while (resp_cons != ring->resp_prod) {
+      resp = &ring->ring[MASK_BLKIF_IDX(resp_cons)].resp;
+      if (resp->status < 0) errors++;
+      resp_cons++;
+    }
+  }
+  return (errors);
+}
+
+/*===========================================================================*
+ *				backend					     *
+ *===========================================================================*/
+static void backend()
+{
+  /* Take requests off the ring until the frontend goes away. A response
+   * is written in place of each request, and the frontend is notified once
+   * for all requests that were found on the ring together.
+   */
+  BLKIF_RING_IDX req_cons = 0, rp;
+  blkif_request_t req;
+  blkif_response_t *resp;
+  char c;
+
+  close(fe_evtchn[1]);
+  while (read(fe_evtchn[0], &c, 1) == 1) {
+    rp = ring->req_prod;
+    __sync_synchronize();
+    while (req_cons != rp) {
+      req = ring->ring[MASK_BLKIF_IDX(req_cons)].req;
+      resp = &ring->ring[MASK_BLKIF_IDX(req_cons)].resp;
+      resp->status = service(&req);
+      resp->id = req.id;
+      resp->operation = req.operation;
+      req_cons++;
+    }
+    __sync_synchronize();
+    ring->resp_prod = req_cons;
+    notify(be_evtchn);
+  }
+}
+
+/*===========================================================================*
+ *				service					     *
+ *===========================================================================*/
+static int service(req)
+blkif_request_t *req;
+{
+  /* Carry out one request on the image. */
+  unsigned long fas, sector = req->sector_number._[0];
+  vdisk_t *vd;
+  u8_t *buf;
+  size_t len;
+  int seg;
+
+  if (req->operation == BLKIF_OP_PROBE) {
+    vd = (vdisk_t *) (frames + (req->frame_and_sects[0] >> PAGE_SHIFT)
+		      * PAGE_SIZE);
+    vd->capacity._[0] = capacity;
+    vd->capacity._[1] = 0;
+    vd->device = 0;
+    vd->info = VDISK_TYPE_DISK;
+    return (1);
+  }
+
+  for (seg = 0; seg < req->nr_segments; seg++) {
+    fas = req->frame_and_sects[seg];
+    if ((fas >> PAGE_SHIFT) > MAX_PAGES) return (BLKIF_RSP_ERROR);
+    buf = frames + (fas >> PAGE_SHIFT) * PAGE_SIZE
+      + blkif_first_sect(fas) * SECTOR_SIZE;
+    len = (blkif_last_sect(fas) - blkif_first_sect(fas) + 1) * SECTOR_SIZE;
+    if (req->operation == BLKIF_OP_WRITE) {
+      if (pwrite(image, buf, len, (off_t) sector * SECTOR_SIZE) != len)
+	return (BLKIF_RSP_ERROR);
+    } else {
+      if (pread(image, buf, len, (off_t) sector * SECTOR_SIZE) != len)
+	return (BLKIF_RSP_ERROR);
+    }
+    sector += len / SECTOR_SIZE;
+  }
+  return (BLKIF_RSP_OKAY);
+}
+
+/*===========================================================================*
+ *				notify, wait_event			     *
+ *===========================================================================*/
+static void notify(evtchn)
+int *evtchn;
+{
+  if (evtchn == fe_evtchn) nr_notify++;
+  if (write(evtchn[1], "", 1) != 1) fatal("notify");
+}
+
+static void wait_event(evtchn)
+int *evtchn;
+{
+  char c;
+
+  if (read(evtchn[0], &c, 1) != 1) fatal("event channel");
+}
+
+static void fatal(msg)
+char *msg;
+{
+  perror(msg);
+  exit(1);
+}
@@ -1,6 +1,19 @@
 /**
  * Minix xen block device
  *
+ * This is the frontend of a Xen virtual block device. Requests are put on
+ * the blkif ring that is shared with the backend domain. An I/O vector from
+ * the FS is cut into batches. Each batch goes on the ring as a series of
+ * requests, followed by a single event channel notification. The backend
+ * answers on the same ring and raises our event channel. Then x_hw_int()
+ * takes the responses off the ring.
+ *
+ * Segments name machine frames, and the backend reads or writes them
+ * directly. The pages of a sector aligned buffer are looked up with a
+ * GET_MFNS kernel call and handed to the backend as they are, so the data
+ * is not copied. Buffers that are not sector aligned are staged through a
+ * small pool of bounce pages, whose frames are looked up once.
+ *
  * Copyright (c) 2006, Ivan Kelly
  */
 #include "../drivers.h"
@@ -17,13 +30,8 @@
 
 #define NR_DEVS 1
 PRIVATE struct device x_geom[NR_DEVS];	/* base and size of each device */
-PRIVATE int x_seg[NR_DEVS];	/* segment index of each device */
 PRIVATE int x_device;		/* current device */
 
-PRIVATE struct kinfo kinfo;	/* kernel information */
-PRIVATE struct machine machine;	/* machine information */
-
-
 /**
  * Buffer is 2 PAGES in size, because it must be block aligned
  */
@@ -31,6 +39,47 @@ PRIVATE u8_t blk_ring_buf[PAGE_SIZE*2];
 PRIVATE blkif_ring_t *blk_ring = NULL;
 PRIVATE memory_t blk_ring_shmem_frame = 0;
 
+/**
+ * The segments of the current batch, in frame_and_sects format. A batch is
+ * at most as large as the ring.
+ */
+#define VBD_SECT_PER_PAGE (PAGE_SIZE / SECTOR_SIZE)
+#define VBD_MAX_SEGS      (BLKIF_RING_SIZE * BLKIF_MAX_SEGMENTS_PER_REQUEST)
+
+PRIVATE unsigned long vbd_seg[VBD_MAX_SEGS];
+PRIVATE int vbd_nr_seg;
+
+/**
+ * Bounce pages for buffers that are not sector aligned. The machine frame
+ * of every page is looked up once. For a read, the data is copied to the
+ * caller when the batch is complete.
+ */
+#define VBD_BOUNCE_PAGES  16
+
+PRIVATE u8_t bounce_buf[PAGE_SIZE * (VBD_BOUNCE_PAGES + 1)];
+PRIVATE u8_t *bounce;		/* page aligned start of bounce_buf */
+PRIVATE memory_t bounce_frame[VBD_BOUNCE_PAGES];	/* machine frames */
+PRIVATE struct vbd_bounce {
+  vir_bytes vb_addr;		/* where the data is in the caller */
+  unsigned vb_len;		/* number of bytes in the page */
+} vbd_bounce[VBD_BOUNCE_PAGES];
+PRIVATE int vbd_nr_bounce;	/* bounce pages used by the current batch */
+
+/**
+ * State of the interface. The request producer index is kept privately,
+ * and only published on the ring when a batch is complete.
+ */
+#define VBD_CLOSED        0
+#define VBD_DISCONNECTED  1
+#define VBD_CONNECTED     2
+PRIVATE int vbd_state = VBD_CLOSED;
+PRIVATE int vbd_evtchn;		/* event channel of the interface */
+PRIVATE blkif_vdev_t vbd_vdev;	/* device number of the virtual disk */
+PRIVATE BLKIF_RING_IDX req_prod;	/* requests produced */
+PRIVATE BLKIF_RING_IDX resp_cons;	/* responses consumed */
+PRIVATE int vbd_errors;		/* failed requests in the current batch */
+PRIVATE int vbd_probed;		/* number of disks reported by a probe */
+
 extern int errno;		/* error number for PM calls */
 
 FORWARD _PROTOTYPE(char *x_name, (void));
@@ -46,27 +95,34 @@ FORWARD _PROTOTYPE(int x_ioctl, (struct driver * dp, message * m_ptr));
 FORWARD _PROTOTYPE(void x_geometry, (struct partition * entry));
 FORWARD _PROTOTYPE(int x_hw_int, (struct driver *dp, message *m_ptr));
 
+FORWARD _PROTOTYPE(void vbd_ctrl, (message *m_ptr));
+FORWARD _PROTOTYPE(void vbd_connect, (u32_t handle));
+FORWARD _PROTOTYPE(void vbd_probe, (void));
+FORWARD _PROTOTYPE(int vbd_map, (int proc_nr, int opcode, vir_bytes addr,
+		    unsigned bytes));
+FORWARD _PROTOTYPE(void vbd_book, (iovec_t **iovp, unsigned *nr_reqp,
+		    unsigned bytes));
+FORWARD _PROTOTYPE(void vbd_queue, (int operation, off_t position));
+FORWARD _PROTOTYPE(int vbd_complete, (void));
+
 /* Entry points to this driver. */
 PRIVATE struct driver x_dtab = {
   x_name,			/* current device's name */
   x_do_open,		/* open or mount */
   x_do_close,			/* nothing on a close */
-  x_ioctl,		/* specify ram disk geometry */
+  x_ioctl,		/* get or set a partition's geometry */
   x_prepare,		/* prepare for I/O on a given minor device */
   x_transfer,		/* do the I/O */
   nop_cleanup,		/* no need to clean up */
-  x_geometry,		/* memory device "geometry" */
+  x_geometry,		/* virtual disk "geometry" */
   nop_signal,		/* system signals */
   nop_alarm,
   nop_cancel,
   nop_select,
   NULL,
-  x_hw_int
+  x_hw_int		/* responses or control messages */
 };
 
-#define click_to_round_k(n)						\
-  ((unsigned) ((((unsigned long) (n) << CLICK_SHIFT) + 512) / 1024))
-
 #define sys_getvtom(dst, nr)	sys_getinfo(GET_VTOM, dst, 0,0, nr)
 
 int buf_count = 0;		/* # characters in the buffer */
@@ -111,10 +167,9 @@ void kputc(c)
  *===========================================================================*/
 PUBLIC int main(void)
 {
-  /* Main program. Initialize the memory driver and start the main loop. */
+  /* Main program. Initialize the block driver and start the main loop. */
   x_init();
 
-  printf("init'd\n");
   driver_task(&x_dtab);
 
   return (OK);
@@ -127,7 +182,6 @@ PRIVATE char *x_name()
 {
   /* Return a name for the current device. */
   static char name[] = "xenvbd";
-  printf("x_name\n");
   return name;
 }
 
@@ -137,19 +191,16 @@ PRIVATE char *x_name()
 PRIVATE struct device *x_prepare(device)
      int device;
 {
-  printf("x_prepare\n");
-#if 0
   /* Prepare for I/O on a device: check if the minor device number is ok. */
   if (device < 0 || device >= NR_DEVS)
     return (NIL_DEV);
   x_device = device;
 
-#endif
   return (&x_geom[device]);
 }
 
 /*===========================================================================*
- *				m_transfer				     *
+ *				x_transfer				     *
  *===========================================================================*/
 PRIVATE int x_transfer(proc_nr, opcode, position, iov, nr_req)
      int proc_nr;			/* process doing the request */
@@ -158,113 +209,217 @@ PRIVATE int x_transfer(proc_nr, opcode, position, iov, nr_req)
      iovec_t *iov;			/* pointer to read or write request vector */
      unsigned nr_req;		/* length of request vector */
 {
-  /* Read or write one the driver's minor devices. */
-  phys_bytes mem_phys;
-  int seg;
-  unsigned count, left, chunk;
-  vir_bytes user_vir;
-  struct device *dv;
+  /* Read or write the virtual disk. As much of the vector as fits on the
+   * ring is mapped onto request segments, and the batch is put on the ring
+   * at once. The backend reads or writes the caller's pages directly.
+   */
   unsigned long dv_size;
-  int s;
+  unsigned batch, offset, left;
+  unsigned i;
+  int b, r;
 
-  printf("x_transfer\n");
-#if 0
-  /* Get minor device number and check for /dev/null. */
-  dv = &m_geom[m_device];
-  dv_size = cv64ul(dv->dv_size);
+  if (vbd_state != VBD_CONNECTED)
+    return (EIO);
+  if (position % SECTOR_SIZE != 0)
+    return (EINVAL);
+  dv_size = cv64ul(x_geom[x_device].dv_size);
 
   while (nr_req > 0) {
+    if (position >= dv_size)
+      return (OK);	/* check for EOF */
 
-    /* How much to transfer and where to / from. */
-    count = iov->iov_size;
-    user_vir = iov->iov_addr;
-
-    switch (m_device) {
+    /* Map elements onto segments until the ring or the bounce pool is full,
+     * or the end of the device is reached.
+     */
+    vbd_nr_seg = vbd_nr_bounce = 0;
+    batch = offset = 0;
+    for (i = 0; i < nr_req && position + batch < dv_size; ) {
+      left = iov[i].iov_size - offset;
+      if (left > dv_size - position - batch)
+	left = dv_size - position - batch;
+      if ((r = vbd_map(proc_nr, opcode, iov[i].iov_addr + offset, left)) < 0)
+	return (r);
+      if (r == 0)
+	break;
+      batch += r;
+      if ((offset += r) == iov[i].iov_size) {
+	i++;
+	offset = 0;
+      }
+    }
+    if (batch == 0)
+      return (EINVAL);
 
-      /* No copying; ignore request. */
-    case NULL_DEV:
-      if (opcode == DEV_GATHER)
-	return (OK);	/* always at EOF */
-      break;
+    vbd_queue(opcode == DEV_GATHER ? BLKIF_OP_READ : BLKIF_OP_WRITE,
+	      position);
+    if ((r = vbd_complete()) != OK)
+      return (r);
+
+    /* Data that was read into the bounce pool goes to the caller now. */
+    for (b = 0; opcode == DEV_GATHER && b < vbd_nr_bounce; b++) {
+      r = sys_vircopy(SELF, D, (vir_bytes) bounce + b * PAGE_SIZE,
+		      proc_nr, D, vbd_bounce[b].vb_addr, vbd_bounce[b].vb_len);
+      if (r != OK)
+	return (r);
+    }
 
-      /* Virtual copying. For RAM disk, kernel memory and boot device. */
-    case RAM_DEV:
-    case KMEM_DEV:
-    case BOOT_DEV:
-      if (position >= dv_size)
-	return (OK);	/* check for EOF */
-      if (position + count > dv_size)
-	count = dv_size - position;
-      seg = m_seg[m_device];
-
-      if (opcode == DEV_GATHER) {	/* copy actual data */
-	sys_vircopy(SELF, seg, position, proc_nr,
-		    D, user_vir, count);
-      } else {
-	sys_vircopy(proc_nr, D, user_vir, SELF,
-		    seg, position, count);
-      }
-      break;
+    /* Book the number of bytes transferred. */
+    vbd_book(&iov, &nr_req, batch);
+    position += batch;
+  }
+  return (OK);
+}
 
-      /* Physical copying. Only used to access entire memory. */
-    case MEM_DEV:
-      if (position >= dv_size)
-	return (OK);	/* check for EOF */
-      if (position + count > dv_size)
-	count = dv_size - position;
-      mem_phys = cv64ul(dv->dv_base) + position;
-
-      if (opcode == DEV_GATHER) {	/* copy data */
-	sys_physcopy(NONE, PHYS_SEG, mem_phys,
-		     proc_nr, D, user_vir, count);
-      } else {
-	sys_physcopy(proc_nr, D, user_vir,
-		     NONE, PHYS_SEG, mem_phys,
-		     count);
-      }
-      break;
+/*===========================================================================*
+ *				vbd_map					     *
+ *===========================================================================*/
+PRIVATE int vbd_map(proc_nr, opcode, addr, bytes)
+     int proc_nr;			/* process doing the request */
+     int opcode;			/* DEV_GATHER or DEV_SCATTER */
+     vir_bytes addr;			/* start of the data in the caller */
+     unsigned bytes;			/* bytes to map */
+{
+  /* Add segments for (part of) a buffer to the current batch, and return the
+   * number of bytes that are covered. A sector aligned buffer is used in
+   * place: the machine frames of its pages go into the segments. Any other
+   * buffer is staged through pages of the bounce pool.
+   */
+  unsigned long maddr[MFNS_MAX_PAGES];
+  unsigned in_page, n, mapped = 0;
+  struct vbd_bounce *bp;
+  int i, npages, first, s;
+
+  if (bytes % SECTOR_SIZE != 0)
+    return (EINVAL);	/* not a whole sector */
+
+  in_page = addr % PAGE_SIZE;
+  if (bytes > MFNS_MAX_PAGES * PAGE_SIZE - in_page)
+    bytes = (MFNS_MAX_PAGES * PAGE_SIZE - in_page) & ~(SECTOR_SIZE - 1);
+  npages = (in_page + bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+  if ((s = sys_getmfns(maddr, npages, proc_nr, addr)) != OK)
+    return (s);
+
+  if (maddr[0] % SECTOR_SIZE == 0) {
+    for (i = 0; i < npages && vbd_nr_seg < VBD_MAX_SEGS; i++) {
+      in_page = maddr[i] % PAGE_SIZE;
+      n = PAGE_SIZE - in_page;
+      if (n > bytes - mapped)
+	n = bytes - mapped;
+      first = in_page / SECTOR_SIZE;
+      vbd_seg[vbd_nr_seg++] = (maddr[i] - in_page)
+	| (first << 3) | (first + n / SECTOR_SIZE - 1);
+      mapped += n;
+    }
+    return (mapped);
+  }
 
-      /* Null byte stream generator. */
-    case ZERO_DEV:
-      if (opcode == DEV_GATHER) {
-	left = count;
-	while (left > 0) {
-	  chunk =
-	    (left >
-	     ZERO_BUF_SIZE) ? ZERO_BUF_SIZE
-	    : left;
-	  if (OK !=
-	      (s =
-	       sys_vircopy(SELF, D,
-			   (vir_bytes)
-			   dev_zero, proc_nr,
-			   D, user_vir,
-			   chunk)))
-	    report("MEM",
-		   "sys_vircopy failed",
-		   s);
-	  left -= chunk;
-	  user_vir += chunk;
-	}
-      }
-      break;
+  while (mapped < bytes && vbd_nr_bounce < VBD_BOUNCE_PAGES
+	 && vbd_nr_seg < VBD_MAX_SEGS) {
+    n = bytes - mapped;
+    if (n > PAGE_SIZE)
+      n = PAGE_SIZE;
+    bp = &vbd_bounce[vbd_nr_bounce];
+    bp->vb_addr = addr + mapped;
+    bp->vb_len = n;
+    if (opcode == DEV_SCATTER) {
+      s = sys_vircopy(proc_nr, D, bp->vb_addr, SELF, D,
+		      (vir_bytes) bounce + vbd_nr_bounce * PAGE_SIZE, n);
+      if (s != OK)
+	return (s);
+    }
+    vbd_seg[vbd_nr_seg++] = (bounce_frame[vbd_nr_bounce] << PAGE_SHIFT)
+      | (n / SECTOR_SIZE - 1);
+    vbd_nr_bounce++;
+    mapped += n;
+  }
+  return (mapped);
+}
 
-      /* Unknown (illegal) minor device. */
-    default:
-      return (EINVAL);
+/*===========================================================================*
+ *				vbd_book				     *
+ *===========================================================================*/
+PRIVATE void vbd_book(iovp, nr_reqp, bytes)
+     iovec_t **iovp;			/* current element of the vector */
+     unsigned *nr_reqp;		/* elements left in the vector */
+     unsigned bytes;			/* bytes transferred */
+{
+  /* Book the bytes of a batch in the caller's I/O vector. */
+  iovec_t *iov;
+  unsigned chunk;
+
+  while (bytes > 0) {
+    iov = *iovp;
+    chunk = (iov->iov_size < bytes) ? iov->iov_size : bytes;
+    bytes -= chunk;
+    iov->iov_addr += chunk;
+    if ((iov->iov_size -= chunk) == 0) {
+      (*iovp)++;
+      (*nr_reqp)--;
     }
+  }
+}
 
-    /* Book the number of bytes transferred. */
-    position += count;
-    iov->iov_addr += count;
-    if ((iov->iov_size -= count) == 0) {
-      iov++;
-      nr_req--;
+/*===========================================================================*
+ *				vbd_queue				     *
+ *===========================================================================*/
+PRIVATE void vbd_queue(operation, position)
+     int operation;			/* BLKIF_OP_READ or BLKIF_OP_WRITE */
+     off_t position;			/* offset on the virtual disk */
+{
+  /* Put the segments of a batch on the ring, in requests of at most
+   * BLKIF_MAX_SEGMENTS_PER_REQUEST segments. The backend is notified once,
+   * after the last request.
+   */
+  blkif_request_t *req;
+  unsigned long sector, fas;
+  int seg, i = 0;
+  message m;
+
+  sector = position / SECTOR_SIZE;
+
+  while (i < vbd_nr_seg) {
+    req = &blk_ring->ring[MASK_BLKIF_IDX(req_prod)].req;
+    req->operation = operation;
+    req->device = vbd_vdev;
+    req->id = req_prod;
+    req->sector_number = cvul64(sector);
+
+    for (seg = 0; seg < BLKIF_MAX_SEGMENTS_PER_REQUEST && i < vbd_nr_seg;
+	 seg++, i++) {
+      fas = vbd_seg[i];
+      req->frame_and_sects[seg] = fas;
+      sector += blkif_last_sect(fas) - blkif_first_sect(fas) + 1;
     }
+    req->nr_segments = seg;
+    req_prod++;
+  }
+
+  /* The requests are written before the index, and x86 does not reorder
+   * stores, so the backend never sees a half-built request.
+   */
+  blk_ring->req_prod = req_prod;
+
+  m.m_type = CTRLIF_NOTIFY_EVTCHN;
+  m.m5_i1 = vbd_evtchn;
+  if (sendrec(CTRLIF, &m) != OK || m.m_type != OK)
+    panic("XENVBD", "Couldn't notify event channel", vbd_evtchn);
+}
+
+/*===========================================================================*
+ *				vbd_complete				     *
+ *===========================================================================*/
+PRIVATE int vbd_complete()
+{
+  /* Wait until the backend has answered all requests on the ring. */
+  message m;
 
+  vbd_errors = 0;
+  while (resp_cons != req_prod) {
+    if (receive(HARDWARE, &m) != OK)
+      continue;
+    x_hw_int(&x_dtab, &m);
   }
-#endif
-  return (OK);
+  return (vbd_errors == 0 ? OK : EIO);
 }
 
 /*===========================================================================*
@@ -275,11 +430,8 @@ PRIVATE int x_do_open(dp, m_ptr)
      message *m_ptr;
 {
   /* Check device number on open. */
-  printf("x_do_open\n");
-#if 0
   if (x_prepare(m_ptr->DEVICE) == NIL_DEV)
     return (ENXIO);
-#endif
   return (OK);
 }
 
@@ -290,6 +442,7 @@ PRIVATE int x_do_close(dp, m_ptr)
      struct driver *dp;
      message *m_ptr;
 {
+  return (OK);
 }
 
 /*===========================================================================*
@@ -297,25 +450,32 @@ PRIVATE int x_do_close(dp, m_ptr)
  *===========================================================================*/
 PRIVATE void x_init()
 {
-  /* Initialize this task. All minor devices are initialized one by one. */
-  phys_bytes ramdev_size;
-  phys_bytes ramdev_base;
+  /* Initialize this task. Set up the ring and the bounce buffer, connect to
+   * the backend through the domain controller, and probe the virtual disk.
+   */
   message regmsg, m;
   ctrl_msg_t *cmsg;
   blkif_fe_driver_status_t *statmsg;
+  memory_t maddr;
   int i, s;
-  long mf = 0;
 
   printf("Starting VBD\n");
 
-  printf("buf addr: %x\n", &blk_ring_buf);
   blk_ring = (blkif_ring_t*)((((unsigned long)&blk_ring_buf)+PAGE_SIZE) & ~(PAGE_SIZE-1));
-  printf("blk_ring_addr: %x\n", blk_ring);
-  if ((s = sys_getvtom(&blk_ring, blk_ring)) != OK) {
+  blk_ring->req_prod = blk_ring->resp_prod = 0;
+  req_prod = resp_cons = 0;
+  if ((s = sys_getvtom(&maddr, blk_ring)) != OK) {
     panic("XENVBD", "Couldn't convert virtual address to machine frame", s);
   }
-  printf("blk_ring_addr: %x\n", blk_ring);
+  blk_ring_shmem_frame = maddr >> PAGE_SHIFT;
 
+  bounce = (u8_t *)((((unsigned long)&bounce_buf)+PAGE_SIZE) & ~(PAGE_SIZE-1));
+  for (i = 0; i < VBD_BOUNCE_PAGES; i++) {
+    if ((s = sys_getvtom(&maddr, bounce + i * PAGE_SIZE)) != OK) {
+      panic("XENVBD", "Couldn't convert virtual address to machine frame", s);
+    }
+    bounce_frame[i] = maddr >> PAGE_SHIFT;
+  }
 
   /** connect to evtchn */
   regmsg.m_source = DRVR_PROC_NR;
@@ -326,110 +486,181 @@ PRIVATE void x_init()
 
   m.m_source = DRVR_PROC_NR;
   m.m_type = CTRLIF_SEND_BLOCK;
-  cmsg = &m.m9_msg;
+  cmsg = (ctrl_msg_t *) m.m9_msg;
   cmsg->type = CMSG_BLKIF_FE;
   cmsg->subtype = CMSG_BLKIF_FE_DRIVER_STATUS;
   cmsg->length = sizeof(blkif_fe_driver_status_t);
-  statmsg = &cmsg->msg;
+  statmsg = (blkif_fe_driver_status_t *) cmsg->msg;
   statmsg->status = BLKIF_DRIVER_STATUS_UP;
   sendrec(CTRLIF, &m);
+
+  /* The controller answers with the status of the interface. Connect it if
+   * it is disconnected, until it is connected.
+   */
+  while (vbd_state != VBD_CONNECTED) {
+    if (receive(CTRLIF, &m) != OK)
+      continue;
+    vbd_ctrl(&m);
+  }
+
+  vbd_probe();
 }
 
 /*===========================================================================*
- *				m_ioctl					     *
+ *				vbd_ctrl				     *
  *===========================================================================*/
-PRIVATE int x_ioctl(dp, m_ptr)
-     struct driver *dp;		/* pointer to driver structure */
-     message *m_ptr;			/* pointer to control message */
+PRIVATE void vbd_ctrl(m_ptr)
+     message *m_ptr;
 {
-  /* I/O controls for the memory driver. Currently there is one I/O control:
-   * - MIOCRAMSIZE: to set the size of the RAM disk.
-   */
-  struct device *dv;
-
-  printf("x_ioctl\n");
-#if 0
-  switch (m_ptr->REQUEST) {
-  case MIOCRAMSIZE:{
-    /* FS wants to create a new RAM disk with the given size. */
-    phys_bytes ramdev_size;
-    phys_bytes ramdev_base;
-    message m;
-    int s;
-
-    /* Only FS can create RAM disk, and only on RAM disk device. */
-    if (m_ptr->PROC_NR != FS_PROC_NR)
-      return (EPERM);
-    if (m_ptr->DEVICE != RAM_DEV)
-      return (EINVAL);
-    if ((dv = m_prepare(m_ptr->DEVICE)) == NIL_DEV)
-      return (ENXIO);
-
-    /* Try to allocate a piece of memory for the RAM disk. */
-    ramdev_size = m_ptr->POSITION;
-    if (allocmem(ramdev_size, &ramdev_base) < 0) {
-      report("MEM", "warning, allocmem failed",
-	     errno);
-      return (ENOMEM);
-    }
+  /* Handle a message from the domain controller about our interface. */
+  ctrl_msg_t *cmsg = (ctrl_msg_t *) m_ptr->m9_msg;
+  blkif_fe_interface_status_t *st;
+  message m;
 
-    /* Store the values we got in the data store so we can retrieve
-     * them later on, in the unfortunate event of a crash.
-     */
-    m.DS_KEY = MEMORY_MAJOR;
-    m.DS_VAL_L1 = ramdev_size;
-    m.DS_VAL_L2 = ramdev_base;
-    if (OK !=
-	(s = _taskcall(DS_PROC_NR, DS_PUBLISH, &m))) {
-      panic("MEM",
-	    "Couldn't store RAM disk details at DS.",
-	    s);
-    }
-    printf
-      ("MEM stored size %u and base %u at DS, status %d\n",
-       ramdev_size, ramdev_base, s);
-
-    if (OK !=
-	(s =
-	 sys_segctl(&m_seg[RAM_DEV], (u16_t *) & s,
-		    (vir_bytes *) & s, ramdev_base,
-		    ramdev_size))) {
-      panic("MEM",
-	    "Couldn't install remote segment.",
-	    s);
-    }
+  if (cmsg->type != CMSG_BLKIF_FE
+      || cmsg->subtype != CMSG_BLKIF_FE_INTERFACE_STATUS)
+    return;
+  st = (blkif_fe_interface_status_t *) cmsg->msg;
 
-    dv->dv_base = cvul64(ramdev_base);
-    dv->dv_size = cvul64(ramdev_size);
+  switch (st->status) {
+  case BLKIF_INTERFACE_STATUS_CLOSED:
+    printf("XENVBD: interface %d closed\n", st->handle);
+    vbd_state = VBD_CLOSED;
+    break;
+
+  case BLKIF_INTERFACE_STATUS_DISCONNECTED:
+    vbd_state = VBD_DISCONNECTED;
+    vbd_connect(st->handle);
+    break;
+
+  case BLKIF_INTERFACE_STATUS_CONNECTED:
+    if (vbd_state == VBD_CONNECTED)
+      break;
+    vbd_evtchn = st->evtchn;
+    m.m_type = CTRLIF_BIND_EVTCHN;
+    m.m5_i1 = vbd_evtchn;
+    m.m5_i2 = DRVR_PROC_NR;
+    if (sendrec(CTRLIF, &m) != OK || m.m_type != OK)
+      panic("XENVBD", "Couldn't bind event channel", vbd_evtchn);
+    vbd_state = VBD_CONNECTED;
     break;
-  }
 
   default:
-    return (do_diocntl(&m_dtab, m_ptr));
+    break;
   }
-#endif
-  return (OK);
 }
 
 /*===========================================================================*
- *				m_geometry				     *
+ *				vbd_connect				     *
+ *===========================================================================*/
+PRIVATE void vbd_connect(handle)
+     u32_t handle;
+{
+  /* Ask the domain controller to connect the ring to the backend. */
+  message m;
+  ctrl_msg_t *cmsg;
+  blkif_fe_interface_connect_t *conn;
+
+  m.m_type = CTRLIF_SEND_BLOCK;
+  cmsg = (ctrl_msg_t *) m.m9_msg;
+  cmsg->type = CMSG_BLKIF_FE;
+  cmsg->subtype = CMSG_BLKIF_FE_INTERFACE_CONNECT;
+  cmsg->length = sizeof(blkif_fe_interface_connect_t);
+  conn = (blkif_fe_interface_connect_t *) cmsg->msg;
+  conn->handle = handle;
+  conn->shmem_frame = blk_ring_shmem_frame;
+  sendrec(CTRLIF, &m);
+}
+
+/*===========================================================================*
+ *				vbd_probe				     *
+ *===========================================================================*/
+PRIVATE void vbd_probe()
+{
+  /* Ask the backend which virtual disks there are, and use the first. */
+  blkif_request_t *req;
+  vdisk_t *vd;
+  message m;
+
+  req = &blk_ring->ring[MASK_BLKIF_IDX(req_prod)].req;
+  req->operation = BLKIF_OP_PROBE;
+  req->nr_segments = 1;
+  req->device = 0;
+  req->id = req_prod;
+  req->sector_number = cvul64(0);
+  req->frame_and_sects[0] = (bounce_frame[0] << PAGE_SHIFT)
+    | ((VBD_SECT_PER_PAGE-1) << 0);
+  blk_ring->req_prod = ++req_prod;
+
+  m.m_type = CTRLIF_NOTIFY_EVTCHN;
+  m.m5_i1 = vbd_evtchn;
+  if (sendrec(CTRLIF, &m) != OK || m.m_type != OK)
+    panic("XENVBD", "Couldn't notify event channel", vbd_evtchn);
+
+  vbd_probed = 0;
+  if (vbd_complete() != OK || vbd_probed <= 0) {
+    panic("XENVBD", "No virtual disks found", vbd_probed);
+  }
+
+  vd = (vdisk_t *) bounce;
+  vbd_vdev = vd->device;
+  x_geom[0].dv_base = cvul64(0);
+  x_geom[0].dv_size = mul64u(ex64lo(vd->capacity), SECTOR_SIZE);
+  printf("XENVBD: disk %x, %lu sectors\n", vbd_vdev, ex64lo(vd->capacity));
+}
+
+/*===========================================================================*
+ *				x_ioctl					     *
+ *===========================================================================*/
+PRIVATE int x_ioctl(dp, m_ptr)
+     struct driver *dp;		/* pointer to driver structure */
+     message *m_ptr;			/* pointer to control message */
+{
+  /* The virtual disk only knows the generic partition I/O controls. */
+  return (do_diocntl(&x_dtab, m_ptr));
+}
+
+/*===========================================================================*
+ *				x_geometry				     *
  *===========================================================================*/
 PRIVATE void x_geometry(entry)
      struct partition *entry;
 {
-  printf("x_geometry\n");
-#if 0
-  /* Memory devices don't have a geometry, but the outside world insists. */
+  /* Virtual disks don't have a geometry, but the outside world insists. */
   entry->cylinders =
-    div64u(m_geom[m_device].dv_size, SECTOR_SIZE) / (64 * 32);
+    div64u(x_geom[x_device].dv_size, SECTOR_SIZE) / (64 * 32);
   entry->heads = 64;
   entry->sectors = 32;
-#endif
 }
 
+/*===========================================================================*
+ *				x_hw_int				     *
+ *===========================================================================*/
 PRIVATE int x_hw_int(dp, m_ptr)
      struct driver *dp;
      message *m_ptr;
 {
-  printf("x_hw_int\n");
+  /* A control message arrived, or the backend raised our event channel.
+   * Take all responses that are on the ring.
+   */
+  BLKIF_RING_IDX rp;
+  blkif_response_t *resp;
+
+  if (m_ptr->m_source == CTRLIF) {
+    vbd_ctrl(m_ptr);
+    return (OK);
+  }
+
+  rp = blk_ring->resp_prod;
+  while (resp_cons != rp) {
+    resp = &blk_ring->ring[MASK_BLKIF_IDX(resp_cons)].resp;
+    if (resp->status < 0) {
+      printf("XENVBD: request %lu failed\n", resp->id);
+      vbd_errors++;
+    } else if (resp->operation == BLKIF_OP_PROBE) {
+      vbd_probed = resp->status;
+    }
+    resp_cons++;
+  }
+  return (OK);
 }
@@ -153,6 +153,8 @@
 #define DL_STOP		(DL_RQ_BASE + 8)
 #define DL_GETSTAT	(DL_RQ_BASE + 9)
 #define DL_GETNAME	(DL_RQ_BASE +10)
+#define DL_READVB	(DL_RQ_BASE +11)	/* read a batch of packets */
+#define DL_WRITEVB	(DL_RQ_BASE +12)	/* write a batch of packets */
 
 /* Message type for data link layer replies. */
 #define DL_INIT_REPLY	(DL_RS_BASE + 20)
@@ -168,6 +170,14 @@
 #define DL_ADDR		m2_p1
 #define DL_STAT		m2_l1
 #define DL_NAME		m3_ca1
+#define DL_PORTS	m3_i2		/* DL_INIT_REPLY: number of ports */
+
+/* A batched request passes an array of DL_COUNT dl_pack_t descriptors, at
+ * most DL_BATCH_MAX.  The reply to DL_READVB has the number of packets
+ * received in DL_COUNT and their sizes in the descriptors.  DL_WRITEVB
+ * gets DL_PACK_SEND once all packets are queued for transmission.
+ */
+#define DL_BATCH_MAX	8
 
 /* Bits in 'DL_STAT' field of DL replies. */
 #  define DL_PACK_SEND		0x01
@@ -180,6 +190,10 @@
 #  define DL_MULTI_REQ		0x4
 #  define DL_BROAD_REQ		0x8
 
+/* Bits in 'DL_PORTS' field of DL_INIT_REPLY, above the number of ports. */
+#  define DL_PORTS_MASK		0x00FF
+#  define DL_BATCH		0x0100	/* driver does DL_READVB/DL_WRITEVB */
+
 /*===========================================================================*
  *                  SYSTASK request types and field names                    *
  *===========================================================================*/
@@ -225,7 +239,10 @@
 #  define SYS_ABORT      (KERNEL_CALL + 27)	/* sys_abort() */
 #  define SYS_IOPENABLE  (KERNEL_CALL + 28)	/* sys_enable_iop() */
 
-#define NR_SYS_CALLS	29	/* number of system calls */ 
+#  define SYS_ASYNSEND   (KERNEL_CALL + 29)	/* sys_asynsend() */
+#  define SYS_ASYNRECV   (KERNEL_CALL + 30)	/* sys_asynrecv() */
+
+#define NR_SYS_CALLS	31	/* number of system calls */ 
 
 /* Field names for SYS_MEMSET, SYS_SEGCTL. */
 #define MEM_PTR		m2_p1	/* base */
@@ -308,6 +325,12 @@
 #define VCP_VEC_SIZE	m1_i3	/* size of copy vector */
 #define VCP_VEC_ADDR	m1_p1	/* pointer to copy vector */
 
+/* Field names for SYS_ASYNSEND and SYS_ASYNRECV. */
+#define ASYN_PROC_NR	m1_i1	/* destination process */
+#define ASYN_NR_OK	m1_i2	/* number of messages posted or received */
+#define ASYN_VEC_SIZE	m1_i3	/* number of messages in vector */
+#define ASYN_VEC_ADDR	m1_p1	/* pointer to message vector */
+
 /* Field names for SYS_GETINFO. */
 #define I_REQUEST      m7_i3	/* what info to get */
 #   define GET_KINFO	   0	/* get kernel information structure */
@@ -326,6 +349,8 @@
 #   define GET_LOCKTIMING 13	/* get lock()/unlock() latency timing */
 #   define GET_BIOSBUFFER 14	/* get a buffer for BIOS calls */
 #   define GET_VTOM       15	/* convert a virtual address to a machine addr */
+#   define GET_MFNS       16	/* machine addresses of a process' pages */
+#      define MFNS_MAX_PAGES 16	/* most pages in one GET_MFNS request */
 #define I_PROC_NR      m7_i4	/* calling process */
 #define I_VAL_PTR      m7_p1	/* virtual address at caller */ 
 #define I_VAL_LEN      m7_i1	/* max length of value */
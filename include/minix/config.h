@@ -42,24 +42,24 @@
 #if _MINIX_SMALL
 
 #define NR_BUFS	100
-#define NR_BUF_HASH 128
 
 #else
 
-/* The buffer cache should be made as large as you can afford. */
+/* The buffer cache should be made as large as you can afford.  NR_BUFS is
+ * the default size, in blocks of MAX_BLOCK_SIZE; FS takes the real size from
+ * the 'bufcache' boot parameter and cuts it into blocks of the file systems
+ * in use.
+ */
 #if (MACHINE == IBM_PC && _WORD_SIZE == 2)
 #define NR_BUFS           40	/* # blocks in the buffer cache */
-#define NR_BUF_HASH       64	/* size of buf hash table; MUST BE POWER OF 2*/
 #endif
 
 #if (MACHINE == IBM_PC && _WORD_SIZE == 4)
 #define NR_BUFS         1200	/* # blocks in the buffer cache */
-#define NR_BUF_HASH     2048	/* size of buf hash table; MUST BE POWER OF 2*/
 #endif
 
 #if (MACHINE == SUN_4_60)
-#define NR_BUFS		 512	/* # blocks in the buffer cache (<=1536) */
-#define NR_BUF_HASH	 512	/* size of buf hash table; MUST BE POWER OF 2*/
+#define NR_BUFS		 512	/* # blocks in the buffer cache */
 #endif
 
 #endif	/* _MINIX_SMALL */
@@ -68,7 +68,7 @@
 #define NR_CTRLRS          2
 
 /* Enable or disable the second level file system cache on the RAM disk. */
-#define ENABLE_CACHE2      0
+#define ENABLE_CACHE2      1
 
 /* Enable or disable swapping processes to disk. */
 #define ENABLE_SWAP	   1
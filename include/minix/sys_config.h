@@ -21,6 +21,7 @@
 #define _NR_PROCS	100
 #define _NR_SYS_PROCS	32
 #define _NR_HOLES (2*_NR_PROCS+4)  /* No. of memory holes maintained by PM */
+#define _NR_HOLE_CLASSES 20	   /* No. of hole size classes in PM */
 
 /* Set the CHIP type based on the machine selected. The symbol CHIP is actually
  * indicative of more than just the CPU.  For example, machines for which
@@ -89,10 +89,15 @@ _PROTOTYPE(int sys_memset, (unsigned long pattern,
 		phys_bytes base, phys_bytes bytes));
 
 /* Vectored virtual / physical copy calls. */
-#if DEAD_CODE		/* library part not yet implemented */
-_PROTOTYPE(int sys_virvcopy, (phys_cp_req *vec_ptr,int vec_size,int *nr_ok));
-_PROTOTYPE(int sys_physvcopy, (phys_cp_req *vec_ptr,int vec_size,int *nr_ok));
-#endif
+_PROTOTYPE(int sys_virvcopy, (struct vir_cp_req *vec_ptr, int vec_size,
+	int *nr_ok));
+_PROTOTYPE(int sys_physvcopy, (struct vir_cp_req *vec_ptr, int vec_size,
+	int *nr_ok));
+
+/* Batched asynchronous messages between system processes. */
+_PROTOTYPE(int sys_asynsend, (int dst, message *vec_ptr, int vec_size,
+	int *nr_ok));
+_PROTOTYPE(int sys_asynrecv, (message *vec_ptr, int vec_size, int *nr_ok));
 
 _PROTOTYPE(int sys_umap, (int proc_nr, int seg, vir_bytes vir_addr,
 	 vir_bytes bytes, phys_bytes *phys_addr));
@@ -112,6 +117,8 @@ _PROTOTYPE(int sys_segctl, (int *index, u16_t *seg, vir_bytes *off,
 #define sys_getmonparams(v,vl)	sys_getinfo(GET_MONPARAMS, v,vl, 0,0)
 #define sys_getschedinfo(v1,v2)	sys_getinfo(GET_SCHEDINFO, v1,0, v2,0)
 #define sys_getlocktimings(dst)	sys_getinfo(GET_LOCKTIMING, dst, 0,0,0)
+#define sys_getmfns(dst,n,proc,vir) sys_getinfo(GET_MFNS, dst, \
+	(n) * sizeof(unsigned long), (void *) (vir), proc)
 #define sys_getbiosbuffer(virp, sizep) sys_getinfo(GET_BIOSBUFFER, virp, \
 	sizeof(*virp), sizep, sizeof(*sizep))
 _PROTOTYPE(int sys_getinfo, (int request, void *val_ptr, int val_len,
@@ -50,14 +50,52 @@ struct vir_addr {
 /* Memory allocation by PM. */
 struct hole {
   struct hole *h_next;          /* pointer to next entry on the list */
+  struct hole *h_prev;          /* pointer to previous entry on the list */
+  struct hole *h_bnext;         /* next hole with the same base hash */
+  struct hole *h_enext;         /* next hole with the same end hash */
   phys_clicks h_base;           /* where does the hole begin? */
   phys_clicks h_len;            /* how big is the hole? */
+  int h_class;                  /* size class, i.e., free list of the hole */
 };
 
-/* Memory info from PM. */
+/* Memory info from PM. The last size class is used for the swap area. */
 struct pm_mem_info {
 	struct hole pmi_holes[_NR_HOLES];/* memory (un)allocations */
 	u32_t pmi_hi_watermark;		 /* highest ever-used click + 1 */
+	int pmi_nr_holes;		 /* number of holes on the lists */
+	int pmi_class_holes[_NR_HOLE_CLASSES+1]; /* holes per size class */
+	u32_t pmi_allocs;		 /* number of allocation requests */
+	u32_t pmi_alloc_probes;		 /* holes or lists looked at */
+	u32_t pmi_alloc_fails;		 /* requests that could not be met */
+};
+
+/* File system statistics from FS. The cache counters are indexed by the block
+ * type that is passed to put_block(). Batch sizes and call latencies are kept
+ * in histograms with power of 2 buckets: bucket i counts the values from 2^i
+ * up to 2^(i+1), and the last bucket all larger values. Latencies are in units
+ * of 1024 CPU cycles. All counters only ever increase and wrap around, so a
+ * user subtracts two samples to get the rates.
+ */
+#define _NR_BLOCK_TYPES	7
+#define _NR_FS_BATCH	8
+#define _NR_FS_LATENCY	16
+struct fs_stats {
+	u32_t fss_hits[_NR_BLOCK_TYPES];   /* blocks found in the cache */
+	u32_t fss_misses[_NR_BLOCK_TYPES]; /* blocks that had to be fetched */
+	u32_t fss_demoted;		 /* blocks moved out of protection */
+	u32_t fss_dirty_evicts;		 /* dirty blocks evicted for reuse */
+	u32_t fss_ra_blocks;		 /* blocks read ahead by rahead() */
+	u32_t fss_ra_hits;		 /* of which later found in the cache */
+	u32_t fss_scatter_calls;	 /* rw_scattered() calls */
+	u32_t fss_scatter_blocks;	 /* blocks passed to rw_scattered() */
+	u32_t fss_scatter_xfers;	 /* device transfers done for them */
+	u32_t fss_batch[_NR_FS_BATCH];	 /* rw_scattered() batch sizes */
+	u32_t fss_calls;		 /* requests handled */
+	u32_t fss_call_kcycles;		 /* total time spent on them */
+	u32_t fss_latency[_NR_FS_LATENCY]; /* time per request */
+	int fss_nr_bufs;		 /* buffers in the cache */
+	int fss_protected;		 /* buffers in the protected segment */
+	int fss_dirty;			 /* dirty buffers */
 };
 
 #define phys_cp_req vir_cp_req 
@@ -72,6 +110,15 @@ typedef struct {
   vir_bytes iov_size;		/* sizeof an I/O buffer */
 } iovec_t;
 
+/* Packet descriptor of the batched data link requests DL_READVB and
+ * DL_WRITEVB.  Each describes one packet by its own I/O vector.
+ */
+typedef struct {
+  vir_bytes dlp_iovec;		/* address of the I/O vector of the packet */
+  int dlp_count;		/* number of elements in the I/O vector */
+  vir_bytes dlp_size;		/* DL_READVB: size of the packet received */
+} dl_pack_t;
+
 /* PM passes the address of a structure of this type to KERNEL when
  * sys_sendsig() is invoked as part of the signal catching mechanism.
  * The structure contain all the information that KERNEL needs to build
@@ -105,6 +152,9 @@ struct kinfo {
   char release[6];		/* kernel release number */
   char version[6];		/* kernel version number */
   int relocking;		/* relocking check (for debugging) */
+  unsigned long notify_lookups;	/* receives finding pending notifications */
+  unsigned long notify_scans;	/* bit probes done by those receives */
+  unsigned long sendrec_fast;	/* SENDREC calls handed over directly */
 };
 
 struct machine {
@@ -0,0 +1,39 @@
+/*
+net/gen/buf_stat.h
+
+Statistics about the buffer pools of inet. They can be read from inet as
+the parameter "bf_stat" with NWIOQUERYPARAM.
+*/
+
+#ifndef __SERVER__IP__GEN__BUF_STAT_H__
+#define __SERVER__IP__GEN__BUF_STAT_H__
+
+typedef struct bf_pool_stat
+{
+	u32_t bps_size;		/* Size of a buffer */
+	u32_t bps_nr;		/* Number of buffers in the pool */
+	u32_t bps_inuse;	/* Buffers allocated at the moment */
+	u32_t bps_hiwat;	/* Most buffers ever allocated at once */
+	u32_t bps_allocs;	/* Number of allocations */
+} bf_pool_stat_t;
+
+#define BF_POOL_512	0
+#define BF_POOL_2K	1
+#define BF_POOL_32K	2
+#define BF_POOL_RX	3	/* Receive buffers */
+#define BF_POOL_ACC	4	/* Accessors not tied to a buffer */
+#define BF_POOL_NR	5
+
+#define BF_PRI_NR	10	/* Priorities of bf_freereq calls */
+
+typedef struct bf_stat
+{
+	bf_pool_stat_t bfs_pool[BF_POOL_NR];
+	u32_t bfs_memfail;	/* bf_memreq ran out of buffers */
+	u32_t bfs_accfail;	/* Ran out of accessors */
+	u32_t bfs_rxfail;	/* No receive buffer, used bf_memreq */
+	u32_t bfs_freereq[BF_PRI_NR];	/* Rounds of bf_freereq calls */
+	u32_t bfs_freed;	/* Bytes released by bf_freereq calls */
+} bf_stat_t;
+
+#endif /* __SERVER__IP__GEN__BUF_STAT_H__ */
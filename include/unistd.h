@@ -42,6 +42,7 @@
 #define SI_DMAP_TAB	   3	/* get device <-> driver mappings */
 #define SI_MEM_ALLOC	   4	/* get memory allocation data */
 #define SI_DATA_STORE	   5	/* get copy of data store */
+#define SI_FS_STATS	   6	/* get file system statistics */
 
 /* NULL must be defined in <unistd.h> according to POSIX Sec. 2.7.1. */
 #define NULL    ((void *)0)
@@ -155,6 +156,7 @@ _PROTOTYPE( int mount, (char *_spec, char *_name, int _flag)		);
 _PROTOTYPE( long ptrace, (int _req, pid_t _pid, long _addr, long _data)	);
 _PROTOTYPE( char *sbrk, (int _incr)					);
 _PROTOTYPE( int sync, (void)						);
+_PROTOTYPE( pid_t vfork, (void)						);
 _PROTOTYPE( int fsync, (int fd)						);
 _PROTOTYPE( int umount, (const char *_name)				);
 _PROTOTYPE( int reboot, (int _how, ...)					);
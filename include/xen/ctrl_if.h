@@ -22,5 +22,7 @@ typedef control_msg_t ctrl_msg_t;
 #define CTRLIF_SEND_NOBLOCK           4
 #define CTRLIF_SEND_RESPONSE          5
 #define CTRLIF_NOP                    6
+#define CTRLIF_BIND_EVTCHN            7
+#define CTRLIF_NOTIFY_EVTCHN          8
 
 #endif
@@ -42,6 +42,7 @@
 #define USE_PHYSCOPY  	   1 	/* copy using physical addressing */
 #define USE_PHYSVCOPY  	   1	/* vector with physical copy requests */
 #define USE_MEMSET  	   1	/* write char to a given memory area */
+#define USE_ASYNMSG  	   1	/* batched asynchronous messages */
 
 /* Length of program names stored in the process table. This is only used
  * for the debugging dumps that can be generated with the IS server. The PM
@@ -67,7 +68,13 @@
  */
 #define NR_IRQ_HOOKS	  16		/* number of interrupt hooks */
 #define VDEVIO_BUF_SIZE   64		/* max elements per VDEVIO request */
-#define VCOPY_VEC_SIZE    16		/* max elements per VCOPY request */
+#define VCOPY_VEC_SIZE    64		/* max elements per VCOPY request */
+
+/* Number of asynchronous messages that can be queued for each system process.
+ * The rings are part of the privilege structures, so this costs memory for
+ * each of the NR_SYS_PROCS slots.
+ */
+#define ASYN_RING_SIZE	  16
 
 /* How many bytes for the kernel stack. Space allocated in mpx.s. */
 #define K_STACK_BYTES   4096
@@ -78,6 +85,7 @@
 #define DEBUG_SCHED_CHECK  0	/* sanity check of scheduling queues */
 #define DEBUG_LOCK_CHECK   1	/* kernel lock() sanity check */
 #define DEBUG_TIME_LOCKS   1	/* measure time spent in locks */
+#define DEBUG_IPC_STATS    1	/* count IPC lookups in kinfo */
 
 #endif /* CONFIG_H */
 
@@ -29,6 +29,11 @@ FORWARD _PROTOTYPE(int ctrl_if_register_receiver,
 		   (u8_t type, unsigned int process, unsigned int flags));
 FORWARD _PROTOTYPE(void ctrl_if_unregister_receiver,
 		   (u8_t type, unsigned int process));
+FORWARD _PROTOTYPE(void ctrl_if_evtchn_interrupt, (unsigned int irq, struct stackframe_s *regs));
+FORWARD _PROTOTYPE(int ctrl_if_bind_evtchn,
+		   (unsigned int evtchn, unsigned int process, int caller));
+FORWARD _PROTOTYPE(int ctrl_if_notify_evtchn,
+		   (unsigned int evtchn, int caller));
 FORWARD _PROTOTYPE(void ctrl_if_init, (void));
 
 /* static */
@@ -51,6 +56,9 @@ PRIVATE unsigned int ctrl_if_rxmsg_handler[256];
 /* Primary message type -> callback in process context? */
 PRIVATE unsigned long ctrl_if_rxmsg_blocking_context[256 / sizeof(unsigned long)];
 
+/* Interrupt -> process notified when an event channel bound by it fires. */
+PRIVATE unsigned int ctrl_if_evtchn_handler[NR_IRQS];
+
 /* Queue up messages to be handled in process context. */
 PRIVATE ctrl_msg_t ctrl_if_rxmsg_deferred[CONTROL_RING_SIZE];
 PRIVATE CONTROL_RING_IDX ctrl_if_rxmsg_deferred_prod;
@@ -347,6 +355,70 @@ PRIVATE void ctrl_if_unregister_receiver(u8_t type, unsigned int process)
   ctrl_if_rx_deferred();
 }
 
+/**
+ * Called by hypervisor_callback for an event channel that a device driver
+ * has bound. Tell the driver with a HARD_INT notification.
+ */
+PRIVATE void ctrl_if_evtchn_interrupt(irq, regs)
+     unsigned int irq;
+     struct stackframe_s *regs;
+{
+  lock_notify(HARDWARE, ctrl_if_evtchn_handler[irq]);
+}
+
+/**
+ * Bind an event channel of a device interface to the driver process that
+ * services the interface. Only the driver may bind a channel, only for
+ * itself, and not one that the kernel uses.
+ */
+PRIVATE int ctrl_if_bind_evtchn(evtchn, process, caller)
+     unsigned int evtchn;
+     unsigned int process;
+     int caller;
+{
+  unsigned int irq;
+
+  if (caller != DRVR_PROC_NR || process != caller)
+    return EPERM;
+  if (evtchn >= NR_EVENT_CHANNELS)
+    return EINVAL;
+
+  irq = get_irq_from_evtchn(evtchn);
+  if (irq != (unsigned int) -1) {
+    /* Already bound, by this driver or by the kernel. */
+    return ctrl_if_evtchn_handler[irq] == process ? OK : EPERM;
+  }
+
+  irq = bind_evtchn_to_irq(evtchn);
+  ctrl_if_evtchn_handler[irq] = process;
+  add_irq_handler(irq, ctrl_if_evtchn_interrupt);
+  enable_irq_handler(irq);
+
+  return OK;
+}
+
+/**
+ * Raise an event channel that the calling driver has bound.
+ */
+PRIVATE int ctrl_if_notify_evtchn(evtchn, caller)
+     unsigned int evtchn;
+     int caller;
+{
+  unsigned int irq;
+
+  if (caller != DRVR_PROC_NR)
+    return EPERM;
+  if (evtchn >= NR_EVENT_CHANNELS)
+    return EINVAL;
+
+  irq = get_irq_from_evtchn(evtchn);
+  if (irq == (unsigned int) -1 || ctrl_if_evtchn_handler[irq] != caller)
+    return EPERM;
+
+  notify_evtchn(evtchn);
+  return OK;
+}
+
 /**
  * Initialise the control interface
  */
@@ -357,6 +429,8 @@ PRIVATE void ctrl_if_init()
 
   for (i = 0; i < 256; i++)
     ctrl_if_rxmsg_handler[i] = HANDLER_UNASSIGNED;
+  for (i = 0; i < NR_IRQS; i++)
+    ctrl_if_evtchn_handler[i] = HANDLER_UNASSIGNED;
 
   /* Sync up with shared indexes. */
   ctrl_if_tx_resp_cons = ctrl_if->tx_resp_prod;
@@ -380,12 +454,14 @@ PUBLIC void ctrl_if_task()
    */
   message m;		/* message buffer for both input and output */
   int result = 0;		/* result returned by the handler */
+  int status;			/* status to reply with */
 	
   ctrl_if_init();
 
   while (TRUE) {
     /* Go get a message. */
     receive(ANY, &m);
+    status = 0;
     /*		xen_kprintf("recieving message %x\n", m.m_type);*/
     /* Handle the request. Only clock ticks are expected. */
     switch (m.m_type) {
@@ -420,12 +496,25 @@ PUBLIC void ctrl_if_task()
     case CTRLIF_NOP:
       xen_kprintf(m.m9_msg);
       break;
+    case CTRLIF_BIND_EVTCHN:
+      /*
+	evtchn = m.m5_i1
+	process = m.m5_i2
+      */
+      status = result = ctrl_if_bind_evtchn(m.m5_i1, m.m5_i2, m.m_source);
+      break;
+    case CTRLIF_NOTIFY_EVTCHN:
+      /*
+	evtchn = m.m5_i1
+      */
+      status = result = ctrl_if_notify_evtchn(m.m5_i1, m.m_source);
+      break;
     default:	/* illegal request type */
       xen_kprintf("Message type: %x\n", m.m_type);
     }
 
     if (m.m_type != HARD_INT) {
-      m.m_type = 0;
+      m.m_type = status;
       /*			xen_kprintf("returning message to %x\n", m.m_source);*/
       lock_send(m.m_source, &m);
     }
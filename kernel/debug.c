@@ -130,6 +130,14 @@ check_runqueues(char *when)
 	kprintf("tail and tail->next not null; %s", when);
 		 panic("scheduling error", NO_NUM);
     }
+    if (rdy_head[q] && rdy_head[q]->p_prevready != NIL_PROC) {
+	kprintf("head and head->prev not null; %s", when);
+		 panic("scheduling error", NO_NUM);
+    }
+    if (!rdy_head[q] != !(rdy_map & (1 << q))) {
+	kprintf("ready map out of sync: %s", when);
+		 panic("scheduling error", NO_NUM);
+    }
     for (xp = rdy_head[q]; xp != NIL_PROC;
 	 xp = xp->p_nextready) {
       if (!xp->p_ready) {
@@ -147,6 +155,11 @@ check_runqueues(char *when)
 	panic("proc more than once on scheduling queue", NO_NUM);
       }
       xp->p_found = 1;
+      if (xp->p_nextready != NIL_PROC
+	  && xp->p_nextready->p_prevready != xp) {
+	kprintf("scheduling error: broken back link: %s\n", when);
+	panic("scheduling error", NO_NUM);
+      }
       if (xp->p_nextready == NIL_PROC
 	  && rdy_tail[q] != xp) {
 	kprintf("scheduling error: last element not tail: %s\n", when);
@@ -61,6 +61,17 @@ _PROTOTYPE( void timer_end, (int cat) );
 #define lockcheck
 #endif /* DEBUG_LOCK_CHECK */
 
+/* The IPC statistics count the work done by the message passing code. The
+ * counters are kept in the kinfo structure, so that IS can show them.
+ */
+#if DEBUG_IPC_STATS
+#define ipcstat(f)		(kinfo.f++)
+#define ipcstat_add(f, n)	(kinfo.f += (n))
+#else
+#define ipcstat(f)
+#define ipcstat_add(f, n)
+#endif /* DEBUG_IPC_STATS */
+
 /* This check makes sure that the scheduling queues are in a consistent state.
  * The check is run when the queues are updated with ready() and unready().
  */ 
@@ -352,8 +352,7 @@ _x86_atomic_xchg:
         
 .align 16
 _x86_scan_forward:
-        mov ebx, 4(esp)
-        bsf eax, ebx
+        bsf eax, 4(esp)         ! ebx must be preserved for the C caller
         ret
 
 .align 16
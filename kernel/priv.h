@@ -27,9 +27,14 @@ struct priv {
   long s_call_mask;		/* allowed kernel calls */
 
   sys_map_t s_notify_pending;  	/* bit map with pending notifications */
+  bitchunk_t s_notify_summary;	/* bit per nonempty pending map chunk */
   irq_id_t s_int_pending;	/* pending hardware interrupts */
   sigset_t s_sig_pending;	/* pending signals */
 
+  message s_asyn_ring[ASYN_RING_SIZE];	/* asynchronous messages */
+  short s_asyn_first;		/* oldest message in the ring */
+  short s_asyn_count;		/* number of messages in the ring */
+
   timer_t s_alarm_timer;	/* synchronous alarm timer */ 
   struct far_mem s_farmem[NR_REMOTE_SEGS];  /* remote memory map */
   reg_t *s_stack_guard;		/* stack guard word for kernel tasks */
@@ -44,6 +49,17 @@ struct priv {
 #define SYS_PROC	0x10	/* system processes are privileged */
 #define SENDREC_BUSY	0x20	/* sendrec() in progress */
 
+/* Pending notifications must be set and cleared through these macros, so 
+ * that the summary map over the chunks of s_notify_pending stays in sync.
+ */
+#define set_notify_pending(sp, id) \
+	( set_sys_bit((sp)->s_notify_pending, id), \
+	  (sp)->s_notify_summary |= (1 << ((id) / BITCHUNK_BITS)) )
+#define unset_notify_pending(sp, id) \
+	( unset_sys_bit((sp)->s_notify_pending, id), \
+	  (MAP_CHUNK((sp)->s_notify_pending.chunk, id) == 0 ? \
+	  (sp)->s_notify_summary &= ~(1 << ((id) / BITCHUNK_BITS)) : 0) )
+
 /* Magic system structure table addresses. */
 #define BEG_PRIV_ADDR (&priv[0])
 #define END_PRIV_ADDR (&priv[NR_SYS_PROCS])
@@ -50,10 +50,14 @@ FORWARD _PROTOTYPE( int mini_send, (struct proc *caller_ptr, int dst,
 FORWARD _PROTOTYPE( int mini_receive, (struct proc *caller_ptr, int src,
 		message *m_ptr, unsigned flags));
 FORWARD _PROTOTYPE( int mini_notify, (struct proc *caller_ptr, int dst));
+FORWARD _PROTOTYPE( int sendrec_fast, (struct proc *caller_ptr, int dst,
+		message *m_ptr));
 FORWARD _PROTOTYPE( int deadlock, (int function,
 		register struct proc *caller, int src_dst));
 FORWARD _PROTOTYPE( void enqueue, (struct proc *rp));
 FORWARD _PROTOTYPE( void dequeue, (struct proc *rp));
+FORWARD _PROTOTYPE( void rdy_link, (struct proc *rp));
+FORWARD _PROTOTYPE( int rdy_unlink, (struct proc *rp));
 FORWARD _PROTOTYPE( void sched, (struct proc *rp, int *queue, int *front));
 FORWARD _PROTOTYPE( void pick_proc, (void));
 
@@ -202,6 +206,11 @@ message *m_ptr;			/* pointer to message in the caller's space */
   case SENDREC:
       /* A flag is set so that notifications cannot interrupt SENDREC. */
       priv(caller_ptr)->s_flags |= SENDREC_BUSY;
+      /* Try to hand over directly to a destination that waits for us. */
+      if (! (flags & NON_BLOCKING) &&
+          (result = sendrec_fast(caller_ptr, src_dst, m_ptr)) == OK) {
+          break;
+      }
       /* fall through */
   case SEND:			
       result = mini_send(caller_ptr, src_dst, m_ptr, flags);
@@ -316,18 +325,74 @@ unsigned flags;				/* system call flags */
     caller_ptr->p_rts_flags |= SENDING;
     caller_ptr->p_sendto = dst;
 
-    /* Process is now blocked.  Put in on the destination's queue. */
-    xpp = &dst_ptr->p_caller_q;	/* find end of list */
-    while (*xpp != NIL_PROC)
-      xpp = &(*xpp)->p_q_link;
-    *xpp = caller_ptr;	/* add caller to end */
-    caller_ptr->p_q_link = NIL_PROC;	/* mark new end of list */
+    /* Process is now blocked.  Put in on the destination's queue. The tail
+     * pointer saves a walk over all processes that are already queued.
+     */
+    if (dst_ptr->p_caller_q == NIL_PROC)	/* add to empty queue */
+      dst_ptr->p_caller_q = caller_ptr;
+    else					/* add to end of queue */
+      dst_ptr->p_caller_tail->p_q_link = caller_ptr;
+    dst_ptr->p_caller_tail = caller_ptr;	/* set new queue tail */
+    caller_ptr->p_q_link = NIL_PROC;		/* mark new end of list */
+    if (++dst_ptr->p_caller_len > dst_ptr->p_caller_max)
+      dst_ptr->p_caller_max = dst_ptr->p_caller_len;
   } else {
     return(ENOTREADY);
   }
   return(OK);
 }
 
+/*===========================================================================*
+ *				sendrec_fast				     * 
+ *===========================================================================*/
+PRIVATE int sendrec_fast(caller_ptr, dst, m_ptr)
+register struct proc *caller_ptr;	/* who is doing the SENDREC? */
+int dst;				/* to whom is message being sent? */
+message *m_ptr;				/* pointer to message buffer */
+{
+/* Fast path for the common SENDREC case, where the destination is blocked
+ * in RECEIVE and accepts a message from the caller, such as a server that
+ * waits for a request from ANY. The message is copied, the caller blocks 
+ * for the reply and the destination is made ready to run, with a single 
+ * scheduling decision instead of the checks and queue updates done by 
+ * mini_send() and mini_receive(). The reply needs no special treatment: 
+ * mini_send() copies it directly to the waiting caller. ENOTREADY is 
+ * returned if the normal path must be taken.
+ */
+  register struct proc *dst_ptr = proc_addr(dst);
+
+  if (dst_ptr->p_rts_flags != RECEIVING || caller_ptr->p_rts_flags != 0 ||
+      (dst_ptr->p_getfrom != ANY && dst_ptr->p_getfrom != proc_nr(caller_ptr)))
+      return(ENOTREADY);
+
+  /* Deliver the request. */
+  CopyMess(proc_nr(caller_ptr), caller_ptr, m_ptr, dst_ptr,
+	   dst_ptr->p_messbuf);
+
+  /* Block the caller until the reply arrives. Since the destination was not
+   * sending, there cannot be a message from it on the caller's queue.
+   */
+  caller_ptr->p_getfrom = dst;
+  caller_ptr->p_messbuf = m_ptr;
+  caller_ptr->p_rts_flags = RECEIVING;
+  rdy_unlink(caller_ptr);
+
+  /* Make the destination ready and switch to it, unless a process with a 
+   * higher priority is ready.
+   */
+  dst_ptr->p_rts_flags = 0;
+  rdy_link(dst_ptr);
+  pick_proc();
+
+#if DEBUG_SCHED_CHECK
+  caller_ptr->p_ready = 0;
+  dst_ptr->p_ready = 1;
+  check_runqueues("sendrec_fast");
+#endif
+  ipcstat(sendrec_fast);
+  return(OK);
+}
+
 /*===========================================================================*
  *				mini_receive				     * 
  *===========================================================================*/
@@ -342,11 +407,10 @@ unsigned flags;				/* system call flags */
  * is available block the caller, unless the flags don't allow blocking.  
  */
   register struct proc **xpp;
+  register struct proc *prev_xp;
   struct proc *caller_ptr2;
-  register struct notification **ntf_q_pp;
+  register struct priv *sp;
   message m;
-  int bit_nr;
-  sys_map_t *map;
   bitchunk_t *chunk;
   int i, src_id, src_proc_nr;
 
@@ -356,47 +420,60 @@ unsigned flags;				/* system call flags */
    */
   if (!(caller_ptr->p_rts_flags & SENDING)) {
 
-    /* Check if there are pending notifications, except for SENDREC. */
-    if (! (priv(caller_ptr)->s_flags & SENDREC_BUSY)) {
-
-      map = &priv(caller_ptr)->s_notify_pending;
-      for (chunk = &map->chunk[0];
-	   chunk < &map->chunk[NR_SYS_CHUNKS]; chunk++) {
-
-	/* Find a pending notification from the requested source. */
-	if (!*chunk)
-	  continue;	/* no bits in chunk */
-	for (i = 0; !(*chunk & (1 << i)); ++i) {
-	}	/* look up the bit */
-	src_id = (chunk - &map->chunk[0]) * BITCHUNK_BITS + i;
-	if (src_id >= NR_SYS_PROCS)
-	  break;	/* out of range */
-	src_proc_nr = id_to_nr(src_id);	/* get source proc */
-#if DEBUG_ENABLE_IPC_WARNINGS
-	if (src_proc_nr == NONE) {
-	  xen_kprintf("mini_receive: sending notify from NONE\n");
+    /* Check if there are pending notifications, except for SENDREC. The
+     * summary map has a bit for each nonempty chunk of the pending map, so
+     * the lowest pending source is found with two bit scans. A filtered
+     * receive directly tests the bit of the requested source.
+     */
+    sp = priv(caller_ptr);
+    if (! (sp->s_flags & SENDREC_BUSY) && sp->s_notify_summary != 0) {
+	ipcstat(notify_lookups);
+	src_id = -1;
+	if (src == ANY) {
+	    i = x86_scan_forward(sp->s_notify_summary);
+	    chunk = &sp->s_notify_pending.chunk[i];
+	    src_id = i * BITCHUNK_BITS + x86_scan_forward(*chunk);
+	    ipcstat_add(notify_scans, 2);
+	} else {
+	    i = nr_to_id(src);
+	    if (get_sys_bit(sp->s_notify_pending, i) && id_to_nr(i) == src)
+		src_id = i;
+	    ipcstat(notify_scans);
 	}
+
+	if (src_id >= 0 && src_id < NR_SYS_PROCS) {
+	    src_proc_nr = id_to_nr(src_id);		/* get source proc */
+#if DEBUG_ENABLE_IPC_WARNINGS
+	    if (src_proc_nr == NONE) {
+		xen_kprintf("mini_receive: sending notify from NONE\n");
+	    }
 #endif
-            if (src!=ANY && src!=src_proc_nr) continue;	/* source not ok */
-            *chunk &= ~(1 << i);			/* no longer pending */
+	    unset_notify_pending(sp, src_id);		/* no longer pending */
 
-            /* Found a suitable source, deliver the notification message. */
+	    /* Found a suitable source, deliver the notification message. */
 	    BuildMess(&m, src_proc_nr, caller_ptr);	/* assemble message */
-            CopyMess(src_proc_nr, proc_addr(HARDWARE), &m, caller_ptr, m_ptr);
-            return(OK);					/* report success */
-        }
+	    CopyMess(src_proc_nr, proc_addr(HARDWARE), &m, caller_ptr, m_ptr);
+	    return(OK);					/* report success */
+	}
     }
 
-    /* Check caller queue. Use pointer pointers to keep code simple. */
+    /* Check caller queue. Use pointer pointers to keep code simple. A 
+     * receive from ANY always takes the head of the queue, without a search.
+     */
+    prev_xp = NIL_PROC;
     xpp = &caller_ptr->p_caller_q;
     while (*xpp != NIL_PROC) {
         if (src == ANY || src == proc_nr(*xpp)) {
 	    /* Found acceptable message. Copy it and update status. */
 	    CopyMess((*xpp)->p_nr, *xpp, (*xpp)->p_messbuf, caller_ptr, m_ptr);
             if (((*xpp)->p_rts_flags &= ~SENDING) == 0) enqueue(*xpp);
+            if (*xpp == caller_ptr->p_caller_tail)	/* tail removed */
+                caller_ptr->p_caller_tail = prev_xp;	/* set new tail */
             *xpp = (*xpp)->p_q_link;		/* remove from queue */
+            caller_ptr->p_caller_len --;
             return(OK);				/* report success */
 	}
+	prev_xp = *xpp;				/* save previous in chain */
 	xpp = &(*xpp)->p_q_link;		/* proceed to next */
     }
   }
@@ -466,7 +543,7 @@ int dst;				/* which process to notify */
     dst, dst_ptr, src_id, priv(dst_ptr)->s_notify_pending);
     }*/
 	
-  set_sys_bit(priv(dst_ptr)->s_notify_pending, src_id);
+  set_notify_pending(priv(dst_ptr), src_id);
   /*
     if (dst != CLOCK)
     xen_kprintf("*** set sys bit done ***\n");
@@ -514,34 +591,14 @@ register struct proc *rp;	/* this process is now runnable */
  * The mechanism is implemented here.   The actual scheduling policy is
  * defined in sched() and pick_proc().
  */
-  int q;	 				/* scheduling queue to use */
-  int front;					/* add to front or back */
-
 #if DEBUG_SCHED_CHECK
   check_runqueues("enqueue");
   if (rp->p_ready)
     xen_kprintf("enqueue() already ready process\n");
 #endif
 
-  /* Determine where to insert to process. */
-  sched(rp, &q, &front);
-
-  /* Now add the process to the queue. */
-  if (rdy_head[q] == NIL_PROC) {		/* add to empty queue */
-      rdy_head[q] = rdy_tail[q] = rp; 		/* create a new queue */
-      rp->p_nextready = NIL_PROC;		/* mark new end */
-  } 
-  else if (front) {				/* add to head of queue */
-      rp->p_nextready = rdy_head[q];		/* chain head of queue */
-      rdy_head[q] = rp;				/* set new queue head */
-  } 
-  else {					/* add to tail of queue */
-      rdy_tail[q]->p_nextready = rp;		/* chain tail of queue */	
-      rdy_tail[q] = rp;				/* set new queue tail */
-      rp->p_nextready = NIL_PROC;		/* mark new end */
-  }
-
-  /* Now select the next process to run. */
+  /* Add the process to its queue, then select the next process to run. */
+  rdy_link(rp);
   pick_proc();			
 
 #if DEBUG_SCHED_CHECK
@@ -560,9 +617,6 @@ register struct proc *rp;	/* this process is no longer runnable */
  * it has blocked.  If the currently active process is removed, a new process
  * is picked to run by calling pick_proc().
  */
-  register int q = rp->p_priority;		/* queue to use */
-  register struct proc **xpp;			/* iterate over queue */
-  register struct proc *prev_xp;
 
   /* Side-effect for kernel: check if the task's stack still is ok? */
   if (iskernelp(rp)) { 				
@@ -578,22 +632,11 @@ register struct proc *rp;	/* this process is no longer runnable */
 #endif
 
   /* Now make sure that the process is not in its ready queue. Remove the 
-   * process if it is found. A process can be made unready even if it is not 
+   * process if it is on it. A process can be made unready even if it is not 
    * running by being sent a signal that kills it.
    */
-  prev_xp = NIL_PROC;				
-  for (xpp = &rdy_head[q]; *xpp != NIL_PROC; xpp = &(*xpp)->p_nextready) {
-
-      if (*xpp == rp) {				/* found process to remove */
-          *xpp = (*xpp)->p_nextready;		/* replace with next chain */
-          if (rp == rdy_tail[q])		/* queue tail removed */
-              rdy_tail[q] = prev_xp;		/* set new tail */
-          if (rp == proc_ptr || rp == next_ptr)	/* active process removed */
-              pick_proc();			/* pick new process to run */
-          break;
-      }
-      prev_xp = *xpp;				/* save previous in chain */
-  }
+  if (rdy_unlink(rp) && (rp == proc_ptr || rp == next_ptr))
+      pick_proc();				/* active process removed */
   
 #if DEBUG_SCHED_CHECK
   rp->p_ready = 0;
@@ -601,6 +644,71 @@ register struct proc *rp;	/* this process is no longer runnable */
 #endif
 }
 
+/*===========================================================================*
+ *				rdy_link				     * 
+ *===========================================================================*/
+PRIVATE void rdy_link(rp)
+register struct proc *rp;	/* this process is now runnable */
+{
+/* Insert 'rp' in the scheduling queue chosen by sched(), without picking a
+ * new process to run. 
+ */
+  int q;	 				/* scheduling queue to use */
+  int front;					/* add to front or back */
+
+  /* Determine where to insert to process. */
+  sched(rp, &q, &front);
+
+  /* Now add the process to the queue. The ready lists are doubly linked and
+   * a bit is set in the ready map for each nonempty queue.
+   */
+  if (rdy_head[q] == NIL_PROC) {		/* add to empty queue */
+      rdy_head[q] = rdy_tail[q] = rp; 		/* create a new queue */
+      rp->p_nextready = rp->p_prevready = NIL_PROC; /* mark new end */
+      rdy_map |= (1 << q);			/* queue is now nonempty */
+  } 
+  else if (front) {				/* add to head of queue */
+      rp->p_nextready = rdy_head[q];		/* chain head of queue */
+      rp->p_prevready = NIL_PROC;
+      rdy_head[q]->p_prevready = rp;
+      rdy_head[q] = rp;				/* set new queue head */
+  } 
+  else {					/* add to tail of queue */
+      rdy_tail[q]->p_nextready = rp;		/* chain tail of queue */	
+      rp->p_prevready = rdy_tail[q];
+      rdy_tail[q] = rp;				/* set new queue tail */
+      rp->p_nextready = NIL_PROC;		/* mark new end */
+  }
+}
+
+/*===========================================================================*
+ *				rdy_unlink				     * 
+ *===========================================================================*/
+PRIVATE int rdy_unlink(rp)
+register struct proc *rp;	/* this process is no longer runnable */
+{
+/* Remove 'rp' from its scheduling queue, without picking a new process to 
+ * run. Only the queue head has no predecessor, so that tells whether the 
+ * process is queued at all. Return TRUE if it was removed.
+ */
+  register int q = rp->p_priority;		/* queue to use */
+
+  if (rp->p_prevready == NIL_PROC && rdy_head[q] != rp) return(FALSE);
+
+  if (rp->p_prevready != NIL_PROC)		/* unlink from predecessor */
+      rp->p_prevready->p_nextready = rp->p_nextready;
+  else						/* queue head removed */
+      rdy_head[q] = rp->p_nextready;
+  if (rp->p_nextready != NIL_PROC)		/* unlink from successor */
+      rp->p_nextready->p_prevready = rp->p_prevready;
+  else						/* queue tail removed */
+      rdy_tail[q] = rp->p_prevready;
+  rp->p_nextready = rp->p_prevready = NIL_PROC;
+  if (rdy_head[q] == NIL_PROC)			/* queue is now empty */
+      rdy_map &= ~(1 << q);
+  return(TRUE);
+}
+
 /*===========================================================================*
  *				sched					     * 
  *===========================================================================*/
@@ -659,20 +767,19 @@ PRIVATE void pick_proc()
  * clock task can tell who to bill for system time.
  */
   register struct proc *rp;			/* process to run */
-  int q;					/* iterate over queues */
+  int q;					/* highest nonempty queue */
 
-  /* Check each of the scheduling queues for ready processes. The number of
-   * queues is defined in proc.h, and priorities are set in the task table.
-   * The lowest queue contains IDLE, which is always ready.
+  /* The ready map has a bit for each of the scheduling queues with ready
+   * processes, so the highest priority queue is found with a single bit
+   * scan. The number of queues is defined in proc.h, and priorities are set
+   * in the task table. The lowest queue contains IDLE, which is always ready.
    */
-  for (q=0; q < NR_SCHED_QUEUES; q++) {	
-      if ( (rp = rdy_head[q]) != NIL_PROC) {
-          next_ptr = rp;			/* run process 'rp' next */
-          if (priv(rp)->s_flags & BILLABLE)	 	
-              bill_ptr = rp;			/* bill for system time */
-          return;				 
-      }
-  }
+  if (rdy_map == 0) return;			/* nothing is ready */
+  q = x86_scan_forward(rdy_map);
+  rp = rdy_head[q];
+  next_ptr = rp;				/* run process 'rp' next */
+  if (priv(rp)->s_flags & BILLABLE)	 	
+      bill_ptr = rp;				/* bill for system time */
 }
 
 /*===========================================================================*
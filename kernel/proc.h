@@ -44,8 +44,12 @@ struct proc {
   clock_t p_sys_time;		/* sys time in ticks */
 
   struct proc *p_nextready;	/* pointer to next ready process */
+  struct proc *p_prevready;	/* pointer to previous ready process */
   struct proc *p_caller_q;	/* head of list of procs wishing to send */
+  struct proc *p_caller_tail;	/* tail of list of procs wishing to send */
   struct proc *p_q_link;	/* link to next proc wishing to send */
+  short p_caller_len;		/* number of procs on the caller queue */
+  short p_caller_max;		/* high-water mark of p_caller_len */
   message *p_messbuf;		/* pointer to passed message buffer */
   proc_nr_t p_getfrom;		/* from whom does process want to receive? */
   proc_nr_t p_sendto;		/* to whom does process want to send? */
@@ -112,5 +116,6 @@ EXTERN struct proc proc[NR_TASKS + NR_PROCS];	/* process table */
 EXTERN struct proc *pproc_addr[NR_TASKS + NR_PROCS];
 EXTERN struct proc *rdy_head[NR_SCHED_QUEUES]; /* ptrs to ready list headers */
 EXTERN struct proc *rdy_tail[NR_SCHED_QUEUES]; /* ptrs to ready list tails */
+EXTERN unsigned rdy_map;			/* bit set for nonempty queues */
 
 #endif /* PROC_H */
@@ -182,6 +182,10 @@ PRIVATE void initialize(void)
   map(SYS_ABORT, do_abort);		/* abort MINIX */
   map(SYS_GETINFO, do_getinfo); 	/* request system information */ 
   map(SYS_IOPENABLE, do_iopenable); 	/* Enable I/O */
+
+  /* Asynchronous messages. */
+  map(SYS_ASYNSEND, do_asynsend);	/* post a vector of messages */
+  map(SYS_ASYNRECV, do_asynrecv);	/* drain queued messages */
 }
 
 /*===========================================================================*
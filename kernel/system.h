@@ -171,5 +171,12 @@ _PROTOTYPE( int do_setalarm, (message *m_ptr) );
 
 _PROTOTYPE( int do_iopenable, (message *m_ptr) );	
 
+_PROTOTYPE( int do_asynsend, (message *m_ptr) );	
+_PROTOTYPE( int do_asynrecv, (message *m_ptr) );	
+#if ! USE_ASYNMSG
+#define do_asynsend do_unused
+#define do_asynrecv do_unused
+#endif
+
 #endif	/* SYSTEM_H */
 
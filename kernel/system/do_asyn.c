@@ -0,0 +1,137 @@
+/* The kernel calls implemented in this file:
+ *   m_type:	SYS_ASYNSEND, SYS_ASYNRECV
+ *
+ * The parameters for these kernel calls are:
+ *    m1_i1:	ASYN_PROC_NR		destination process (SYS_ASYNSEND)
+ *    m1_i3:	ASYN_VEC_SIZE		number of messages in vector
+ *    m1_p1:	ASYN_VEC_ADDR		address of message vector at caller
+ *    m1_i2:	ASYN_NR_OK		number of messages posted or received
+ *
+ * Each system process has a ring of asynchronous messages in its privilege
+ * structure. SYS_ASYNSEND appends a vector of messages to the ring of the 
+ * destination and notifies the destination on behalf of the caller. The 
+ * destination drains its ring with SYS_ASYNRECV, in a single kernel call
+ * for all messages that are queued. 
+ */
+
+#include "../system.h"
+
+#if USE_ASYNMSG
+
+FORWARD _PROTOTYPE( void ring_copy, (struct priv *sp, phys_bytes user_phys,
+		int first, int nr_msgs, int direction)			);
+
+/*===========================================================================*
+ *				do_asynsend				     *
+ *===========================================================================*/
+PUBLIC int do_asynsend(m_ptr)
+register message *m_ptr;	/* pointer to request message */
+{
+/* Handle sys_asynsend(). Post as many messages from the caller's vector as
+ * fit in the destination's ring. The number of messages posted is returned,
+ * so that the caller can retry with the rest later.
+ */
+  int caller, dst, nr_msgs, slot;
+  struct priv *sp;
+  phys_bytes caller_phys;
+
+  caller = m_ptr->m_source;
+  dst = m_ptr->ASYN_PROC_NR;
+  nr_msgs = m_ptr->ASYN_VEC_SIZE;
+  if (dst == SELF) dst = caller;
+  if (! isokprocn(dst) || iskerneln(dst) || isemptyn(dst)) return(EINVAL);
+  if (nr_msgs < 0) return(EINVAL);
+
+  /* Only system processes have a ring; it must be allowed to send to it. */
+  sp = priv(proc_addr(dst));
+  if (! (sp->s_flags & SYS_PROC)) return(EPERM);
+  if (! get_sys_bit(priv(proc_addr(caller))->s_ipc_to, sp->s_id))
+      return(ECALLDENIED);
+
+  /* An empty vector posts nothing and need not be mapped. */
+  m_ptr->ASYN_NR_OK = 0;
+  if (nr_msgs == 0) return(OK);
+
+  caller_phys = umap_local(proc_addr(caller), D,
+      (vir_bytes) m_ptr->ASYN_VEC_ADDR, (vir_bytes) nr_msgs * sizeof(message));
+  if (caller_phys == 0) return(EFAULT);
+
+  /* Append the messages that fit and stamp them with the caller. */
+  if (nr_msgs > ASYN_RING_SIZE - sp->s_asyn_count)
+      nr_msgs = ASYN_RING_SIZE - sp->s_asyn_count;
+  slot = (sp->s_asyn_first + sp->s_asyn_count) % ASYN_RING_SIZE;
+  ring_copy(sp, caller_phys, slot, nr_msgs, _DST_);
+  sp->s_asyn_count += nr_msgs;
+  for (m_ptr->ASYN_NR_OK = nr_msgs; nr_msgs > 0; nr_msgs --) {
+      sp->s_asyn_ring[slot].m_source = caller;
+      slot = (slot + 1) % ASYN_RING_SIZE;
+  }
+
+  /* Let the destination know that there is work, if anything was posted. */
+  if (m_ptr->ASYN_NR_OK > 0) lock_notify(caller, dst);
+  return(OK);
+}
+
+/*===========================================================================*
+ *				do_asynrecv				     *
+ *===========================================================================*/
+PUBLIC int do_asynrecv(m_ptr)
+register message *m_ptr;	/* pointer to request message */
+{
+/* Handle sys_asynrecv(). Move as many messages from the caller's own ring
+ * as fit in the caller's vector, oldest first. 
+ */
+  int caller, nr_msgs;
+  struct priv *sp;
+  phys_bytes caller_phys;
+
+  caller = m_ptr->m_source;
+  nr_msgs = m_ptr->ASYN_VEC_SIZE;
+  sp = priv(proc_addr(caller));
+  if (! (sp->s_flags & SYS_PROC)) return(EPERM);
+  if (nr_msgs < 0) return(EINVAL);
+  if (nr_msgs > sp->s_asyn_count) nr_msgs = sp->s_asyn_count;
+  m_ptr->ASYN_NR_OK = 0;
+  if (nr_msgs == 0) return(OK);
+
+  caller_phys = umap_local(proc_addr(caller), D,
+      (vir_bytes) m_ptr->ASYN_VEC_ADDR, (vir_bytes) nr_msgs * sizeof(message));
+  if (caller_phys == 0) return(EFAULT);
+
+  ring_copy(sp, caller_phys, sp->s_asyn_first, nr_msgs, _SRC_);
+  sp->s_asyn_first = (sp->s_asyn_first + nr_msgs) % ASYN_RING_SIZE;
+  sp->s_asyn_count -= nr_msgs;
+  m_ptr->ASYN_NR_OK = nr_msgs;
+  return(OK);
+}
+
+/*===========================================================================*
+ *				ring_copy				     *
+ *===========================================================================*/
+PRIVATE void ring_copy(sp, user_phys, first, nr_msgs, direction)
+struct priv *sp;		/* privilege structure with the ring */
+phys_bytes user_phys;		/* physical address of user vector */
+int first;			/* first ring slot to copy */
+int nr_msgs;			/* number of messages to copy */
+int direction;			/* _DST_ to ring or _SRC_ from ring */
+{
+/* Copy messages between a user vector and a ring. The ring wraps around at
+ * most once, so at most two copies are needed.
+ */
+  int run;
+  phys_bytes ring_phys, bytes;
+
+  while (nr_msgs > 0) {
+      run = ASYN_RING_SIZE - first;
+      if (run > nr_msgs) run = nr_msgs;
+      ring_phys = vir2phys(&sp->s_asyn_ring[first]);
+      bytes = (phys_bytes) run * sizeof(message);
+      if (direction == _DST_) phys_copy(user_phys, ring_phys, bytes);
+      else                    phys_copy(ring_phys, user_phys, bytes);
+      user_phys += bytes;
+      nr_msgs -= run;
+      first = 0;
+  }
+}
+
+#endif /* USE_ASYNMSG */
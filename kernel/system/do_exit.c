@@ -48,6 +48,7 @@ register struct proc *rc;		/* slot of process to clean up */
 {
   register struct proc *rp;		/* iterate over process table */
   register struct proc **xpp;		/* iterate over caller queue */
+  struct proc *prev_xp, *dst_ptr;	/* previous in queue, destination */
   int i;
   int sys_id;
   char saved_rts_flags;
@@ -75,16 +76,22 @@ register struct proc *rc;		/* slot of process to clean up */
    * a normal exit), then it must be removed from the message queues.
    */
   if (saved_rts_flags & SENDING) {
-      xpp = &proc[rc->p_sendto].p_caller_q;	/* destination's queue */
+      dst_ptr = proc_addr(rc->p_sendto);
+      prev_xp = NIL_PROC;
+      xpp = &dst_ptr->p_caller_q;		/* destination's queue */
       while (*xpp != NIL_PROC) {		/* check entire queue */
           if (*xpp == rc) {			/* process is on the queue */
+              if (rc == dst_ptr->p_caller_tail)	/* queue tail removed */
+                  dst_ptr->p_caller_tail = prev_xp;
               *xpp = (*xpp)->p_q_link;		/* replace by next process */
+              dst_ptr->p_caller_len --;
 #if DEBUG_ENABLE_IPC_WARNINGS
 	      kprintf("Proc %d removed from queue at %d\n",
 	          proc_nr(rc), rc->p_sendto);
 #endif
               break;				/* can only be queued once */
           }
+          prev_xp = *xpp;			/* save previous in chain */
           xpp = &(*xpp)->p_q_link;		/* proceed to next queued */
       }
   }
@@ -98,7 +105,7 @@ register struct proc *rc;		/* slot of process to clean up */
 	continue;
 
       /* Unset pending notification bits. */
-      unset_sys_bit(priv(rp)->s_notify_pending, priv(rc)->s_id);
+      unset_notify_pending(priv(rp), priv(rc)->s_id);
 
       /* Check if process is receiving from exiting process. */
       if ((rp->p_rts_flags & RECEIVING) && rp->p_getfrom == proc_nr(rc)) {
@@ -119,6 +126,10 @@ register struct proc *rc;		/* slot of process to clean up */
       } 
   }
 
+  /* All processes that were queued to send to the exiting one are released. */
+  rc->p_caller_q = rc->p_caller_tail = NIL_PROC;
+  rc->p_caller_len = 0;
+
   /* Check the table with IRQ hooks to see if hooks should be released. */
   for (i=0; i < NR_IRQ_HOOKS; i++) {
       if (irq_hooks[i].proc_nr == proc_nr(rc)) {
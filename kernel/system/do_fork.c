@@ -59,6 +59,10 @@ register message *m_ptr;	/* pointer to request message */
   rpc->p_user_time = 0;		/* set all the accounting times to 0 */
   rpc->p_sys_time = 0;
 
+  rpc->p_nextready = rpc->p_prevready = NIL_PROC;   /* not on a ready list */
+  rpc->p_caller_q = rpc->p_caller_tail = NIL_PROC;  /* no queued callers */
+  rpc->p_caller_len = rpc->p_caller_max = 0;
+
   /* Parent and child have to share the quantum that the forked process had,
    * so that queued processes do not have to wait longer because of the fork.
    * If the time left is odd, the child gets an extra tick.
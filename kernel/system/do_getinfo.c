@@ -14,6 +14,7 @@
 #include <xen/xen.h>
 
 static unsigned long bios_buf[1024];	/* 4K, what about alignment */
+static unsigned long mfns[MFNS_MAX_PAGES];	/* GET_MFNS result */
 static vir_bytes bios_buf_vir, bios_buf_len;
 
 #if USE_GETINFO
@@ -108,6 +109,34 @@ message *m_ptr;			/* pointer to request message */
 				    paddr));*/
       break;
     }
+    case GET_MFNS: {
+      /* Look up the machine address of each page that a range of a process
+       * touches. The first address includes the offset of the range in its
+       * page. The number of pages follows from the length expected. Like
+       * GET_VTOM this is only for the caller's own memory, except that the
+       * block driver may ask for the buffers of the processes it serves,
+       * because it hands their frames to the backend to transfer into.
+       */
+      nr = m_ptr->I_VAL_LEN / sizeof(mfns[0]);
+      proc_nr = m_ptr->I_VAL_LEN2;
+      if (nr <= 0 || nr > MFNS_MAX_PAGES || !isokprocn(proc_nr))
+	return (EINVAL);
+      if (proc_nr != m_ptr->m_source && m_ptr->m_source != DRVR_PROC_NR)
+	return (EPERM);
+      paddr = (vir_bytes) m_ptr->I_VAL_PTR2 % PAGE_SIZE;
+      paddr = numap_local(proc_nr, (vir_bytes) m_ptr->I_VAL_PTR2,
+			  nr * PAGE_SIZE - paddr);
+      if (paddr == 0) return (EFAULT);
+      for (foo = 0; foo < nr; foo++) {
+	mfns[foo] = *((unsigned long *) si->mfn_list
+		      + (paddr >> PAGE_SHIFT) + foo) << PAGE_SHIFT;
+      }
+      mfns[0] |= paddr % PAGE_SIZE;
+
+      length = nr * sizeof(mfns[0]);
+      src_phys = vir2phys(mfns);
+      break;
+    }
     case GET_MONPARAMS: {
         src_phys = kinfo.params_base;		/* already is a physical */
         length = kinfo.params_size;
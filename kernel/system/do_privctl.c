@@ -54,6 +54,8 @@ message *m_ptr;			/* pointer to request message */
 
   for (i=0; i< BITMAP_CHUNKS(NR_SYS_PROCS); i++)	/* remove pending: */
       priv(rp)->s_notify_pending.chunk[i] = 0;		/* - notifications */
+  priv(rp)->s_notify_summary = 0;
+  priv(rp)->s_asyn_first = priv(rp)->s_asyn_count = 0;	/* - messages */
   priv(rp)->s_int_pending = 0;				/* - interrupts */
   sigemptyset(&priv(rp)->s_sig_pending);		/* - signals */
 
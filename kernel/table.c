@@ -81,7 +81,7 @@ PUBLIC char *t_stack[TOT_STACK_SPACE / sizeof(char *)];
 #define DS_C	~0
 #define IS_C    ~0
 #define PM_C	~(c(SYS_DEVIO) | c(SYS_SDEVIO) | c(SYS_VDEVIO) | c(SYS_IRQCTL) | c(SYS_INT86))
-#define FS_C	(c(SYS_KILL) | c(SYS_VIRCOPY) | c(SYS_VIRVCOPY) | c(SYS_UMAP) | c(SYS_GETINFO) | c(SYS_EXIT) | c(SYS_TIMES) | c(SYS_SETALARM))
+#define FS_C	(c(SYS_KILL) | c(SYS_VIRCOPY) | c(SYS_VIRVCOPY) | c(SYS_UMAP) | c(SYS_GETINFO) | c(SYS_EXIT) | c(SYS_TIMES) | c(SYS_SETALARM) | c(SYS_ASYNSEND) | c(SYS_ASYNRECV))
 #define DRV_C	(FS_C | c(SYS_SEGCTL) | c(SYS_IRQCTL) | c(SYS_INT86) | c(SYS_DEVIO) | c(SYS_VDEVIO) | c(SYS_SDEVIO)) 
 #define TTY_C (DRV_C | c(SYS_ABORT))
 #define MEM_C	(DRV_C | c(SYS_PHYSCOPY) | c(SYS_PHYSVCOPY))
@@ -127,7 +127,8 @@ PUBLIC struct boot_image image[] = {
 
 /* Verify the size of the system image table at compile time. Also verify that 
  * the first chunk of the ipc mask has enough bits to accommodate the processes
- * in the image.  
+ * in the image, that the pending notifications summary has a bit for each
+ * chunk of the pending map, and that the ready map has a bit for each queue.
  * If a problem is detected, the size of the 'dummy' array will be negative, 
  * causing a compile time error. Note that no space is actually allocated 
  * because 'dummy' is declared extern.
@@ -135,4 +136,6 @@ PUBLIC struct boot_image image[] = {
 extern int dummy[(NR_BOOT_PROCS==sizeof(image)/
 	sizeof(struct boot_image))?1:-1];
 extern int dummy[(BITCHUNK_BITS > NR_BOOT_PROCS - 1) ? 1 : -1];
+extern int dummy[(BITCHUNK_BITS >= NR_SYS_CHUNKS) ? 1 : -1];
+extern int dummy[(sizeof(rdy_map) * CHAR_BIT >= NR_SCHED_QUEUES) ? 1 : -1];
 
@@ -0,0 +1,21 @@
+! read_tsc.s
+!
+! void read_tsc(unsigned long *high, unsigned long *low);
+!	Read the cycle counter of the CPU.  Pentium and up, the caller must
+!	check the processor type first.  The kernel keeps its own copy in
+!	klib386.s and klibxen.s.
+
+.sect .text; .sect .rom; .sect .data; .sect .bss
+
+.sect .text
+.define _read_tsc
+_read_tsc:
+.data1 0x0f		! this is the RDTSC instruction
+.data1 0x31		! it places the TSC in EDX:EAX
+	push	ebp
+	mov	ebp, 8(esp)
+	mov	(ebp), edx
+	mov	ebp, 12(esp)
+	mov	(ebp), eax
+	pop	ebp
+	ret
@@ -0,0 +1,45 @@
+! vfork() is like fork(), but the child borrows the core image of the parent,
+! which stays suspended until the child does an exec or exits.  The child runs
+! on the parent's stack, so the return address goes into a register, which
+! the kernel keeps for each process, and the trap is made here instead of
+! through __sendrec.  The caller's ebx and the message are kept on the stack
+! where the return address was, not in globals that a vfork in the child
+! would overwrite.  The child returns with its stack pointer below them, so
+! nothing it pushes can reach the ebx that the parent restores later.  A
+! caller with a frame pointer, as every ACK function has, does not notice.
+.sect .text; .sect .rom; .sect .data; .sect .bss
+.define __vfork
+.extern _errno
+
+MM = 0				! PM_PROC_NR, see <minix/com.h>
+VFORK = 78			! see <minix/callnr.h>
+SENDREC = 3			! see src/kernel/ipc.h
+SYSVEC = 33			! trap to kernel
+M_TYPE = 4			! offset of m_type in a message
+MESS_SIZE = 36			! sizeof(message)
+
+.sect .text
+__vfork:
+	pop	edx			! return address, off the shared stack
+	push	ebx			! ebx is callee-saved
+	sub	esp, MESS_SIZE
+	mov	ebx, esp		! ebx = message pointer
+	mov	M_TYPE(ebx), VFORK
+	mov	eax, MM			! eax = dest-src
+	mov	ecx, SENDREC		! _sendrec(MM, &mess)
+	int	SYSVEC			! trap to the kernel
+	test	eax, eax		! did the trap itself fail?
+	jnz	0f
+	mov	eax, M_TYPE(ebx)	! result: 0 in child, pid in parent
+	test	eax, eax
+	jz	2f
+	jns	1f
+0:	neg	eax			! errno = -result
+	mov	(_errno), eax
+	mov	eax, -1
+1:	add	esp, MESS_SIZE		! parent: drop the message
+	pop	ebx
+	jmp	edx
+
+2:	mov	ebx, MESS_SIZE(esp)	! child: keep the stack as it is
+	jmp	edx
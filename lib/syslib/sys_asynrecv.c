@@ -0,0 +1,22 @@
+#include "syslib.h"
+
+/*===========================================================================*
+ *                                sys_asynrecv				     *
+ *===========================================================================*/
+PUBLIC int sys_asynrecv(vec_ptr, vec_size, nr_ok)
+message *vec_ptr;			/* vector to store messages */
+int vec_size;				/* number of messages that fit */
+int *nr_ok;				/* return: number of messages received */
+{
+/* Drain messages from the caller's asynchronous ring, oldest first. Each
+ * message has its m_source set to the process that posted it.
+ */
+  message m;
+  int result;
+
+  m.ASYN_VEC_ADDR = (char *) vec_ptr;
+  m.ASYN_VEC_SIZE = vec_size;
+  result = _taskcall(SYSTASK, SYS_ASYNRECV, &m);
+  if (nr_ok != NULL) *nr_ok = (result == OK) ? m.ASYN_NR_OK : 0;
+  return(result);
+}
@@ -0,0 +1,25 @@
+#include "syslib.h"
+
+/*===========================================================================*
+ *                                sys_asynsend				     *
+ *===========================================================================*/
+PUBLIC int sys_asynsend(dst, vec_ptr, vec_size, nr_ok)
+int dst;				/* process to send to, or SELF */
+message *vec_ptr;			/* vector with messages */
+int vec_size;				/* number of messages in vector */
+int *nr_ok;				/* return: number of messages posted */
+{
+/* Post a vector of messages to the asynchronous ring of a system process. 
+ * Only as many messages as fit in the ring are posted; the rest should be
+ * sent again later. The destination is notified on behalf of the caller.
+ */
+  message m;
+  int result;
+
+  m.ASYN_PROC_NR = dst;
+  m.ASYN_VEC_ADDR = (char *) vec_ptr;
+  m.ASYN_VEC_SIZE = vec_size;
+  result = _taskcall(SYSTASK, SYS_ASYNSEND, &m);
+  if (nr_ok != NULL) *nr_ok = (result == OK) ? m.ASYN_NR_OK : 0;
+  return(result);
+}
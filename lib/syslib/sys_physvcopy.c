@@ -0,0 +1,23 @@
+#include "syslib.h"
+
+/*===========================================================================*
+ *                                sys_physvcopy				     *
+ *===========================================================================*/
+PUBLIC int sys_physvcopy(vec_ptr, vec_size, nr_ok)
+struct vir_cp_req *vec_ptr;		/* vector with copy requests */
+int vec_size;				/* number of requests in vector */
+int *nr_ok;				/* return: number of copies done */
+{
+/* Have the kernel do a vector of physical copies with a single call. The
+ * copies are done in order, and the first one that fails stops the rest.
+ */
+  message m;
+  int result;
+
+  m.VCP_VEC_ADDR = (char *) vec_ptr;
+  m.VCP_VEC_SIZE = vec_size;
+  m.VCP_NR_OK = 0;
+  result = _taskcall(SYSTASK, SYS_PHYSVCOPY, &m);
+  if (nr_ok != NULL) *nr_ok = m.VCP_NR_OK;
+  return(result);
+}
@@ -9,14 +9,32 @@
  * front of the list, if it will probably not be needed soon.  If a block
  * is modified, the modifying routine must set b_dirt to DIRTY, so the block
  * will eventually be rewritten to the disk.
+ *
+ * The LRU list is split in two segments, so that reading a large file once
+ * cannot push the file system's own metadata out of the cache.  Inode,
+ * directory, indirect and map blocks are released into the protected
+ * segment, which has its own chain from 'pfront' to 'prear'.  Data blocks go
+ * into the probationary segment from 'front' to 'rear'.  A buffer is only
+ * taken from the protected segment when the probationary one is empty.  When
+ * the protected segment holds more than PROT_MAX buffers, its least recently
+ * used block is demoted to the rear of the probationary segment.
+ *
+ * Dirty blocks are not left until they are evicted.  When a dirty block is
+ * released, put_block() notes in which write behind period that happened.
+ * Blocks that have been dirty for WB_AGE periods are written by a timer, and
+ * when more than WB_HIGH_WATER blocks are dirty they are written after the
+ * reply to the current request, so evicting a block seldom waits for the disk.
+ *
+ * The buffers are allocated by buf_pool() when FS starts. The boot parameter
+ * 'bufcache' gives the size of their data in kB. The data is cut into buffers
+ * of the largest block size that is in use, so a file system with small
+ * blocks gets more buffers out of the same memory.
  */
 
 #include <sys/dir.h>			/* need struct direct */
 #include <dirent.h>
 
-EXTERN struct buf {
-  /* Data portion of the buffer. */
-  union {
+union fsdata_u {
     char b__data[MAX_BLOCK_SIZE];		     /* ordinary user data */
 /* directory block */
     struct direct b__dir[NR_DIR_ENTRIES(MAX_BLOCK_SIZE)];    
@@ -30,7 +48,11 @@ EXTERN struct buf {
     d2_inode b__v2_ino[V2_INODES_PER_BLOCK(MAX_BLOCK_SIZE)]; 
 /* bit map block */
     bitchunk_t b__bitmap[FS_BITMAP_CHUNKS(MAX_BLOCK_SIZE)];  
-  } b;
+};
+
+EXTERN struct buf {
+  /* Data portion of the buffer, only buf_size bytes of which exist. */
+  union fsdata_u *b_blk;
 
   /* Header portion of the buffer. */
   struct buf *b_next;		/* used to link all free bufs in a chain */
@@ -40,26 +62,47 @@ EXTERN struct buf {
   dev_t b_dev;			/* major | minor device where block resides */
   char b_dirt;			/* CLEAN or DIRTY */
   char b_count;			/* number of users of this buffer */
-} buf[NR_BUFS];
+  long b_dirtied;		/* write behind period it was dirtied in, or 0 */
+  char b_seg;			/* PROBATION or PROTECTED segment of LRU */
+  char b_type;			/* block type at last release, or NO_TYPE */
+  char b_prefetched;		/* read ahead, and not asked for since */
+} *buf;				/* nr_bufs buffers */
 
 /* A block is free if b_dev == NO_DEV. */
 
 #define NIL_BUF ((struct buf *) 0)	/* indicates absence of a buffer */
 
-/* These defs make it possible to use to bp->b_data instead of bp->b.b__data */
-#define b_data   b.b__data
-#define b_dir    b.b__dir
-#define b_v1_ind b.b__v1_ind
-#define b_v2_ind b.b__v2_ind
-#define b_v1_ino b.b__v1_ino
-#define b_v2_ino b.b__v2_ino
-#define b_bitmap b.b__bitmap
+/* These defs make it possible to use bp->b_data instead of bp->b_blk->b__data */
+#define b_data   b_blk->b__data
+#define b_dir    b_blk->b__dir
+#define b_v1_ind b_blk->b__v1_ind
+#define b_v2_ind b_blk->b__v2_ind
+#define b_v1_ino b_blk->b__v1_ino
+#define b_v2_ino b_blk->b__v2_ino
+#define b_bitmap b_blk->b__bitmap
 
-EXTERN struct buf *buf_hash[NR_BUF_HASH];	/* the buffer hash table */
+EXTERN struct buf **buf_hash;	/* the buffer hash table */
+EXTERN int nr_buf_hash;		/* size of buf hash table, a power of 2 */
+EXTERN int nr_bufs;		/* # buffers the data is currently cut into */
+EXTERN int max_bufs;		/* # buffer headers, enough for MIN_BLOCK_SIZE */
+EXTERN int buf_size;		/* size of the data of each buffer */
+EXTERN char *buf_data;		/* the data of all buffers */
+EXTERN long buf_bytes;		/* size of buf_data */
+EXTERN struct buf **dirty_q;	/* max_bufs entries, used by flushall() */
 
 EXTERN struct buf *front;	/* points to least recently used free block */
 EXTERN struct buf *rear;	/* points to most recently used free block */
+EXTERN struct buf *pfront;	/* least recently used protected block */
+EXTERN struct buf *prear;	/* most recently used protected block */
+EXTERN int nr_protected;	/* # bufs in the protected segment */
 EXTERN int bufs_in_use;		/* # bufs currently in use (not on free list)*/
+EXTERN int nr_dirty;		/* # bufs with b_dirtied set */
+
+#define WB_HIGH_WATER	(nr_bufs / 2)	/* dirty bufs that start write behind */
+#define PROT_MAX	(nr_bufs / 2)	/* most bufs in protected segment */
+
+#define PROBATION	0	/* b_seg: data and demoted blocks */
+#define PROTECTED	1	/* b_seg: metadata blocks */
 
 /* When a block is released, the type of usage is passed to put_block(). */
 #define WRITE_IMMED   0100 /* block should be written to disk now */
@@ -71,5 +114,6 @@ EXTERN int bufs_in_use;		/* # bufs currently in use (not on free list)*/
 #define MAP_BLOCK          3				 /* bit map */
 #define FULL_DATA_BLOCK    5		 	 	 /* data, fully used */
 #define PARTIAL_DATA_BLOCK 6 				 /* data, partly used*/
+#define NO_TYPE           _NR_BLOCK_TYPES		 /* fetched, not released */
 
-#define HASH_MASK (NR_BUF_HASH - 1)	/* mask for hashing block numbers */
+#define HASH_MASK (nr_buf_hash - 1)	/* mask for hashing block numbers */
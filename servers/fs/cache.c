@@ -6,12 +6,22 @@
  * The entry points into this file are:
  *   get_block:	  request to fetch a block for reading or writing from cache
  *   put_block:	  return a block previously requested with get_block
+ *   in_cache:	  tell if a block is in the cache, without touching it
  *   alloc_zone:  allocate a new zone (to increase the length of a file)
  *   free_zone:	  release a zone (when a file is removed)
  *   invalidate:  remove all the cache blocks on some device
+ *   set_blocksize: make the buffers large enough for some block size
+ *   write_behind: write dirty blocks before they have to be evicted
  *
  * Private functions:
  *   rw_block:    read or write a block from the disk itself
+ *   find_block:  look up a block in the cache
+ *   sort_bufs:	  sort buffers on block number
+ *   rm_lru:	  take a block off its LRU chain
+ *   add_lru:	  put a block on the front or rear of an LRU chain
+ *   wb_clean:	  stop counting a block as dirty
+ *   wb_flush:	  write the blocks that have been dirty for some time
+ *   wb_timeout:  start a new write behind period
  */
 
 #include "fs.h"
@@ -21,8 +31,19 @@
 #include "fproc.h"
 #include "super.h"
 
+FORWARD _PROTOTYPE( struct buf *find_block, (Dev_t dev, block_t block) );
+FORWARD _PROTOTYPE( void sort_bufs, (struct buf **bufq, int bufqsize) );
 FORWARD _PROTOTYPE( void rm_lru, (struct buf *bp) );
+FORWARD _PROTOTYPE( void add_lru, (struct buf *bp, int seg, int at_front) );
 FORWARD _PROTOTYPE( int rw_block, (struct buf *, int) );
+FORWARD _PROTOTYPE( void wb_clean, (struct buf *bp) );
+FORWARD _PROTOTYPE( int wb_flush, (long dirtied) );
+FORWARD _PROTOTYPE( void wb_timeout, (timer_t *tp) );
+
+PRIVATE long wb_clock = 1;	/* current write behind period */
+PRIVATE timer_t wb_timer;	/* ends the current period */
+PRIVATE int wb_armed;		/* TRUE if wb_timer is running */
+PRIVATE long wb_stalled;	/* period in which write_behind() cleaned nothing */
 
 /*===========================================================================*
  *				get_block				     *
@@ -55,26 +76,29 @@ int only_search;		/* if NO_READ, don't read, else act normal */
    * someone wants to read from a hole in a file, in which case this search
    * is skipped
    */
-  if (dev != NO_DEV) {
-	b = (int) block & HASH_MASK;
-	bp = buf_hash[b];
-	while (bp != NIL_BUF) {
-		if (bp->b_blocknr == block && bp->b_dev == dev) {
-			/* Block needed has been found. */
-			if (bp->b_count == 0) rm_lru(bp);
-			bp->b_count++;	/* record that block is in use */
-
-			return(bp);
-		} else {
-			/* This block is not the one sought. */
-			bp = bp->b_hash; /* move to next block on hash chain */
-		}
+  if (dev != NO_DEV && (bp = find_block(dev, block)) != NIL_BUF) {
+	/* Block needed has been found. */
+	if (bp->b_count == 0) {
+		rm_lru(bp);
+		bufs_in_use++;
 	}
+	bp->b_count++;	/* record that block is in use */
+	if (bp->b_type != NO_TYPE)
+		fs_stats.fss_hits[bp->b_type]++;
+	if (bp->b_prefetched) {
+		fs_stats.fss_ra_hits++;
+		bp->b_prefetched = FALSE;
+	}
+	return(bp);
   }
 
-  /* Desired block is not on available chain.  Take oldest block ('front'). */
-  if ((bp = front) == NIL_BUF) panic(__FILE__,"all buffers in use", NR_BUFS);
+  /* Desired block is not on available chain.  Take the oldest block, from
+   * the protected segment only if there are no other blocks.
+   */
+  if ((bp = front) == NIL_BUF && (bp = pfront) == NIL_BUF)
+	panic(__FILE__,"all buffers in use", nr_bufs);
   rm_lru(bp);
+  bufs_in_use++;
 
   /* Remove the block that was just taken from its hash chain. */
   b = (int) bp->b_blocknr & HASH_MASK;
@@ -96,16 +120,22 @@ int only_search;		/* if NO_READ, don't read, else act normal */
    * Avoid hysteresis by flushing all other dirty blocks for the same device.
    */
   if (bp->b_dev != NO_DEV) {
-	if (bp->b_dirt == DIRTY) flushall(bp->b_dev);
+	if (bp->b_dirt == DIRTY) {
+		fs_stats.fss_dirty_evicts++;
+		flushall(bp->b_dev);
+	}
 #if ENABLE_CACHE2
 	put_block2(bp);
 #endif
   }
+  wb_clean(bp);			/* whatever was not written is lost */
 
   /* Fill in block's parameters and add it to the hash chain where it goes. */
   bp->b_dev = dev;		/* fill in device number */
   bp->b_blocknr = block;	/* fill in block number */
   bp->b_count++;		/* record that block is being used */
+  bp->b_type = NO_TYPE;		/* the miss is counted when it is released */
+  bp->b_prefetched = FALSE;
   b = (int) bp->b_blocknr & HASH_MASK;
   bp->b_hash = buf_hash[b];
   buf_hash[b] = bp;		/* add to hash list */
@@ -136,15 +166,29 @@ int block_type;			/* INODE_BLOCK, DIRECTORY_BLOCK, or whatever */
  * it may be put on the front or rear of the LRU chain.  Blocks that are
  * expected to be needed again shortly (e.g., partially full data blocks)
  * go on the rear; blocks that are unlikely to be needed again shortly
- * (e.g., full data blocks) go on the front.  Blocks whose loss can hurt
+ * (e.g., full data blocks) go on the front.  Metadata blocks go on the
+ * rear of the protected segment.  Blocks whose loss can hurt
  * the integrity of the file system (e.g., inode blocks) are written to
  * disk immediately if they are dirty.
  */
+  int type;
+  struct buf *xp;
+
   if (bp == NIL_BUF) return;	/* it is easier to check here than in caller */
 
+  type = block_type & ~(WRITE_IMMED | ONE_SHOT);
   bp->b_count--;		/* there is one use fewer now */
   if (bp->b_count != 0) return;	/* block is still in use */
 
+  /* Now that the type of the block is known, count the miss that fetched it.
+   * This is left to the last user, so that rahead() can hold on to the block
+   * it fetches for its caller while rw_scattered() releases the others.
+   * Blocks read ahead are counted by rahead() instead.
+   */
+  if (bp->b_type == NO_TYPE && bp->b_dev != NO_DEV && !bp->b_prefetched)
+	fs_stats.fss_misses[type]++;
+  bp->b_type = type;
+
   bufs_in_use--;		/* one fewer block buffers in use */
 
   /* Put this block back on the LRU chain.  If the ONE_SHOT bit is set in
@@ -156,24 +200,23 @@ int block_type;			/* INODE_BLOCK, DIRECTORY_BLOCK, or whatever */
 	/* Block probably won't be needed quickly. Put it on front of chain.
   	 * It will be the next block to be evicted from the cache.
   	 */
-	bp->b_prev = NIL_BUF;
-	bp->b_next = front;
-	if (front == NIL_BUF)
-		rear = bp;	/* LRU chain was empty */
-	else
-		front->b_prev = bp;
-	front = bp;
+	add_lru(bp, PROBATION, TRUE);
+  } else if (type <= MAP_BLOCK && bp->b_dev != NO_DEV) {
+	/* Metadata.  Protect it, and make room by demoting the oldest
+	 * protected block if there are too many.
+	 */
+	add_lru(bp, PROTECTED, FALSE);
+	if (nr_protected > PROT_MAX) {
+		xp = pfront;
+		rm_lru(xp);
+		add_lru(xp, PROBATION, FALSE);
+		fs_stats.fss_demoted++;
+	}
   } else {
 	/* Block probably will be needed quickly.  Put it on rear of chain.
   	 * It will not be evicted from the cache for a long time.
   	 */
-	bp->b_prev = rear;
-	bp->b_next = NIL_BUF;
-	if (rear == NIL_BUF)
-		front = bp;
-	else
-		rear->b_next = bp;
-	rear = bp;
+	add_lru(bp, PROBATION, FALSE);
   }
 
   /* Some blocks are so important (e.g., inodes, indirect blocks) that they
@@ -183,6 +226,17 @@ int block_type;			/* INODE_BLOCK, DIRECTORY_BLOCK, or whatever */
   if ((block_type & WRITE_IMMED) && bp->b_dirt==DIRTY && bp->b_dev != NO_DEV) {
 		rw_block(bp, WRITING);
   } 
+
+  /* Note when a block became dirty, and make sure it is written later. */
+  if (bp->b_dirt == DIRTY && bp->b_dirtied == 0 && bp->b_dev != NO_DEV) {
+	bp->b_dirtied = wb_clock;
+	nr_dirty++;
+	if (!wb_armed) {
+		fs_init_timer(&wb_timer);
+		fs_set_timer(&wb_timer, WB_PERIOD, wb_timeout, 0);
+		wb_armed = TRUE;
+	}
+  }
 }
 
 /*===========================================================================*
@@ -283,6 +337,7 @@ int rw_flag;			/* READING or WRITING */
   }
 
   bp->b_dirt = CLEAN;
+  wb_clean(bp);
 }
 
 /*===========================================================================*
@@ -295,8 +350,16 @@ dev_t device;			/* device whose blocks are to be purged */
 
   register struct buf *bp;
 
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++)
-	if (bp->b_dev == device) bp->b_dev = NO_DEV;
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++)
+	if (bp->b_dev == device) {
+		bp->b_dev = NO_DEV;
+		wb_clean(bp);
+		if (bp->b_count == 0) {
+			/* Make it the first block to be reused. */
+			rm_lru(bp);
+			add_lru(bp, PROBATION, TRUE);
+		}
+	}
 
 #if ENABLE_CACHE2
   invalidate2(device);
@@ -312,12 +375,88 @@ dev_t dev;			/* device to flush */
 /* Flush all dirty blocks for one device. */
 
   register struct buf *bp;
-  static struct buf *dirty[NR_BUFS];	/* static so it isn't on stack */
   int ndirty;
 
-  for (bp = &buf[0], ndirty = 0; bp < &buf[NR_BUFS]; bp++)
-	if (bp->b_dirt == DIRTY && bp->b_dev == dev) dirty[ndirty++] = bp;
-  rw_scattered(dev, dirty, ndirty, WRITING);
+  for (bp = &buf[0], ndirty = 0; bp < &buf[nr_bufs]; bp++)
+	if (bp->b_dirt == DIRTY && bp->b_dev == dev) dirty_q[ndirty++] = bp;
+  rw_scattered(dev, dirty_q, ndirty, WRITING);
+}
+
+/*===========================================================================*
+ *				set_blocksize				     *
+ *===========================================================================*/
+PUBLIC int set_blocksize(block_size)
+int block_size;			/* block size of a file system to be used */
+{
+/* Make sure that the buffers can hold blocks of 'block_size' bytes.  If they
+ * are too small, write all dirty blocks to disk and cut the buffer data into
+ * fewer, larger buffers.  The cache is empty afterwards.  This is only done
+ * when a file system with a larger block size than any before is mounted, so
+ * the buffers are as small as the file systems in use allow.
+ */
+  register struct buf *bp;
+  int n;
+
+  if (block_size <= buf_size) return(OK);
+  if (bufs_in_use != 0) return(EBUSY);
+
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++)
+	if (bp->b_dev != NO_DEV && bp->b_dirt == DIRTY) flushall(bp->b_dev);
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++)
+	if (bp->b_dev != NO_DEV && bp->b_dirt == DIRTY) return(EIO);
+
+  n = (int) (buf_bytes / block_size);
+  if (n > max_bufs) n = max_bufs;
+  if (n < 6) return(ENOMEM);	/* FS needs a few buffers to work at all */
+  nr_bufs = n;
+  buf_size = block_size;
+
+  /* Cut the data into buffers and put them all on the LRU chain. */
+  front = &buf[0];
+  rear = &buf[nr_bufs - 1];
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++) {
+	bp->b_blk = (union fsdata_u *) (buf_data + (bp - buf) * block_size);
+	bp->b_blocknr = NO_BLOCK;
+	bp->b_dev = NO_DEV;
+	bp->b_dirt = CLEAN;
+	bp->b_dirtied = 0;
+	bp->b_count = 0;
+	bp->b_seg = PROBATION;
+	bp->b_type = NO_TYPE;
+	bp->b_prefetched = FALSE;
+	bp->b_next = bp + 1;
+	bp->b_prev = bp - 1;
+  }
+  buf[0].b_prev = NIL_BUF;
+  buf[nr_bufs - 1].b_next = NIL_BUF;
+  pfront = prear = NIL_BUF;
+  nr_protected = 0;
+
+  /* All buffers hold NO_BLOCK, so they all go on the same hash chain. */
+  for (n = 0; n < nr_buf_hash; n++) buf_hash[n] = NIL_BUF;
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++) bp->b_hash = bp->b_next;
+  buf_hash[(int) NO_BLOCK & HASH_MASK] = front;
+  nr_dirty = 0;
+  return(OK);
+}
+
+/*===========================================================================*
+ *				write_behind				     *
+ *===========================================================================*/
+PUBLIC void write_behind()
+{
+/* Too many blocks are dirty.  Write the ones that were dirtied before the
+ * current period, or all of them if that is not enough.  This is done after
+ * the reply to the request that dirtied them, so that nobody waits for it.
+ * If the blocks cannot be written, don't try again until the next period.
+ */
+  int before;
+
+  if (wb_stalled == wb_clock) return;
+  before = nr_dirty;
+  wb_flush(wb_clock - 1);
+  if (nr_dirty >= WB_HIGH_WATER) wb_flush(wb_clock);
+  if (nr_dirty >= before) wb_stalled = wb_clock;
 }
 
 /*===========================================================================*
@@ -329,56 +468,101 @@ struct buf **bufq;		/* pointer to array of buffers */
 int bufqsize;			/* number of buffers */
 int rw_flag;			/* READING or WRITING */
 {
-/* Read or write scattered data from a device. */
+/* Read or write scattered data from a device.  The buffers are sorted on
+ * block number, and each run of blocks is done in one transfer.  Buffers that
+ * happen to lie next to each other in memory share an I/O vector element, so
+ * a run is only limited by the NR_IOREQS elements a driver accepts.  A gap of
+ * up to RW_GAP_BLOCKS blocks does not end a run: on a read the blocks in the
+ * gap are read into a scratch block, on a write their buffers in the cache
+ * are written again if they are all there and not in use.
+ */
 
-  register struct buf *bp;
+  register struct buf *bp, *xp;
   int gap;
   register int i;
   register iovec_t *iop;
   static iovec_t iovec[NR_IOREQS];  /* static so it isn't on stack */
+  static char scratch[MAX_BLOCK_SIZE];	/* data of gaps that are read */
   int j, r;
   int block_size;
+  block_t start, b, nblocks;
+  vir_bytes addr;
+  long left;
 
   block_size = get_block_size(dev);
 
-  /* (Shell) sort buffers on b_blocknr. */
-  gap = 1;
-  do
-	gap = 3 * gap + 1;
-  while (gap <= bufqsize);
-  while (gap != 1) {
-	gap /= 3;
-	for (j = gap; j < bufqsize; j++) {
-		for (i = j - gap;
-		     i >= 0 && bufq[i]->b_blocknr > bufq[i + gap]->b_blocknr;
-		     i -= gap) {
-			bp = bufq[i];
-			bufq[i] = bufq[i + gap];
-			bufq[i + gap] = bp;
-		}
-	}
+  if (bufqsize > 0) {
+	fs_stats.fss_scatter_calls++;
+	fs_stats.fss_scatter_blocks += bufqsize;
+	count_in(fs_stats.fss_batch, _NR_FS_BATCH, (u32_t) bufqsize);
   }
 
+  sort_bufs(bufq, bufqsize);
+
   /* Set up I/O vector and do I/O.  The result of dev_io is OK if everything
    * went fine, otherwise the error code for the first failed transfer.
    */  
   while (bufqsize > 0) {
-	for (j = 0, iop = iovec; j < NR_IOREQS && j < bufqsize; j++, iop++) {
-		bp = bufq[j];
-		if (bp->b_blocknr != bufq[0]->b_blocknr + j) break;
-		iop->iov_addr = (vir_bytes) bp->b_data;
-		iop->iov_size = block_size;
+	start = bufq[0]->b_blocknr;
+	nblocks = 0;
+	iop = iovec;
+	for (i = 0; i < bufqsize; i++) {
+		bp = bufq[i];
+		gap = (int) (bp->b_blocknr - (start + nblocks));
+		if (gap > RW_GAP_BLOCKS) break;
+
+		/* Each block may need an element of its own. */
+		if ((iop - iovec) + gap + 1 > NR_IOREQS) break;
+
+		/* Make sure that a gap in a write can be bridged. */
+		if (rw_flag == WRITING) {
+			for (b = start + nblocks; b < bp->b_blocknr; b++) {
+				xp = find_block(dev, b);
+				if (xp == NIL_BUF || xp->b_count != 0) break;
+			}
+			if (b < bp->b_blocknr) break;
+		}
+
+		/* Add the blocks in the gap and then the block itself. */
+		for (b = start + nblocks; b <= bp->b_blocknr; b++) {
+			if (b == bp->b_blocknr)
+				addr = (vir_bytes) bp->b_data;
+			else if (rw_flag == READING)
+				addr = (vir_bytes) scratch;
+			else
+				addr = (vir_bytes) find_block(dev, b)->b_data;
+
+			if (iop > iovec && addr != (vir_bytes) scratch
+			   && iop[-1].iov_addr + iop[-1].iov_size == addr) {
+				iop[-1].iov_size += block_size;
+			} else {
+				iop->iov_addr = addr;
+				iop->iov_size = block_size;
+				iop++;
+			}
+			nblocks++;
+		}
 	}
+	j = i;				/* buffers in this transfer */
 	r = dev_io(rw_flag == WRITING ? DEV_SCATTER : DEV_GATHER,
 		dev, FS_PROC_NR, iovec,
-		(off_t) bufq[0]->b_blocknr * block_size, j, 0);
+		(off_t) start * block_size, (int) (iop - iovec), 0);
+	fs_stats.fss_scatter_xfers++;
+
+	/* The driver leaves the number of bytes it did not transfer in each
+	 * element, and it stops at the first failure, so it has done as many
+	 * blocks from the start as there were bytes in all elements but those.
+	 */
+	left = (long) nblocks * block_size;
+	while (iop > iovec) left -= (--iop)->iov_size;
+	nblocks = left / block_size;
 
 	/* Harvest the results.  Dev_io reports the first error it may have
 	 * encountered, but we only care if it's the first block that failed.
 	 */
-	for (i = 0, iop = iovec; i < j; i++, iop++) {
+	for (i = 0; i < j; i++) {
 		bp = bufq[i];
-		if (iop->iov_size != 0) {
+		if (bp->b_blocknr - start >= nblocks) {
 			/* Transfer failed. An error? Do we care? */
 			if (r != OK && i == 0) {
 				printf(
@@ -386,6 +570,7 @@ int rw_flag;			/* READING or WRITING */
 					(dev>>MAJOR)&BYTE, (dev>>MINOR)&BYTE,
 					bp->b_blocknr);
 				bp->b_dev = NO_DEV;	/* invalidate block */
+				wb_clean(bp);
 			}
 			break;
 		}
@@ -394,6 +579,7 @@ int rw_flag;			/* READING or WRITING */
 			put_block(bp, PARTIAL_DATA_BLOCK);
 		} else {
 			bp->b_dirt = CLEAN;
+			wb_clean(bp);
 		}
 	}
 	bufq += i;
@@ -418,25 +604,214 @@ int rw_flag;			/* READING or WRITING */
   }
 }
 
+/*===========================================================================*
+ *				in_cache				     *
+ *===========================================================================*/
+PUBLIC int in_cache(dev, block)
+dev_t dev;			/* on which device is the block? */
+block_t block;			/* which block is wanted? */
+{
+/* Tell if a block is in the cache.  Unlike get_block() this does not move the
+ * block on the LRU chains or count a hit, so rahead() can use it to probe.
+ */
+  return(find_block(dev, block) != NIL_BUF);
+}
+
+/*===========================================================================*
+ *				find_block				     *
+ *===========================================================================*/
+PRIVATE struct buf *find_block(dev, block)
+dev_t dev;			/* on which device is the block? */
+block_t block;			/* which block is wanted? */
+{
+/* Search the hash chain for (dev, block).  Return its buffer, or NIL_BUF if
+ * the block is not in the cache.
+ */
+  register struct buf *bp;
+
+  for (bp = buf_hash[(int) block & HASH_MASK]; bp != NIL_BUF; bp = bp->b_hash)
+	if (bp->b_blocknr == block && bp->b_dev == dev) break;
+  return(bp);
+}
+
+/*===========================================================================*
+ *				sort_bufs				     *
+ *===========================================================================*/
+PRIVATE void sort_bufs(bufq, bufqsize)
+struct buf **bufq;		/* buffers to sort */
+int bufqsize;			/* number of buffers */
+{
+/* Heap sort buffers on b_blocknr.  A flush can pass every buffer in the
+ * cache, so this must not take quadratic time, and it must not use memory.
+ */
+  register struct buf *bp;
+  int top, n, i, child;
+
+  /* Build a heap with the highest block number on top, then repeatedly swap
+   * the top to the end and restore the heap on the rest.
+   */
+  top = bufqsize / 2;
+  n = bufqsize;
+  while (n > 1) {
+	if (top > 0) {
+		i = --top;		/* still building the heap */
+		bp = bufq[i];
+	} else {
+		i = 0;			/* take the top off */
+		bp = bufq[--n];
+		bufq[n] = bufq[0];
+	}
+
+	/* Sift 'bp' down from position i. */
+	while ((child = 2 * i + 1) < n) {
+		if (child + 1 < n &&
+		    bufq[child + 1]->b_blocknr > bufq[child]->b_blocknr)
+			child++;
+		if (bufq[child]->b_blocknr <= bp->b_blocknr) break;
+		bufq[i] = bufq[child];
+		i = child;
+	}
+	bufq[i] = bp;
+  }
+}
+
 /*===========================================================================*
  *				rm_lru					     *
  *===========================================================================*/
 PRIVATE void rm_lru(bp)
 struct buf *bp;
 {
-/* Remove a block from its LRU chain. */
+/* Remove a block from the LRU chain of its segment. */
   struct buf *next_ptr, *prev_ptr;
+  struct buf **frontp, **rearp;
 
-  bufs_in_use++;
+  if (bp->b_seg == PROTECTED) {
+	frontp = &pfront;
+	rearp = &prear;
+	nr_protected--;
+  } else {
+	frontp = &front;
+	rearp = &rear;
+  }
   next_ptr = bp->b_next;	/* successor on LRU chain */
   prev_ptr = bp->b_prev;	/* predecessor on LRU chain */
   if (prev_ptr != NIL_BUF)
 	prev_ptr->b_next = next_ptr;
   else
-	front = next_ptr;	/* this block was at front of chain */
+	*frontp = next_ptr;	/* this block was at front of chain */
 
   if (next_ptr != NIL_BUF)
 	next_ptr->b_prev = prev_ptr;
   else
-	rear = prev_ptr;	/* this block was at rear of chain */
+	*rearp = prev_ptr;	/* this block was at rear of chain */
+}
+
+/*===========================================================================*
+ *				add_lru					     *
+ *===========================================================================*/
+PRIVATE void add_lru(bp, seg, at_front)
+struct buf *bp;
+int seg;			/* PROBATION or PROTECTED */
+int at_front;			/* TRUE if the block is to be reused first */
+{
+/* Put a block on the front or the rear of the LRU chain of a segment. */
+  struct buf **frontp, **rearp;
+
+  if ((bp->b_seg = seg) == PROTECTED) {
+	frontp = &pfront;
+	rearp = &prear;
+	nr_protected++;
+  } else {
+	frontp = &front;
+	rearp = &rear;
+  }
+  if (at_front) {
+	bp->b_prev = NIL_BUF;
+	bp->b_next = *frontp;
+	if (*frontp == NIL_BUF)
+		*rearp = bp;	/* LRU chain was empty */
+	else
+		(*frontp)->b_prev = bp;
+	*frontp = bp;
+  } else {
+	bp->b_prev = *rearp;
+	bp->b_next = NIL_BUF;
+	if (*rearp == NIL_BUF)
+		*frontp = bp;	/* LRU chain was empty */
+	else
+		(*rearp)->b_next = bp;
+	*rearp = bp;
+  }
+}
+
+/*===========================================================================*
+ *				wb_clean				     *
+ *===========================================================================*/
+PRIVATE void wb_clean(bp)
+struct buf *bp;
+{
+/* A block has been written, or its contents are gone.  Stop counting it as
+ * dirty.
+ */
+  if (bp->b_dirtied != 0) {
+	bp->b_dirtied = 0;
+	nr_dirty--;
+  }
+}
+
+/*===========================================================================*
+ *				wb_flush				     *
+ *===========================================================================*/
+PRIVATE int wb_flush(dirtied)
+long dirtied;			/* last period whose dirty blocks are written */
+{
+/* Write all blocks that were dirtied in period 'dirtied' or before, and
+ * return how many were tried.  The blocks of a device are written together,
+ * so rw_scattered() can sort them and write each run of consecutive blocks in
+ * one transfer.  Rw_scattered() stops when the device makes no progress.  The
+ * blocks it left dirty count as dirtied in the next period, so a device that
+ * does not take them is tried once here and then again after WB_AGE periods.
+ */
+  register struct buf *bp, *xp;
+  int i, ndirty, tried;
+
+  tried = 0;
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++) {
+	if (bp->b_dirtied == 0 || bp->b_dirtied > dirtied) continue;
+	ndirty = 0;
+	for (xp = bp; xp < &buf[nr_bufs]; xp++) {
+		if (xp->b_dev == bp->b_dev && xp->b_dirtied != 0
+					&& xp->b_dirtied <= dirtied)
+			dirty_q[ndirty++] = xp;
+	}
+	rw_scattered(bp->b_dev, dirty_q, ndirty, WRITING);
+	for (i = 0; i < ndirty; i++)
+		if (dirty_q[i]->b_dirtied != 0)
+			dirty_q[i]->b_dirtied = wb_clock + 1;
+	tried += ndirty;
+  }
+  return(tried);
+}
+
+/*===========================================================================*
+ *				wb_timeout				     *
+ *===========================================================================*/
+PRIVATE void wb_timeout(tp)
+timer_t *tp;
+{
+/* A write behind period has ended.  Write the blocks that have been dirty for
+ * WB_AGE periods, and start the next period if any blocks are still dirty.
+ * If none of the blocks that were written could be cleaned, the devices are
+ * not taking them, so wait until put_block() starts the timer again.
+ */
+  int before, tried;
+
+  wb_clock++;
+  before = nr_dirty;
+  tried = wb_flush(wb_clock - WB_AGE);
+  if (nr_dirty > 0 && (tried == 0 || nr_dirty < before)) {
+	fs_set_timer(&wb_timer, WB_PERIOD, wb_timeout, 0);
+  } else {
+	wb_armed = FALSE;
+  }
 }
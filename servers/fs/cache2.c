@@ -4,8 +4,19 @@
  * to run on systems with little memory.  On a system with lots of memory one
  * can use the RAM disk as a read-only second level cache.  Any blocks pushed
  * out of the primary cache are cached on the RAM disk.  This code manages the
- * second level cache.  The cache is a simple FIFO where old blocks are put
- * into and drop out at the other end.  Must be searched backwards.
+ * second level cache.
+ *
+ * The RAM disk is cut into slots of one block each.  A slot is found through
+ * a hash table on (dev, block).  The slots are managed after the 2Q policy:
+ * a block that is pushed out of the primary cache for the first time goes on
+ * the A1 queue, which is FIFO and gives up its slots first once it holds more
+ * than a quarter of them.  A block that is found in the cache again moves to
+ * the Am queue, which is LRU.  A stream of blocks that are used only once thus
+ * passes through A1 without pushing the blocks that are used over and over
+ * again out of Am.  The slot of a block that is taken back into the primary
+ * cache is kept, and the block is written over it when it is pushed out again.
+ * The size of the cache is the size of the RAM disk, the 'ramsize' boot
+ * parameter, if the RAM disk is not the root device.
  *
  * The entry points into this file are:
  *   init_cache2: initialize the second level cache
@@ -15,33 +26,77 @@
  */
 
 #include "fs.h"
+#include <unistd.h>
 #include <minix/com.h>
 #include "buf.h"
 
 #if ENABLE_CACHE2
 
-#define MAX_BUF2	(256 * sizeof(char *))
-
 PRIVATE struct buf2 {	/* 2nd level cache per block administration */
   block_t b2_blocknr;		/* block number */
-  dev_t b2_dev;			/* device number */
-  u16_t b2_count;		/* count of in-cache block groups */
-} buf2[MAX_BUF2];
+  dev_t b2_dev;			/* device number, NO_DEV if the slot is free */
+  char b2_queue;		/* Q_A1 or Q_AM */
+  struct buf2 *b2_hash;		/* next slot on the same hash chain */
+  struct buf2 *b2_next;		/* next slot on the same queue */
+  struct buf2 *b2_prev;		/* previous slot on the same queue */
+} *buf2;
+
+#define NIL_BUF2	((struct buf2 *) 0)
+#define Q_A1		0	/* blocks seen once, FIFO */
+#define Q_AM		1	/* blocks seen more than once, LRU */
+
+PRIVATE struct queue2 {
+  struct buf2 *q_front;		/* slot to be reused first */
+  struct buf2 *q_rear;		/* slot put on the queue last */
+  unsigned q_count;		/* # slots on the queue */
+} queue2[2];
 
-PRIVATE unsigned nr_buf2;		/* actual cache size */
-PRIVATE unsigned buf2_idx;		/* round-robin reuse index */
+PRIVATE struct buf2 **buf2_hash;	/* hash table on (dev, block) */
+PRIVATE unsigned nr_buf2_hash;		/* size of buf2_hash, a power of 2 */
+PRIVATE unsigned max_buf2;		/* # slot headers allocated */
+PRIVATE unsigned nr_buf2;		/* # slots in use, 0 if no cache */
+PRIVATE long ram_bytes;			/* size of the RAM disk */
+PRIVATE int slot_size;			/* bytes per slot */
 
-#define hash2(block)	((unsigned) ((block) & (MAX_BUF2 - 1)))
+#define hash2(dev, block) \
+	((unsigned) ((block) ^ ((block_t) (dev) << 4)) & (nr_buf2_hash - 1))
+
+FORWARD _PROTOTYPE( void cut_cache2, (void)				);
+FORWARD _PROTOTYPE( struct buf2 *find2, (Dev_t dev, block_t block)	);
+FORWARD _PROTOTYPE( void unhash2, (struct buf2 *bp2)			);
+FORWARD _PROTOTYPE( void dequeue2, (struct buf2 *bp2)			);
+FORWARD _PROTOTYPE( void enqueue2, (struct buf2 *bp2, int queue, int front));
 
 /*===========================================================================*
  *				init_cache2				     *
  *===========================================================================*/
 PUBLIC void init_cache2(size)
-unsigned long size;
+unsigned long size;		/* size of the RAM disk in kB */
 {
-/* Initialize the second level disk buffer cache of 'size' blocks. */
+/* Initialize the second level disk buffer cache on a RAM disk of 'size' kB.
+ * There are enough slot headers to cut the RAM disk into blocks of
+ * MIN_BLOCK_SIZE.  If FS has not got the heap for that many, fewer are used.
+ */
+  unsigned n;
+  char *p;
 
-  nr_buf2 = size > MAX_BUF2 ? MAX_BUF2 : (unsigned) size;
+  ram_bytes = (long) size * 1024;
+  n = (unsigned) (ram_bytes / MIN_BLOCK_SIZE);
+  while (n > 0) {
+	for (nr_buf2_hash = 1; nr_buf2_hash < n; nr_buf2_hash <<= 1) ;
+	p = sbrk((int) (n * sizeof(struct buf2)
+				+ nr_buf2_hash * sizeof(struct buf2 *)));
+	if (p != (char *) -1) break;
+	n /= 2;
+  }
+  if (n == 0) return;		/* no 2nd level cache */
+  if (n < ram_bytes / MIN_BLOCK_SIZE)
+	printf("FS: second level cache reduced to %u blocks\n", n);
+
+  buf2 = (struct buf2 *) p;
+  buf2_hash = (struct buf2 **) (buf2 + n);
+  max_buf2 = n;
+  cut_cache2();
 }
 
 /*===========================================================================*
@@ -52,30 +107,29 @@ struct buf *bp;			/* buffer to get from the 2nd level cache */
 int only_search;		/* if NO_READ, do nothing, else act normal */
 {
 /* Fill a buffer from the 2nd level cache.  Return true iff block acquired. */
-  unsigned b;
   struct buf2 *bp2;
+  int block_size;
 
   /* If the block wanted is in the RAM disk then our game is over. */
   if (bp->b_dev == DEV_RAM) nr_buf2 = 0;
 
-  /* Cache enabled?  NO_READ?  Any blocks with the same hash key? */
-  if (nr_buf2 == 0 || only_search == NO_READ
-  			|| buf2[hash2(bp->b_blocknr)].b2_count == 0) return(0);
-
-  /* Search backwards (there may be older versions). */
-  b = buf2_idx;
-  for (;;) {
-	if (b == 0) b = nr_buf2;
-	bp2 = &buf2[--b];
-	if (bp2->b2_blocknr == bp->b_blocknr && bp2->b2_dev == bp->b_dev) break;
-	if (b == buf2_idx) return(0);
-  }
+  /* Cache enabled?  NO_READ?  Is the block there? */
+  if (nr_buf2 == 0 || only_search == NO_READ) return(0);
+  if (slot_size != buf_size) cut_cache2();	/* buffers have grown */
+  if ((bp2 = find2(bp->b_dev, bp->b_blocknr)) == NIL_BUF2) return(0);
 
   /* Block is in the cache, get it. */
+  block_size = get_block_size(bp->b_dev);
   if (dev_io(DEV_READ, DEV_RAM, FS_PROC_NR, bp->b_data,
-			(off_t) b * BLOCK_SIZE, BLOCK_SIZE, 0) == BLOCK_SIZE) {
+		(off_t) (bp2 - buf2) * slot_size, block_size, 0) == block_size) {
+	/* It has been used again, so it is one to keep. */
+	dequeue2(bp2);
+	enqueue2(bp2, Q_AM, FALSE);
 	return(1);
   }
+  unhash2(bp2);
+  dequeue2(bp2);
+  enqueue2(bp2, Q_A1, TRUE);
   return(0);
 }
 
@@ -85,23 +139,45 @@ int only_search;		/* if NO_READ, do nothing, else act normal */
 PUBLIC void put_block2(bp)
 struct buf *bp;			/* buffer to store in the 2nd level cache */
 {
-/* Store a buffer into the 2nd level cache. */
-  unsigned b;
+/* Store a buffer that is evicted from the primary cache into the 2nd level
+ * cache.  If the block has a slot already, its data is written over the old.
+ * Otherwise a free slot is used, or the oldest slot of A1 if A1 holds more
+ * than its share, or else the least recently used slot of Am.
+ */
   struct buf2 *bp2;
+  int block_size;
 
   if (nr_buf2 == 0) return;	/* no 2nd level cache */
+  if (slot_size != buf_size) cut_cache2();	/* buffers have grown */
 
-  b = buf2_idx++;
-  if (buf2_idx == nr_buf2) buf2_idx = 0;
-
-  bp2 = &buf2[b];
+  if ((bp2 = find2(bp->b_dev, bp->b_blocknr)) != NIL_BUF2) {
+	dequeue2(bp2);
+  } else {
+	bp2 = queue2[Q_A1].q_front;
+	if (bp2 == NIL_BUF2 || (bp2->b2_dev != NO_DEV
+			&& queue2[Q_A1].q_count <= nr_buf2 / 4
+			&& queue2[Q_AM].q_count != 0))
+		bp2 = queue2[Q_AM].q_front;
+	unhash2(bp2);
+	dequeue2(bp2);
+  }
 
+  block_size = get_block_size(bp->b_dev);
   if (dev_io(DEV_WRITE, DEV_RAM, FS_PROC_NR, bp->b_data,
-			(off_t) b * BLOCK_SIZE, BLOCK_SIZE, 0) == BLOCK_SIZE) {
-	if (bp2->b2_dev != NO_DEV) buf2[hash2(bp2->b2_blocknr)].b2_count--;
+		(off_t) (bp2 - buf2) * slot_size, block_size, 0) != block_size) {
+	unhash2(bp2);
+	enqueue2(bp2, Q_A1, TRUE);
+	return;
+  }
+
+  if (bp2->b2_dev == NO_DEV) {
 	bp2->b2_dev = bp->b_dev;
 	bp2->b2_blocknr = bp->b_blocknr;
-	buf2[hash2(bp2->b2_blocknr)].b2_count++;
+	bp2->b2_hash = buf2_hash[hash2(bp2->b2_dev, bp2->b2_blocknr)];
+	buf2_hash[hash2(bp2->b2_dev, bp2->b2_blocknr)] = bp2;
+	enqueue2(bp2, Q_A1, FALSE);
+  } else {
+	enqueue2(bp2, bp2->b2_queue, FALSE);
   }
 }
 
@@ -112,15 +188,117 @@ PUBLIC void invalidate2(device)
 dev_t device;
 {
 /* Invalidate all blocks from a given device in the 2nd level cache. */
-  unsigned b;
   struct buf2 *bp2;
 
-  for (b = 0; b < nr_buf2; b++) {
-	bp2 = &buf2[b];
+  for (bp2 = &buf2[0]; bp2 < &buf2[nr_buf2]; bp2++) {
 	if (bp2->b2_dev == device) {
-		bp2->b2_dev = NO_DEV;
-		buf2[hash2(bp2->b2_blocknr)].b2_count--;
+		unhash2(bp2);
+		dequeue2(bp2);
+		enqueue2(bp2, Q_A1, TRUE);
 	}
   }
 }
+
+/*===========================================================================*
+ *				cut_cache2				     *
+ *===========================================================================*/
+PRIVATE void cut_cache2()
+{
+/* Cut the RAM disk into slots of the size of the primary buffers, and put
+ * them all on A1, free.  This is done again when the buffers grow, which only
+ * happens when a file system with larger blocks is mounted.
+ */
+  struct buf2 *bp2;
+  unsigned i;
+
+  slot_size = buf_size;
+  nr_buf2 = (unsigned) (ram_bytes / slot_size);
+  if (nr_buf2 > max_buf2) nr_buf2 = max_buf2;
+
+  for (i = 0; i < nr_buf2_hash; i++) buf2_hash[i] = NIL_BUF2;
+  queue2[Q_A1].q_front = queue2[Q_A1].q_rear = NIL_BUF2;
+  queue2[Q_A1].q_count = 0;
+  queue2[Q_AM] = queue2[Q_A1];
+  for (bp2 = &buf2[0]; bp2 < &buf2[nr_buf2]; bp2++) {
+	bp2->b2_dev = NO_DEV;
+	enqueue2(bp2, Q_A1, FALSE);
+  }
+}
+
+/*===========================================================================*
+ *				find2					     *
+ *===========================================================================*/
+PRIVATE struct buf2 *find2(dev, block)
+dev_t dev;			/* device of the block */
+block_t block;			/* block number */
+{
+/* Return the slot that holds a block, or NIL_BUF2 if it is not cached. */
+  struct buf2 *bp2;
+
+  for (bp2 = buf2_hash[hash2(dev, block)]; bp2 != NIL_BUF2;
+							bp2 = bp2->b2_hash) {
+	if (bp2->b2_blocknr == block && bp2->b2_dev == dev) return(bp2);
+  }
+  return(NIL_BUF2);
+}
+
+/*===========================================================================*
+ *				unhash2					     *
+ *===========================================================================*/
+PRIVATE void unhash2(bp2)
+struct buf2 *bp2;
+{
+/* Remove a slot from its hash chain and mark it free. */
+  struct buf2 **bpp2;
+
+  if (bp2->b2_dev == NO_DEV) return;
+  for (bpp2 = &buf2_hash[hash2(bp2->b2_dev, bp2->b2_blocknr)];
+			*bpp2 != bp2; bpp2 = &(*bpp2)->b2_hash) ;
+  *bpp2 = bp2->b2_hash;
+  bp2->b2_dev = NO_DEV;
+}
+
+/*===========================================================================*
+ *				dequeue2				     *
+ *===========================================================================*/
+PRIVATE void dequeue2(bp2)
+struct buf2 *bp2;
+{
+/* Take a slot off its queue. */
+  struct queue2 *qp = &queue2[bp2->b2_queue];
+
+  if (bp2->b2_prev != NIL_BUF2) bp2->b2_prev->b2_next = bp2->b2_next;
+  else qp->q_front = bp2->b2_next;
+  if (bp2->b2_next != NIL_BUF2) bp2->b2_next->b2_prev = bp2->b2_prev;
+  else qp->q_rear = bp2->b2_prev;
+  qp->q_count--;
+}
+
+/*===========================================================================*
+ *				enqueue2				     *
+ *===========================================================================*/
+PRIVATE void enqueue2(bp2, queue, front)
+struct buf2 *bp2;
+int queue;			/* Q_A1 or Q_AM */
+int front;			/* TRUE to reuse this slot first */
+{
+/* Put a slot on the front or the rear of a queue. */
+  struct queue2 *qp = &queue2[queue];
+
+  bp2->b2_queue = queue;
+  if (front) {
+	bp2->b2_prev = NIL_BUF2;
+	bp2->b2_next = qp->q_front;
+	if (qp->q_front != NIL_BUF2) qp->q_front->b2_prev = bp2;
+	else qp->q_rear = bp2;
+	qp->q_front = bp2;
+  } else {
+	bp2->b2_next = NIL_BUF2;
+	bp2->b2_prev = qp->q_rear;
+	if (qp->q_rear != NIL_BUF2) qp->q_rear->b2_next = bp2;
+	else qp->q_front = bp2;
+	qp->q_rear = bp2;
+  }
+  qp->q_count++;
+}
 #endif /* ENABLE_CACHE2 */
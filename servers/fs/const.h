@@ -5,9 +5,19 @@
 #define V2_NR_TZONES      10	/* total # zone numbers in a V2 inode */
 
 #define NR_FILPS         128	/* # slots in filp table */
-#define NR_INODES         64	/* # slots in "in core" inode table */
+#define NR_INODES        256	/* default # slots in "in core" inode table */
 #define NR_SUPERS          8	/* # slots in super block table */
 #define NR_LOCKS           8	/* # slots in the file locking table */
+#define NR_DCACHE        512	/* # entries in the directory name cache */
+
+#define RA_MIN_BLOCKS      4	/* first read ahead window of a file */
+#define RA_MAX_BLOCKS     64	/* largest read ahead window, in blocks */
+#define PREALLOC_ZONES     8	/* zones reserved at once for a growing file */
+#define NR_IRUNS           4	/* # block runs remembered per inode */
+#define RW_GAP_BLOCKS      4	/* gap rw_scattered() transfers across */
+
+#define WB_PERIOD         HZ	/* ticks per write behind period */
+#define WB_AGE             5	/* periods a block may stay dirty */
 
 /* The type of sizeof may be (unsigned) long.  Use the following macro for
  * taking the sizes of small objects so that there are no surprises like
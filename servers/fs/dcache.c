@@ -0,0 +1,239 @@
+/* Directory name lookup cache.  Looking up a path name component means
+ * reading every block of the directory and comparing the name with every
+ * entry.  This cache remembers the result of recent look ups, so that the
+ * same component of a hot path (/usr/lib, /etc, ...) is found without going
+ * through the directory again.  It also remembers names that do not exist,
+ * which is what a search along PATH mostly finds.
+ *
+ * An entry maps (dev, directory inode number, name) to an inode number, or to
+ * 0 for a name that is not in the directory.  All changes to directories are
+ * done by search_dir(), which updates the cache at the same time, so the
+ * cache never disagrees with the disk.  Only when a device is mounted or
+ * unmounted are its entries thrown away, because its contents may have been
+ * changed behind our back.  Long names are not cached.
+ *
+ * The entry points into this file are:
+ *   init_dcache:  initialize the cache
+ *   dc_lookup:	   look up a name in the cache
+ *   dc_enter:	   record that a name is or is not in a directory
+ *   dc_purge_dev: remove all the entries of some device
+ */
+
+#include "fs.h"
+#include <string.h>
+#include "inode.h"
+
+#define DC_NAME_LEN	  24	/* longer names are not cached */
+#define NR_DC_HASH	 256	/* size of hash table; MUST BE POWER OF 2 */
+
+PRIVATE struct dcache {
+  dev_t dc_dev;			/* device of the directory, NO_DEV if free */
+  ino_t dc_dir;			/* inode number of the directory */
+  ino_t dc_ino;			/* inode number of the name, 0 if absent */
+  char dc_name[DC_NAME_LEN];	/* the name, not null terminated if full */
+  struct dcache *dc_hash;	/* next entry on the same hash chain */
+  struct dcache *dc_next;	/* next entry in LRU order */
+  struct dcache *dc_prev;	/* previous entry in LRU order */
+} dcache[NR_DCACHE];
+
+#define NIL_DC	((struct dcache *) 0)
+
+PRIVATE struct dcache *dc_hash[NR_DC_HASH];
+PRIVATE struct dcache *dc_front;	/* least recently used entry */
+PRIVATE struct dcache *dc_rear;		/* most recently used entry */
+
+FORWARD _PROTOTYPE( int dc_name_len, (char *string)			);
+FORWARD _PROTOTYPE( struct dcache **dc_chain, (Dev_t dev, Ino_t dir,
+						char *string, int len)	);
+FORWARD _PROTOTYPE( void dc_unhash, (struct dcache *dcp)		);
+FORWARD _PROTOTYPE( void dc_move, (struct dcache *dcp, int to_front)	);
+
+/*===========================================================================*
+ *				init_dcache				     *
+ *===========================================================================*/
+PUBLIC void init_dcache()
+{
+/* Put all entries on the LRU chain, empty. */
+  struct dcache *dcp;
+
+  for (dcp = &dcache[0]; dcp < &dcache[NR_DCACHE]; dcp++) {
+	dcp->dc_dev = NO_DEV;
+	dcp->dc_hash = NIL_DC;
+	dcp->dc_next = dcp + 1;
+	dcp->dc_prev = dcp - 1;
+  }
+  dcache[0].dc_prev = NIL_DC;
+  dcache[NR_DCACHE - 1].dc_next = NIL_DC;
+  dc_front = &dcache[0];
+  dc_rear = &dcache[NR_DCACHE - 1];
+}
+
+/*===========================================================================*
+ *				dc_lookup				     *
+ *===========================================================================*/
+PUBLIC int dc_lookup(dirp, string, numb)
+struct inode *dirp;		/* directory to look in */
+char string[NAME_MAX];		/* component to look for */
+ino_t *numb;			/* inode number, 0 if the name is absent */
+{
+/* Look up a name in the cache.  Return TRUE if the cache knows the answer,
+ * in which case '*numb' is the inode number of the name or 0 if the name is
+ * not in the directory.  Return FALSE if the directory must be searched.
+ */
+  struct dcache *dcp;
+  int len;
+
+  if ((len = dc_name_len(string)) < 0) return(FALSE);
+  dcp = *dc_chain(dirp->i_dev, dirp->i_num, string, len);
+  if (dcp == NIL_DC) return(FALSE);
+
+  dc_move(dcp, FALSE);
+  *numb = dcp->dc_ino;
+  return(TRUE);
+}
+
+/*===========================================================================*
+ *				dc_enter				     *
+ *===========================================================================*/
+PUBLIC void dc_enter(dirp, string, numb)
+struct inode *dirp;		/* directory the name is in, or is not in */
+char string[NAME_MAX];		/* the name */
+ino_t numb;			/* its inode number, 0 if absent */
+{
+/* Record what a search of a directory found out, or a change that was made
+ * to it.  An existing entry for the name is updated, otherwise the least
+ * recently used entry is reused.
+ */
+  struct dcache **dcpp, *dcp;
+  int len;
+
+  if ((len = dc_name_len(string)) < 0) return;
+  dcpp = dc_chain(dirp->i_dev, dirp->i_num, string, len);
+
+  if ((dcp = *dcpp) == NIL_DC) {
+	/* Not known yet.  Reuse the least recently used entry. */
+	dcp = dc_front;
+	dc_unhash(dcp);
+	dcp->dc_dev = dirp->i_dev;
+	dcp->dc_dir = dirp->i_num;
+	memcpy(dcp->dc_name, string, (size_t) len);
+	if (len < DC_NAME_LEN) dcp->dc_name[len] = '\0';
+
+	/* The chain may have changed; find its end again. */
+	dcpp = dc_chain(dirp->i_dev, dirp->i_num, string, len);
+	dcp->dc_hash = NIL_DC;
+	*dcpp = dcp;
+  }
+  dcp->dc_ino = numb;
+  dc_move(dcp, FALSE);
+}
+
+/*===========================================================================*
+ *				dc_purge_dev				     *
+ *===========================================================================*/
+PUBLIC void dc_purge_dev(dev)
+dev_t dev;			/* device whose entries are to be removed */
+{
+/* Remove all the entries of a device, because it is (un)mounted. */
+  struct dcache *dcp;
+
+  for (dcp = &dcache[0]; dcp < &dcache[NR_DCACHE]; dcp++) {
+	if (dcp->dc_dev == dev) {
+		dc_unhash(dcp);
+		dc_move(dcp, TRUE);
+	}
+  }
+}
+
+/*===========================================================================*
+ *				dc_name_len				     *
+ *===========================================================================*/
+PRIVATE int dc_name_len(string)
+char *string;
+{
+/* Return the length of a path name component, or -1 if it is too long to be
+ * cached.
+ */
+  int len;
+
+  for (len = 0; len < NAME_MAX && string[len] != '\0'; len++)
+	if (len == DC_NAME_LEN) return(-1);
+  return(len);
+}
+
+/*===========================================================================*
+ *				dc_chain				     *
+ *===========================================================================*/
+PRIVATE struct dcache **dc_chain(dev, dir, string, len)
+dev_t dev;			/* device of the directory */
+ino_t dir;			/* inode number of the directory */
+char *string;			/* name in the directory */
+int len;			/* its length */
+{
+/* Search the hash chain for a name.  Return a pointer to the link that points
+ * to its entry, or to the null link at the end of the chain if it is absent.
+ */
+  struct dcache **dcpp;
+  unsigned h;
+  int i;
+
+  h = (unsigned) dev + (unsigned) dir * 31;
+  for (i = 0; i < len; i++) h = h * 31 + (unsigned char) string[i];
+
+  for (dcpp = &dc_hash[h & (NR_DC_HASH - 1)]; *dcpp != NIL_DC;
+						dcpp = &(*dcpp)->dc_hash) {
+	if ((*dcpp)->dc_dir == dir && (*dcpp)->dc_dev == dev
+		&& strncmp((*dcpp)->dc_name, string, (size_t) len) == 0
+		&& (len == DC_NAME_LEN || (*dcpp)->dc_name[len] == '\0'))
+		break;
+  }
+  return(dcpp);
+}
+
+/*===========================================================================*
+ *				dc_unhash				     *
+ *===========================================================================*/
+PRIVATE void dc_unhash(dcp)
+struct dcache *dcp;
+{
+/* Remove an entry from its hash chain and mark it free. */
+  struct dcache **dcpp;
+  int len;
+
+  if (dcp->dc_dev == NO_DEV) return;
+  for (len = 0; len < DC_NAME_LEN && dcp->dc_name[len] != '\0'; len++) ;
+  dcpp = dc_chain(dcp->dc_dev, dcp->dc_dir, dcp->dc_name, len);
+  *dcpp = dcp->dc_hash;
+  dcp->dc_dev = NO_DEV;
+}
+
+/*===========================================================================*
+ *				dc_move					     *
+ *===========================================================================*/
+PRIVATE void dc_move(dcp, to_front)
+struct dcache *dcp;
+int to_front;			/* TRUE to reuse this entry first */
+{
+/* Move an entry to the front or the rear of the LRU chain. */
+
+  /* Take it off the chain. */
+  if (dcp->dc_prev != NIL_DC) dcp->dc_prev->dc_next = dcp->dc_next;
+  else dc_front = dcp->dc_next;
+  if (dcp->dc_next != NIL_DC) dcp->dc_next->dc_prev = dcp->dc_prev;
+  else dc_rear = dcp->dc_prev;
+
+  /* And put it back on the right end. */
+  if (to_front) {
+	dcp->dc_prev = NIL_DC;
+	dcp->dc_next = dc_front;
+	if (dc_front != NIL_DC) dc_front->dc_prev = dcp;
+	else dc_rear = dcp;
+	dc_front = dcp;
+  } else {
+	dcp->dc_next = NIL_DC;
+	dcp->dc_prev = dc_rear;
+	if (dc_rear != NIL_DC) dc_rear->dc_next = dcp;
+	else dc_front = dcp;
+	dc_rear = dcp;
+  }
+}
@@ -14,6 +14,7 @@ EXTERN off_t rdahedpos;		/* position to read ahead */
 EXTERN struct inode *rdahed_inode;	/* pointer to inode to read ahead */
 EXTERN Dev_t root_dev;		/* device number of the root device */
 EXTERN time_t boottime;		/* time in seconds at system boot */
+EXTERN struct fs_stats fs_stats;	/* counters exported to IS */
 
 /* The parameters of the call are kept here. */
 EXTERN message m_in;		/* the input message itself */
@@ -14,6 +14,7 @@
  *   old_icopy:	   copy to/from in-core inode struct and disk inode (V1.x)
  *   new_icopy:	   copy to/from in-core inode struct and disk inode (V2.x)
  *   dup_inode:	   indicate that someone else is using an inode table entry
+ *   invalidate_inodes: forget the unused inodes of some device
  */
 
 #include "fs.h"
@@ -27,6 +28,10 @@ FORWARD _PROTOTYPE( void old_icopy, (struct inode *rip, d1_inode *dip,
 						int direction, int norm));
 FORWARD _PROTOTYPE( void new_icopy, (struct inode *rip, d2_inode *dip,
 						int direction, int norm));
+FORWARD _PROTOTYPE( void hash_inode, (struct inode *rip)		);
+FORWARD _PROTOTYPE( void unhash_inode, (struct inode *rip)		);
+FORWARD _PROTOTYPE( void rm_ilru, (struct inode *rip)			);
+FORWARD _PROTOTYPE( void add_ilru, (struct inode *rip, int at_front)	);
 
 /*===========================================================================*
  *				get_inode				     *
@@ -37,36 +42,50 @@ int numb;			/* inode number (ANSI: may not be unshort) */
 {
 /* Find a slot in the inode table, load the specified inode into it, and
  * return a pointer to the slot.  If 'dev' == NO_DEV, just return a free slot.
+ * The inode may still be in the table from an earlier use, in use or not; the
+ * hash chain finds it.  Otherwise the least recently used unused slot is
+ * taken.
  */
 
   register struct inode *rip, *xp;
 
-  /* Search the inode table both for (dev, numb) and a free slot. */
-  xp = NIL_INODE;
-  for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++) {
-	if (rip->i_count > 0) { /* only check used slots for (dev, numb) */
+  /* Search the hash chain for (dev, numb). */
+  if (dev != NO_DEV) {
+	for (rip = inode_hash[INODE_HASH(dev, numb)]; rip != NIL_INODE;
+							rip = rip->i_hash) {
 		if (rip->i_dev == dev && rip->i_num == numb) {
 			/* This is the inode that we are looking for. */
+			if (rip->i_count == 0) rm_ilru(rip);
 			rip->i_count++;
 			return(rip);	/* (dev, numb) found */
 		}
-	} else {
-		xp = rip;	/* remember this free slot for later */
 	}
   }
 
-  /* Inode we want is not currently in use.  Did we find a free slot? */
-  if (xp == NIL_INODE) {	/* inode table completely full */
+  /* Inode we want is not in the table.  Is there an unused slot? */
+  if ((xp = inode_front) == NIL_INODE) {	/* inode table completely full */
 	err_code = ENFILE;
 	return(NIL_INODE);
   }
+  rm_ilru(xp);
+  unhash_inode(xp);		/* forget what the slot held before */
 
-  /* A free inode slot has been located.  Load the inode into it. */
+  /* An unused inode slot has been located.  Load the inode into it. */
   xp->i_dev = dev;
   xp->i_num = numb;
   xp->i_count = 1;
-  if (dev != NO_DEV) rw_inode(xp, READING);	/* get inode from disk */
+  if (dev != NO_DEV) {
+	rw_inode(xp, READING);	/* get inode from disk */
+	hash_inode(xp);
+  }
   xp->i_update = 0;		/* all the times are initially up-to-date */
+  xp->i_ra_hist = 0;		/* nothing read yet */
+  xp->i_ra_win = 0;
+  xp->i_ra_pos = 0;
+  xp->i_ra_end = 0;
+  xp->i_prealloc = 0;		/* no zones reserved */
+  xp->i_nextrun = 0;
+  clear_runs(xp);
 
   return(xp);
 }
@@ -84,6 +103,7 @@ register struct inode *rip;	/* pointer to inode to be released */
 
   if (rip == NIL_INODE) return;	/* checking here is easier than in caller */
   if (--rip->i_count == 0) {	/* i_count == 0 means no one is using it now */
+	free_prealloc(rip);	/* give back zones reserved for growth */
 	if (rip->i_nlinks == 0) {
 		/* i_nlinks == 0 means free the inode. */
 		truncate(rip);	/* return all the disk blocks */
@@ -95,6 +115,15 @@ register struct inode *rip;	/* pointer to inode to be released */
 	}
 	rip->i_pipe = NO_PIPE;  /* should always be cleared */
 	if (rip->i_dirt == DIRTY) rw_inode(rip, WRITING);
+
+	/* Keep the inode for later use, unless it is gone from the disk. */
+	if (rip->i_nlinks == 0) {
+		unhash_inode(rip);
+		rip->i_dev = NO_DEV;
+		add_ilru(rip, TRUE);
+	} else {
+		add_ilru(rip, FALSE);
+	}
   }
 }
 
@@ -140,6 +169,7 @@ PUBLIC struct inode *alloc_inode(dev_t dev, mode_t bits)
 	rip->i_uid = fp->fp_effuid;	/* file's uid is owner's */
 	rip->i_gid = fp->fp_effgid;	/* ditto group id */
 	rip->i_dev = dev;		/* mark which device it is on */
+	hash_inode(rip);
 	rip->i_ndzones = sp->s_ndzones;	/* number of direct zones */
 	rip->i_nindirs = sp->s_nindirs;	/* number of indirect zones per blk*/
 	rip->i_sp = sp;			/* pointer to super block */
@@ -172,6 +202,7 @@ register struct inode *rip;	/* the inode to be erased */
   rip->i_update = ATIME | CTIME | MTIME;	/* update all times later */
   rip->i_dirt = DIRTY;
   for (i = 0; i < V2_NR_TZONES; i++) rip->i_zone[i] = NO_ZONE;
+  clear_runs(rip);
 }
 
 /*===========================================================================*
@@ -364,3 +395,107 @@ struct inode *ip;		/* The inode to be duplicated. */
 
   ip->i_count++;
 }
+
+/*===========================================================================*
+ *				invalidate_inodes			     *
+ *===========================================================================*/
+PUBLIC void invalidate_inodes(dev)
+dev_t dev;			/* device whose inodes are to be forgotten */
+{
+/* Remove the unused inodes of a device from the inode table, so that they are
+ * not found after the device has been unmounted.
+ */
+  register struct inode *rip;
+
+  for (rip = &inode[0]; rip < &inode[nr_inodes]; rip++) {
+	if (rip->i_count == 0 && rip->i_dev == dev) {
+		unhash_inode(rip);
+		rip->i_dev = NO_DEV;
+		rm_ilru(rip);
+		add_ilru(rip, TRUE);
+	}
+  }
+}
+
+/*===========================================================================*
+ *				hash_inode				     *
+ *===========================================================================*/
+PRIVATE void hash_inode(rip)
+register struct inode *rip;
+{
+/* Put an inode on the hash chain for its (dev, inode number). */
+  int h;
+
+  h = INODE_HASH(rip->i_dev, rip->i_num);
+  rip->i_hash = inode_hash[h];
+  inode_hash[h] = rip;
+}
+
+/*===========================================================================*
+ *				unhash_inode				     *
+ *===========================================================================*/
+PRIVATE void unhash_inode(rip)
+register struct inode *rip;
+{
+/* Remove an inode from its hash chain, if it is on one. */
+  register struct inode **ipp;
+
+  if (rip->i_dev == NO_DEV) return;
+  for (ipp = &inode_hash[INODE_HASH(rip->i_dev, rip->i_num)];
+				*ipp != NIL_INODE; ipp = &(*ipp)->i_hash) {
+	if (*ipp == rip) {
+		*ipp = rip->i_hash;
+		break;
+	}
+  }
+  rip->i_hash = NIL_INODE;
+}
+
+/*===========================================================================*
+ *				rm_ilru					     *
+ *===========================================================================*/
+PRIVATE void rm_ilru(rip)
+register struct inode *rip;
+{
+/* Remove an inode from the chain of unused inodes. */
+
+  if (rip->i_prev != NIL_INODE)
+	rip->i_prev->i_next = rip->i_next;
+  else
+	inode_front = rip->i_next;	/* this inode was at front of chain */
+
+  if (rip->i_next != NIL_INODE)
+	rip->i_next->i_prev = rip->i_prev;
+  else
+	inode_rear = rip->i_prev;	/* this inode was at rear of chain */
+}
+
+/*===========================================================================*
+ *				add_ilru				     *
+ *===========================================================================*/
+PRIVATE void add_ilru(rip, at_front)
+register struct inode *rip;
+int at_front;			/* TRUE if the slot is to be reused first */
+{
+/* Put an inode that is no longer used on the chain of unused inodes.  Free
+ * slots go on the front, cached inodes on the rear.
+ */
+
+  if (at_front) {
+	rip->i_prev = NIL_INODE;
+	rip->i_next = inode_front;
+	if (inode_front == NIL_INODE)
+		inode_rear = rip;	/* chain was empty */
+	else
+		inode_front->i_prev = rip;
+	inode_front = rip;
+  } else {
+	rip->i_prev = inode_rear;
+	rip->i_next = NIL_INODE;
+	if (inode_rear == NIL_INODE)
+		inode_front = rip;	/* chain was empty */
+	else
+		inode_rear->i_next = rip;
+	inode_rear = rip;
+  }
+}
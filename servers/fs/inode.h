@@ -6,6 +6,18 @@
  * disk; the second part holds fields not present on the disk.
  * The disk inode part is also declared in "type.h" as 'd1_inode' for V1
  * file systems and 'd2_inode' for V2 file systems.
+ *
+ * An inode that nobody uses any more stays in the table, so it need not be
+ * read from the disk again if it is wanted soon.  All inodes that are found
+ * on the disk are on a hash chain by (dev, inode number).  The slots that are
+ * not in use, cached or free, are chained in LRU order, with 'inode_front'
+ * pointing to the slot to be reused first.  The number of slots comes from
+ * the 'inodes' boot parameter.
+ *
+ * Read_map() remembers a few runs of consecutive blocks of a file in i_run,
+ * so that blocks in a run are found without reading indirect blocks again.
+ * A file that grows at its end gets PREALLOC_ZONES consecutive zones reserved
+ * at a time; the ones it does not use are freed when the inode is released.
  */
 
 EXTERN struct inode {
@@ -29,16 +41,36 @@ EXTERN struct inode {
   char i_dirt;			/* CLEAN or DIRTY */
   char i_pipe;			/* set to I_PIPE if pipe */
   char i_mount;			/* this bit is set if file mounted on */
-  char i_seek;			/* set on LSEEK, cleared on READ/WRITE */
   char i_update;		/* the ATIME, CTIME, and MTIME bits are here */
-} inode[NR_INODES];
+  char i_ra_hist;		/* last reads, 1 bit each, 1 if sequential */
+  int i_ra_win;			/* read ahead window in blocks, 0 if none */
+  off_t i_ra_pos;		/* where a sequential read would start */
+  off_t i_ra_end;		/* end of what has been read ahead */
+  zone_t i_pzone;		/* first zone reserved for the file */
+  int i_prealloc;		/* # zones reserved from i_pzone on */
+  struct irun {
+	block_t ir_pos;		/* first block of the run in the file */
+	block_t ir_block;	/* its block number on the device */
+	block_t ir_len;		/* # blocks in the run, 0 if unused */
+  } i_run[NR_IRUNS];
+  int i_nextrun;		/* entry of i_run to be replaced next */
+  struct inode *i_hash;		/* next inode on the same hash chain */
+  struct inode *i_next;		/* next unused inode, toward the rear */
+  struct inode *i_prev;		/* previous unused inode, toward the front */
+} *inode;			/* nr_inodes slots */
 
 #define NIL_INODE (struct inode *) 0	/* indicates absence of inode slot */
 
+EXTERN int nr_inodes;		/* # slots in the inode table */
+EXTERN struct inode **inode_hash;	/* the inode hash table */
+EXTERN int nr_inode_hash;	/* size of inode hash table, a power of 2 */
+EXTERN struct inode *inode_front;	/* unused inode to be reused first */
+EXTERN struct inode *inode_rear;	/* most recently released inode */
+
+#define INODE_HASH(dev, numb)	(((int) (numb) ^ (int) (dev)) & (nr_inode_hash - 1))
+
 /* Field values.  Note that CLEAN and DIRTY are defined in "const.h" */
 #define NO_PIPE            0	/* i_pipe is NO_PIPE if inode is not a pipe */
 #define I_PIPE             1	/* i_pipe is I_PIPE if inode is a pipe */
 #define NO_MOUNT           0	/* i_mount is NO_MOUNT if file not mounted on*/
 #define I_MOUNT            1	/* i_mount is I_MOUNT if file mounted on */
-#define NO_SEEK            0	/* i_seek = NO_SEEK if last op was not SEEK */
-#define ISEEK              1	/* i_seek = ISEEK if last op was SEEK */
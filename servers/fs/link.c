@@ -332,6 +332,7 @@ register struct inode *rip;	/* pointer to inode to be truncated */
   scale = rip->i_sp->s_log_zone_size;
   zone_size = (zone_t) rip->i_sp->s_block_size << scale;
   nr_indirects = rip->i_nindirs;
+  free_prealloc(rip);		/* zones reserved for growth */
 
   /* Pipes can shrink, so adjust size to make sure all zones are removed. */
   waspipe = rip->i_pipe == I_PIPE;	/* TRUE is this was a pipe */
@@ -347,6 +348,7 @@ register struct inode *rip;	/* pointer to inode to be truncated */
 
   /* All the data zones have been freed.  Now free the indirect zones. */
   rip->i_dirt = DIRTY;
+  clear_runs(rip);
   if (waspipe) {
 	wipe_inode(rip);	/* clear out inode for pipes */
 	return;			/* indirect slots contain file positions */
@@ -16,12 +16,14 @@ struct super_block;		/* proto.h needs to know this */
 #include <stdio.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/ioc_memory.h>
 #include <sys/svrctl.h>
 #include <minix/callnr.h>
 #include <minix/com.h>
 #include <minix/keymap.h>
 #include <minix/const.h>
+#include <minix/minlib.h>
 #include "buf.h"
 #include "file.h"
 #include "fproc.h"
@@ -32,9 +34,12 @@ struct super_block;		/* proto.h needs to know this */
 FORWARD _PROTOTYPE( void fs_init, (void)				);
 FORWARD _PROTOTYPE( int igetenv, (char *var, int optional)		);
 FORWARD _PROTOTYPE( void get_work, (void)				);
+FORWARD _PROTOTYPE( void inode_pool, (void)				);
 FORWARD _PROTOTYPE( void load_ram, (void)				);
 FORWARD _PROTOTYPE( void load_super, (Dev_t super_dev)			);
 
+PRIVATE int have_tsc;		/* CPU has a cycle counter to time requests */
+
 /*===========================================================================*
  *				main					     *
  *===========================================================================*/
@@ -46,12 +51,14 @@ PUBLIC int main()
  */
   sigset_t sigset;
   int error;
+  unsigned long tsc_hi, tsc_start, tsc_end;
 
   fs_init();
 
   /* This is the main loop that gets work, processes it, and sends replies. */
   while (TRUE) {
 	get_work();		/* sets who and call_nr */
+	if (have_tsc) read_tsc(&tsc_hi, &tsc_start);
 
 	fp = &fproc[who];	/* pointer to proc table struct */
 	super_user = (fp->fp_effuid == SU_UID ? TRUE : FALSE);   /* su? */
@@ -65,7 +72,8 @@ PUBLIC int main()
 		}
         } else if (call_nr == SYN_ALARM) {
         	/* Not a user request; system has expired one of our timers,
-        	 * currently only in use for select(). Check it.
+        	 * those of select() or the write-behind timer of the cache.
+        	 * Check them.
         	 */
         	fs_expire_timers(m_in.NOTIFY_TIMESTAMP);
         } else if ((call_nr & NOTIFY_MESSAGE)) {
@@ -88,9 +96,22 @@ PUBLIC int main()
 
 		/* Copy the results back to the user and send reply. */
 		if (error != SUSPEND) { reply(who, error); }
+
+		/* Count the time until the reply, or the suspension. */
+		fs_stats.fss_calls++;
+		if (have_tsc) {
+			read_tsc(&tsc_hi, &tsc_end);
+			fs_stats.fss_call_kcycles += (tsc_end - tsc_start) >> 10;
+			count_in(fs_stats.fss_latency, _NR_FS_LATENCY,
+				(u32_t) ((tsc_end - tsc_start) >> 10));
+		}
+
 		if (rdahed_inode != NIL_INODE) {
 			read_ahead(); /* do block read ahead */
 		}
+		if (nr_dirty >= WB_HIGH_WATER) {
+			write_behind(); /* write dirty blocks early */
+		}
 	}
   }
   return(OK);				/* shouldn't come here */
@@ -129,31 +150,87 @@ PRIVATE void get_work()
   call_nr = m_in.m_type;
 }
 
+/*===========================================================================*
+ *				inode_pool				     *
+ *===========================================================================*/
+PRIVATE void inode_pool(void)
+{
+/* Initialize the inode table.  The boot parameter 'inodes' tells how many
+ * slots there are; the default is NR_INODES.  All slots start out free.
+ */
+  register struct inode *rip;
+  int h;
+
+  if ((nr_inodes = igetenv("inodes", 1)) <= 0) nr_inodes = NR_INODES;
+  for (nr_inode_hash = 1; nr_inode_hash < nr_inodes; nr_inode_hash <<= 1) ;
+
+  inode = (struct inode *) sbrk((int) (nr_inodes * sizeof(struct inode)
+				+ nr_inode_hash * sizeof(struct inode *)));
+  if (inode == (struct inode *) -1)
+	panic(__FILE__,"can't allocate inode table", nr_inodes);
+  inode_hash = (struct inode **) (inode + nr_inodes);
+
+  for (h = 0; h < nr_inode_hash; h++) inode_hash[h] = NIL_INODE;
+  for (rip = &inode[0]; rip < &inode[nr_inodes]; rip++) {
+	rip->i_count = 0;
+	rip->i_dev = NO_DEV;
+	rip->i_hash = NIL_INODE;
+	rip->i_next = rip + 1;
+	rip->i_prev = rip - 1;
+  }
+  inode[0].i_prev = NIL_INODE;
+  inode[nr_inodes - 1].i_next = NIL_INODE;
+  inode_front = &inode[0];
+  inode_rear = &inode[nr_inodes - 1];
+}
+
 /*===========================================================================*
  *				buf_pool				     *
  *===========================================================================*/
 PRIVATE void buf_pool(void)
 {
-/* Initialize the buffer pool. */
-
-  register struct buf *bp;
-
-  bufs_in_use = 0;
-  front = &buf[0];
-  rear = &buf[NR_BUFS - 1];
-
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++) {
-	bp->b_blocknr = NO_BLOCK;
-	bp->b_dev = NO_DEV;
-	bp->b_next = bp + 1;
-	bp->b_prev = bp - 1;
+/* Initialize the buffer pool.  The boot parameter 'bufcache' tells how many
+ * kB of memory to use for block data; the default is what NR_BUFS buffers of
+ * MAX_BLOCK_SIZE take.  There are enough buffer headers to cut all of it into
+ * blocks of MIN_BLOCK_SIZE, and the hash table is sized to match.  If FS has
+ * less heap than asked for, the cache is halved until it fits.
+ */
+  long kb, want;
+  char *p;
+  vir_bytes hdr_bytes;
+
+  if ((kb = igetenv("bufcache", 1)) <= 0)
+	kb = (long) NR_BUFS * MAX_BLOCK_SIZE / 1024;
+  want = kb;
+
+  for (;;) {
+	buf_bytes = kb * 1024;
+	max_bufs = (int) (buf_bytes / MIN_BLOCK_SIZE);
+	for (nr_buf_hash = 1; nr_buf_hash < max_bufs; nr_buf_hash <<= 1) ;
+	hdr_bytes = max_bufs * sizeof(struct buf)
+		+ max_bufs * sizeof(struct buf *)
+		+ nr_buf_hash * sizeof(struct buf *);
+
+	/* The data is page aligned, so that no block straddles a page. */
+	p = sbrk((int) (hdr_bytes + buf_bytes + CLICK_SIZE));
+	if (p != (char *) -1) break;
+	if (kb <= 6 * MAX_BLOCK_SIZE / 1024)
+		panic(__FILE__,"can't allocate buffer cache", (int) kb);
+	kb /= 2;
   }
-  buf[0].b_prev = NIL_BUF;
-  buf[NR_BUFS - 1].b_next = NIL_BUF;
+  if (kb != want) printf("FS: buffer cache reduced to %ld kB\n", kb);
 
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++) bp->b_hash = bp->b_next;
-  buf_hash[0] = front;
+  buf = (struct buf *) p;
+  dirty_q = (struct buf **) (buf + max_bufs);
+  buf_hash = dirty_q + max_bufs;
+  p += hdr_bytes;
+  buf_data = p + (CLICK_SIZE - (vir_bytes) p % CLICK_SIZE) % CLICK_SIZE;
 
+  bufs_in_use = 0;
+  nr_bufs = 0;
+  buf_size = 0;
+  if (set_blocksize(MIN_BLOCK_SIZE) != OK)
+	panic(__FILE__,"can't set up buffer cache", NO_NUM);
 }
 
 /*===========================================================================*
@@ -183,6 +260,7 @@ PRIVATE void fs_init()
 /* Initialize global variables, tables, etc. */
   register struct inode *rip;
   register struct fproc *rfp;
+  struct machine machine;
   message mess;
   int s;
 
@@ -213,7 +291,6 @@ PRIVATE void fs_init()
    * extra block_size requirements are checked at super-block-read-in time.
    */
   if (OPEN_MAX > 127) panic(__FILE__,"OPEN_MAX > 127", NO_NUM);
-  if (NR_BUFS < 6) panic(__FILE__,"NR_BUFS < 6", NO_NUM);
   if (V1_INODE_SIZE != 32) panic(__FILE__,"V1 inode size != 32", NO_NUM);
   if (V2_INODE_SIZE != 64) panic(__FILE__,"V2 inode size != 64", NO_NUM);
   if (OPEN_MAX > 8 * sizeof(long))
@@ -223,11 +300,16 @@ PRIVATE void fs_init()
   fp = (struct fproc *) NULL;
   who = FS_PROC_NR;
 
+  /* Requests are only timed if the CPU has RDTSC, Pentium and up. */
+  have_tsc = (sys_getmachine(&machine) == OK && machine.processor > 486);
+
+  inode_pool();			/* initialize inode table */
   buf_pool();			/* initialize buffer pool */
   build_dmap();			/* build device table and map boot driver */
   load_ram();			/* init RAM disk, load if it is root */
   load_super(root_dev);		/* load super block for root device */
   init_select();		/* init select() structures */
+  init_dcache();		/* init directory name cache */
 
   /* The root device can now be accessed; set process directories. */
   for (rfp=&fproc[0]; rfp < &fproc[NR_PROCS]; rfp++) {
@@ -318,7 +400,7 @@ PRIVATE void load_ram(void)
 	/* Get size of RAM disk image from the super block. */
 	sp = &super_block[0];
 	sp->s_dev = image_dev;
-	if (read_super(sp) != OK) 
+	if (read_super(sp) != OK || set_blocksize(sp->s_block_size) != OK)
 		panic(__FILE__,"Bad RAM disk image FS", NO_NUM);
 
 	lcount = sp->s_zones << sp->s_log_zone_size;	/* # blks on root dev*/
@@ -354,7 +436,7 @@ PRIVATE void load_ram(void)
 
 #if ENABLE_CACHE2
   /* The RAM disk is a second level block cache while not otherwise used. */
-  init_cache2(ram_size);
+  if (root_dev != DEV_RAM) init_cache2(ram_size_kb);
 #endif
 
   /* See if we must load the RAM disk image, otherwise return. */
@@ -449,7 +531,7 @@ dev_t super_dev;			/* place to get superblock from */
   sp->s_dev = super_dev;
 
   /* Check super_block for consistency. */
-  bad = (read_super(sp) != OK);
+  bad = (read_super(sp) != OK || set_blocksize(sp->s_block_size) != OK);
   if (!bad) {
 	rip = get_inode(super_dev, ROOT_INODE);	/* inode for root dir */
 	if ( (rip->i_mode & I_TYPE) != I_DIRECTORY || rip->i_nlinks < 3) bad++;
@@ -54,6 +54,13 @@ PUBLIC int do_getsysinfo()
   	src_addr = (vir_bytes) dmap;
   	len = sizeof(struct dmap) * NR_DEVICES;
   	break; 
+  case SI_FS_STATS:
+  	fs_stats.fss_nr_bufs = nr_bufs;
+  	fs_stats.fss_protected = nr_protected;
+  	fs_stats.fss_dirty = nr_dirty;
+  	src_addr = (vir_bytes) &fs_stats;
+  	len = sizeof(fs_stats);
+  	break; 
   default:
   	return(EINVAL);
   }
@@ -175,11 +182,11 @@ PUBLIC int do_sync()
   register struct buf *bp;
 
   /* Write all the dirty inodes to the disk. */
-  for (rip = &inode[0]; rip < &inode[NR_INODES]; rip++)
+  for (rip = &inode[0]; rip < &inode[nr_inodes]; rip++)
 	if (rip->i_count > 0 && rip->i_dirt == DIRTY) rw_inode(rip, WRITING);
 
   /* Write all the dirty blocks to the disk, one drive at a time. */
-  for (bp = &buf[0]; bp < &buf[NR_BUFS]; bp++)
+  for (bp = &buf[0]; bp < &buf[nr_bufs]; bp++)
 	if (bp->b_dev != NO_DEV && bp->b_dirt == DIRTY) flushall(bp->b_dev);
 
   return(OK);		/* sync() can't fail */
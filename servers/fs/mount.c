@@ -56,12 +56,15 @@ PUBLIC int do_mount()
   /* Make the cache forget about blocks it has open on the filesystem */
   (void) do_sync();
   invalidate(dev);
+  invalidate_inodes(dev);
+  dc_purge_dev(dev);
 
   /* Fill in the super block. */
   sp->s_dev = dev;		/* read_super() needs to know which dev */
   r = read_super(sp);
 
-  /* Is it recognized as a Minix filesystem? */
+  /* Is it recognized as a Minix filesystem?  Can the cache hold its blocks? */
+  if (r == OK) r = set_blocksize(sp->s_block_size);
   if (r != OK) {
 	dev_close(dev);
 	sp->s_dev = NO_DEV;
@@ -110,6 +113,8 @@ PUBLIC int do_mount()
 	put_inode(root_ip);
 	(void) do_sync();
 	invalidate(dev);
+	invalidate_inodes(dev);
+	dc_purge_dev(dev);
 	dev_close(dev);
 	sp->s_dev = NO_DEV;
 	return(r);
@@ -156,7 +161,7 @@ Dev_t dev;
    * open -- the root inode -- and that inode only 1 time.
    */
   count = 0;
-  for (rip = &inode[0]; rip< &inode[NR_INODES]; rip++)
+  for (rip = &inode[0]; rip< &inode[nr_inodes]; rip++)
 	if (rip->i_count > 0 && rip->i_dev == dev) count += rip->i_count;
   if (count > 1) return(EBUSY);	/* can't umount a busy file system */
 
@@ -183,6 +188,8 @@ Dev_t dev;
   sp->s_imount->i_mount = NO_MOUNT;	/* inode returns to normal */
   put_inode(sp->s_imount);	/* release the inode mounted on */
   put_inode(sp->s_isup);	/* release the root inode of the mounted fs */
+  invalidate_inodes(dev);	/* and forget all its inodes */
+  dc_purge_dev(dev);		/* and names */
   sp->s_imount = NIL_INODE;
   sp->s_dev = NO_DEV;
   return(OK);
@@ -273,6 +273,10 @@ int flag;			 /* LOOK_UP, ENTER, DELETE or IS_EMPTY */
 	else r = forbidden(ldir_ptr, bits); /* check access permissions */
   }
   if (r != OK) return(r);
+
+  /* The name cache may know the answer to a look up. */
+  if (flag == LOOK_UP && dc_lookup(ldir_ptr, string, numb))
+	return(*numb != 0 ? OK : ENOENT);
   
   /* Step through the directory one block at a time. */
   old_slots = (unsigned) (ldir_ptr->i_size/DIR_ENTRY_SIZE);
@@ -320,12 +324,14 @@ int flag;			 /* LOOK_UP, ENTER, DELETE or IS_EMPTY */
 				t = NAME_MAX - sizeof(ino_t);
 				*((ino_t *) &dp->d_name[t]) = dp->d_ino;
 				dp->d_ino = 0;	/* erase entry */
+				dc_enter(ldir_ptr, string, (ino_t) 0);
 				bp->b_dirt = DIRTY;
 				ldir_ptr->i_update |= CTIME | MTIME;
 				ldir_ptr->i_dirt = DIRTY;
 			} else {
 				sp = ldir_ptr->i_sp;	/* 'flag' is LOOK_UP */
 				*numb = conv4(sp->s_native, (int) dp->d_ino);
+				dc_enter(ldir_ptr, string, *numb);
 			}
 			put_block(bp, DIRECTORY_BLOCK);
 			return(r);
@@ -345,6 +351,7 @@ int flag;			 /* LOOK_UP, ENTER, DELETE or IS_EMPTY */
 
   /* The whole directory has now been searched. */
   if (flag != ENTER) {
+	if (flag == LOOK_UP) dc_enter(ldir_ptr, string, (ino_t) 0);
   	return(flag == IS_EMPTY ? OK : ENOENT);
   }
 
@@ -365,6 +372,7 @@ int flag;			 /* LOOK_UP, ENTER, DELETE or IS_EMPTY */
   for (i = 0; string[i] && i < NAME_MAX; i++) dp->d_name[i] = string[i];
   sp = ldir_ptr->i_sp; 
   dp->d_ino = conv4(sp->s_native, (int) *numb);
+  dc_enter(ldir_ptr, string, *numb);
   bp->b_dirt = DIRTY;
   put_block(bp, DIRECTORY_BLOCK);
   ldir_ptr->i_update |= CTIME | MTIME;	/* mark mtime for update later */
@@ -13,10 +13,13 @@ _PROTOTYPE( zone_t alloc_zone, (Dev_t dev, zone_t z)			);
 _PROTOTYPE( void flushall, (Dev_t dev)					);
 _PROTOTYPE( void free_zone, (Dev_t dev, zone_t numb)			);
 _PROTOTYPE( struct buf *get_block, (Dev_t dev, block_t block,int only_search));
+_PROTOTYPE( int in_cache, (Dev_t dev, block_t block)			);
 _PROTOTYPE( void invalidate, (Dev_t device)				);
 _PROTOTYPE( void put_block, (struct buf *bp, int block_type)		);
 _PROTOTYPE( void rw_scattered, (Dev_t dev,
 			struct buf **bufq, int bufqsize, int rw_flag)	);
+_PROTOTYPE( int set_blocksize, (int block_size)				);
+_PROTOTYPE( void write_behind, (void)					);
 
 #if ENABLE_CACHE2
 /* cache2.c */
@@ -26,6 +29,14 @@ _PROTOTYPE( void put_block2, (struct buf *bp)				);
 _PROTOTYPE( void invalidate2, (Dev_t device)				);
 #endif
 
+/* dcache.c */
+_PROTOTYPE( int dc_lookup, (struct inode *dirp, char string[NAME_MAX],
+							ino_t *numb)	);
+_PROTOTYPE( void dc_enter, (struct inode *dirp, char string[NAME_MAX],
+							Ino_t numb)	);
+_PROTOTYPE( void dc_purge_dev, (Dev_t dev)				);
+_PROTOTYPE( void init_dcache, (void)					);
+
 /* device.c */
 _PROTOTYPE( int dev_open, (Dev_t dev, int proc, int flags)		);
 _PROTOTYPE( void dev_close, (Dev_t dev)					);
@@ -65,6 +76,7 @@ _PROTOTYPE( struct inode *alloc_inode, (dev_t dev, mode_t bits)		);
 _PROTOTYPE( void dup_inode, (struct inode *ip)				);
 _PROTOTYPE( void free_inode, (Dev_t dev, Ino_t numb)			);
 _PROTOTYPE( struct inode *get_inode, (Dev_t dev, int numb)		);
+_PROTOTYPE( void invalidate_inodes, (Dev_t dev)				);
 _PROTOTYPE( void put_inode, (struct inode *rip)				);
 _PROTOTYPE( void update_times, (struct inode *rip)			);
 _PROTOTYPE( void rw_inode, (struct inode *rip, int rw_flag)		);
@@ -145,6 +157,7 @@ _PROTOTYPE( struct buf *rahead, (struct inode *rip, block_t baseblock,
 			off_t position, unsigned bytes_ahead)		);
 _PROTOTYPE( void read_ahead, (void)					);
 _PROTOTYPE( block_t read_map, (struct inode *rip, off_t position)	);
+_PROTOTYPE( void clear_runs, (struct inode *rip)			);
 _PROTOTYPE( int read_write, (int rw_flag)				);
 _PROTOTYPE( zone_t rd_indir, (struct buf *bp, int index)		);
 
@@ -158,6 +171,7 @@ _PROTOTYPE( int do_fstatfs, (void)					);
 
 /* super.c */
 _PROTOTYPE( bit_t alloc_bit, (struct super_block *sp, int map, bit_t origin));
+_PROTOTYPE( bit_t alloc_run, (struct super_block *sp, int count)	);
 _PROTOTYPE( void free_bit, (struct super_block *sp, int map,
 						bit_t bit_returned)	);
 _PROTOTYPE( struct super_block *get_super, (Dev_t dev)			);
@@ -173,6 +187,7 @@ _PROTOTYPE( int do_utime, (void)					);
 _PROTOTYPE( time_t clock_time, (void)					);
 _PROTOTYPE( unsigned conv2, (int norm, int w)				);
 _PROTOTYPE( long conv4, (int norm, long x)				);
+_PROTOTYPE( void count_in, (u32_t *histogram, int buckets, u32_t value)	);
 _PROTOTYPE( int fetch_name, (char *path, int len, int flag)		);
 _PROTOTYPE( int no_sys, (void)						);
 _PROTOTYPE( void panic, (char *who, char *mess, int num)		);
@@ -180,6 +195,7 @@ _PROTOTYPE( void panic, (char *who, char *mess, int num)		);
 /* write.c */
 _PROTOTYPE( void clear_zone, (struct inode *rip, off_t pos, int flag)	);
 _PROTOTYPE( int do_write, (void)					);
+_PROTOTYPE( void free_prealloc, (struct inode *rip)			);
 _PROTOTYPE( struct buf *new_block, (struct inode *rip, off_t position)	);
 _PROTOTYPE( void zero_block, (struct buf *bp)				);
 
@@ -3,10 +3,21 @@
  * block boundaries.  Each chunk is then processed in turn.  Reads on special
  * files are also detected and handled.
  *
+ * The copies between the block buffers and user space are not done chunk by
+ * chunk.  The buffers are held while a vector of copy requests is built up,
+ * and the whole vector is then handed to the kernel in one sys_virvcopy().
+ *
+ * Each inode keeps its own read ahead state, so that several files can be
+ * read sequentially at the same time.  The window grows while a file is read
+ * sequentially and collapses when it is read at random.  A read only waits
+ * for the blocks it asks for; the rest of the window is read by read_ahead()
+ * after the reply has been sent.
+ *
  * The entry points into this file are
  *   do_read:	 perform the READ system call by calling read_write
  *   read_write: actually do the work of READ and WRITE
  *   read_map:	 given an inode and file position, look up its zone number
+ *   clear_runs: forget the runs of blocks read_map() found in a file
  *   rd_indir:	 read an entry in an indirect block 
  *   read_ahead: manage the block read ahead business
  */
@@ -23,7 +34,26 @@
 
 FORWARD _PROTOTYPE( int rw_chunk, (struct inode *rip, off_t position,
 	unsigned off, int chunk, unsigned left, int rw_flag,
-	char *buff, int seg, int usr, int block_size, int *completed));
+	char *buff, int seg, int usr, int block_size)			);
+FORWARD _PROTOTYPE( int rw_flush, (int rw_flag, unsigned *undone)	);
+FORWARD _PROTOTYPE( void ra_update, (struct inode *rip, off_t start,
+					off_t position, int block_size)	);
+FORWARD _PROTOTYPE( void add_run, (struct inode *rip, long zone,
+				struct buf *bp, int index, int limit)	);
+
+/* Copies queued by rw_chunk(), and the buffers they are from or go to. */
+PRIVATE struct vir_cp_req rw_vec[CPVVEC_NR];
+PRIVATE struct buf *rw_buf[CPVVEC_NR];
+PRIVATE int rw_type[CPVVEC_NR];		/* block type for put_block() */
+PRIVATE int rw_undo[CPVVEC_NR];		/* what to do if a write is not done */
+PRIVATE int rw_count;			/* number of queued copies */
+
+/* Values of rw_undo[]: the buffer still holds the block, it is a newly
+ * allocated block that must reach the disk as zeros, or it holds junk.
+ */
+#define UNDO_KEEP	0
+#define UNDO_ZERO	1
+#define UNDO_DROP	2
 
 /*===========================================================================*
  *				do_read					     *
@@ -43,14 +73,15 @@ int rw_flag;			/* READING or WRITING */
 
   register struct inode *rip;
   register struct filp *f;
-  off_t bytes_left, f_size, position;
+  off_t bytes_left, f_size, position, start;
   unsigned int off, cum_io;
   int op, oflags, r, chunk, usr, seg, block_spec, char_spec;
   int regular, partial_pipe = 0, partial_cnt = 0;
   mode_t mode_word;
   struct filp *wf;
   int block_size;
-  int completed, r2 = OK;
+  int r2 = OK;
+  unsigned undone;
   phys_bytes p;
 
   /* left unfinished rw_chunk()s from previous call! this can't happen.
@@ -86,6 +117,7 @@ int rw_flag;			/* READING or WRITING */
   if ((r = sys_umap(usr, seg, (vir_bytes) m_in.buffer, m_in.nbytes, &p)) != OK)
 	return r;
   position = f->filp_pos;
+  start = position;
   oflags = f->filp_flags;
   rip = f->filp_ino;
   f_size = rip->i_size;
@@ -153,7 +185,6 @@ int rw_flag;			/* READING or WRITING */
 	}
 
 	if (partial_cnt > 0) partial_pipe = 1;
-
 	/* Split the transfer into chunks that don't span two blocks. */
 	while (m_in.nbytes != 0) {
 
@@ -170,9 +201,9 @@ int rw_flag;			/* READING or WRITING */
 			if (chunk > bytes_left) chunk = (int) bytes_left;
 		}
 
-		/* Read or write 'chunk' bytes. */
+		/* Queue the copy of 'chunk' bytes. */
 		r = rw_chunk(rip, position, off, chunk, (unsigned) m_in.nbytes,
-			     rw_flag, m_in.buffer, seg, usr, block_size, &completed);
+			     rw_flag, m_in.buffer, seg, usr, block_size);
 
 		if (r != OK) break;	/* EOF reached */
 		if (rdwt_err < 0) break;
@@ -187,6 +218,22 @@ int rw_flag;			/* READING or WRITING */
 			partial_cnt -= chunk;
 			if (partial_cnt <= 0)  break;
 		}
+
+		/* Do the queued copies when the vector is full, or before
+		 * too much of the cache is held.
+		 */
+		if (rw_count == CPVVEC_NR || bufs_in_use >= nr_bufs / 2) {
+			if ((r2 = rw_flush(rw_flag, &undone)) != OK) break;
+		}
+	}
+
+	/* Do the copies that are still queued.  Bytes that could not be
+	 * copied were not read or written after all.
+	 */
+	if (r2 == OK) r2 = rw_flush(rw_flag, &undone);
+	if (r2 != OK) {
+		cum_io -= undone;
+		position -= undone;
 	}
   }
 
@@ -209,12 +256,10 @@ int rw_flag;			/* READING or WRITING */
   f->filp_pos = position;
 
   /* Check to see if read-ahead is called for, and if so, set it up. */
-  if (rw_flag == READING && rip->i_seek == NO_SEEK && position % block_size== 0
+  if (rw_flag == READING && rip->i_pipe != I_PIPE
 		&& (regular || mode_word == I_DIRECTORY)) {
-	rdahed_inode = rip;
-	rdahedpos = position;
+	ra_update(rip, start, position, block_size);
   }
-  rip->i_seek = NO_SEEK;
 
   if (rdwt_err != OK) r = rdwt_err;	/* check for disk error */
   if (rdwt_err == END_OF_FILE) r = OK;
@@ -250,7 +295,7 @@ int rw_flag;			/* READING or WRITING */
  *				rw_chunk				     *
  *===========================================================================*/
 PRIVATE int rw_chunk(rip, position, off, chunk, left, rw_flag, buff,
- seg, usr, block_size, completed)
+ seg, usr, block_size)
 register struct inode *rip;	/* pointer to inode for file to be rd/wr */
 off_t position;			/* position within file to read or write */
 unsigned off;			/* off within the current block */
@@ -261,18 +306,17 @@ char *buff;			/* virtual address of the user buffer */
 int seg;			/* T or D segment in user space */
 int usr;			/* which user process */
 int block_size;			/* block size of FS operating on */
-int *completed;			/* number of bytes copied */
 {
-/* Read or write (part of) a block. */
+/* Read or write (part of) a block.  The block is acquired here, but the copy
+ * is only queued; rw_flush() does it and releases the block.
+ */
 
   register struct buf *bp;
-  register int r = OK;
-  int n, block_spec;
+  register struct vir_cp_req *req;
+  int n, block_spec, undo;
   block_t b;
   dev_t dev;
 
-  *completed = 0;
-
   block_spec = (rip->i_mode & I_TYPE) == I_BLOCK_SPECIAL;
   if (block_spec) {
 	b = position/block_size;
@@ -282,6 +326,7 @@ int *completed;			/* number of bytes copied */
 	dev = rip->i_dev;
   }
 
+  undo = UNDO_KEEP;
   if (!block_spec && b == NO_BLOCK) {
 	if (rw_flag == READING) {
 		/* Reading from a nonexistent block.  Must read as all zeros.*/
@@ -290,6 +335,7 @@ int *completed;			/* number of bytes copied */
 	} else {
 		/* Writing to a nonexistent block. Create and enter in inode.*/
 		if ((bp= new_block(rip, position)) == NIL_BUF)return(err_code);
+		undo = UNDO_ZERO;
 	}
   } else if (rw_flag == READING) {
 	/* Read and read ahead if convenient. */
@@ -301,6 +347,7 @@ int *completed;			/* number of bytes copied */
 	 */
 	n = (chunk == block_size ? NO_READ : NORMAL);
 	if (!block_spec && off == 0 && position >= rip->i_size) n = NO_READ;
+	if (n == NO_READ && !in_cache(dev, b)) undo = UNDO_DROP;
 	bp = get_block(dev, b, n);
   }
 
@@ -313,21 +360,71 @@ int *completed;			/* number of bytes copied */
 	zero_block(bp);
   }
 
+  req = &rw_vec[rw_count];
   if (rw_flag == READING) {
 	/* Copy a chunk from the block buffer to user space. */
-	r = sys_vircopy(FS_PROC_NR, D, (phys_bytes) (bp->b_data+off),
-			usr, seg, (phys_bytes) buff,
-			(phys_bytes) chunk);
+	req->src.proc_nr = FS_PROC_NR;
+	req->src.segment = D;
+	req->src.offset = (vir_bytes) (bp->b_data+off);
+	req->dst.proc_nr = usr;
+	req->dst.segment = seg;
+	req->dst.offset = (vir_bytes) buff;
   } else {
 	/* Copy a chunk from user space to the block buffer. */
-	r = sys_vircopy(usr, seg, (phys_bytes) buff,
-			FS_PROC_NR, D, (phys_bytes) (bp->b_data+off),
-			(phys_bytes) chunk);
-	bp->b_dirt = DIRTY;
+	req->src.proc_nr = usr;
+	req->src.segment = seg;
+	req->src.offset = (vir_bytes) buff;
+	req->dst.proc_nr = FS_PROC_NR;
+	req->dst.segment = D;
+	req->dst.offset = (vir_bytes) (bp->b_data+off);
   }
-  n = (off + chunk == block_size ? FULL_DATA_BLOCK : PARTIAL_DATA_BLOCK);
-  put_block(bp, n);
+  req->count = (phys_bytes) chunk;
+  rw_type[rw_count] =
+	(off + chunk == block_size ? FULL_DATA_BLOCK : PARTIAL_DATA_BLOCK);
+  rw_undo[rw_count] = undo;
+  rw_buf[rw_count++] = bp;
+
+  return(OK);
+}
 
+/*===========================================================================*
+ *				rw_flush				     *
+ *===========================================================================*/
+PRIVATE int rw_flush(rw_flag, undone)
+int rw_flag;			/* READING or WRITING */
+unsigned *undone;		/* return: number of bytes not copied */
+{
+/* Do the copies queued by rw_chunk() with a single kernel call, and release
+ * the buffers.  If a copy fails, the ones after it are not done either.  Their
+ * blocks must not be written with whatever the buffers held before: a block
+ * that was only acquired to be overwritten is forgotten, and one allocated
+ * for the write goes to the disk as the zeros new_block() filled it with.
+ */
+
+  register struct buf *bp;
+  int i, r, nr_ok;
+
+  *undone = 0;
+  if (rw_count == 0) return(OK);
+  r = sys_virvcopy(rw_vec, rw_count, &nr_ok);
+  if (r == OK) nr_ok = rw_count;
+
+  for (i = 0; i < rw_count; i++) {
+	bp = rw_buf[i];
+	if (i >= nr_ok) {
+		*undone += (unsigned) rw_vec[i].count;
+		if (rw_flag == WRITING && rw_undo[i] == UNDO_DROP) {
+			bp->b_dev = NO_DEV;	/* invalidate block */
+			bp->b_dirt = CLEAN;
+		}
+		if (rw_flag == WRITING && rw_undo[i] == UNDO_ZERO)
+			bp->b_dirt = DIRTY;
+	} else if (rw_flag == WRITING) {
+		bp->b_dirt = DIRTY;
+	}
+	put_block(bp, rw_type[i]);
+  }
+  rw_count = 0;
   return(r);
 }
 
@@ -341,16 +438,26 @@ off_t position;			/* position in file whose blk wanted */
 {
 /* Given an inode and a position within the corresponding file, locate the
  * block (not zone) number in which that position is to be found and return it.
+ * The block may be in a run that was found before.  Otherwise it is looked up,
+ * and the run of consecutive blocks that starts there is remembered.
  */
 
   register struct buf *bp;
   register zone_t z;
+  register struct irun *irp;
   int scale, boff, dzones, nr_indirects, index, zind, ex;
   block_t b;
   long excess, zone, block_pos;
   
   scale = rip->i_sp->s_log_zone_size;	/* for block-zone conversion */
   block_pos = position/rip->i_sp->s_block_size;	/* relative blk # in file */
+
+  /* Is the block in one of the runs that were found before? */
+  for (irp = &rip->i_run[0]; irp < &rip->i_run[NR_IRUNS]; irp++) {
+	if ((block_t) block_pos - irp->ir_pos < irp->ir_len)
+		return(irp->ir_block + ((block_t) block_pos - irp->ir_pos));
+  }
+
   zone = block_pos >> scale;	/* position's zone */
   boff = (int) (block_pos - (zone << scale) ); /* relative blk # within zone */
   dzones = rip->i_ndzones;
@@ -361,6 +468,7 @@ off_t position;			/* position in file whose blk wanted */
 	zind = (int) zone;	/* index should be an int */
 	z = rip->i_zone[zind];
 	if (z == NO_ZONE) return(NO_BLOCK);
+	add_run(rip, zone, NIL_BUF, zind, dzones);
 	b = ((block_t) z << scale) + boff;
 	return(b);
   }
@@ -389,12 +497,60 @@ off_t position;			/* position in file whose blk wanted */
   bp = get_block(rip->i_dev, b, NORMAL);	/* get single indirect block */
   ex = (int) excess;				/* need an integer */
   z = rd_indir(bp, ex);				/* get block pointed to */
+  if (z != NO_ZONE) add_run(rip, zone, bp, ex, nr_indirects);
   put_block(bp, INDIRECT_BLOCK);		/* release single indir blk */
   if (z == NO_ZONE) return(NO_BLOCK);
   b = ((block_t) z << scale) + boff;
   return(b);
 }
 
+/*===========================================================================*
+ *				add_run					     *
+ *===========================================================================*/
+PRIVATE void add_run(rip, zone, bp, index, limit)
+register struct inode *rip;	/* inode the run belongs to */
+long zone;			/* zone of the file that starts the run */
+struct buf *bp;			/* indirect block, or NIL_BUF for the inode */
+int index;			/* index of its zone number in the inode or *bp */
+int limit;			/* # zone numbers in the inode or *bp */
+{
+/* Remember the run of consecutive zones that starts at 'zone' of the file.
+ * The run goes on as long as the inode or the indirect block that holds the
+ * zone number lists consecutive zones.  The oldest run is replaced.
+ */
+  register struct irun *irp;
+  zone_t z, next;
+  int n, scale;
+
+  z = (bp == NIL_BUF ? rip->i_zone[index] : rd_indir(bp, index));
+  for (n = 1; index + n < limit; n++) {
+	next = (bp == NIL_BUF ? rip->i_zone[index+n] : rd_indir(bp, index+n));
+	if (next != z + n) break;
+  }
+
+  scale = rip->i_sp->s_log_zone_size;
+  irp = &rip->i_run[rip->i_nextrun];
+  if (++rip->i_nextrun == NR_IRUNS) rip->i_nextrun = 0;
+  irp->ir_pos = (block_t) zone << scale;
+  irp->ir_block = (block_t) z << scale;
+  irp->ir_len = (block_t) n << scale;
+}
+
+/*===========================================================================*
+ *				clear_runs				     *
+ *===========================================================================*/
+PUBLIC void clear_runs(rip)
+register struct inode *rip;	/* inode whose zones have changed */
+{
+/* Forget the runs that read_map() found, because the zones of the file have
+ * changed.
+ */
+  register struct irun *irp;
+
+  for (irp = &rip->i_run[0]; irp < &rip->i_run[NR_IRUNS]; irp++)
+	irp->ir_len = 0;
+}
+
 /*===========================================================================*
  *				rd_indir				     *
  *===========================================================================*/
@@ -432,20 +588,80 @@ int index;			/* index into *bp */
  *===========================================================================*/
 PUBLIC void read_ahead()
 {
-/* Read a block into the cache before it is needed. */
+/* Read the next window of a file into the cache before it is needed.  This
+ * is done after the reply to the read that called for it, so that the reader
+ * does not wait for it.
+ */
   int block_size;
   register struct inode *rip;
   struct buf *bp;
   block_t b;
+  unsigned bytes;
 
   rip = rdahed_inode;		/* pointer to inode to read ahead from */
   block_size = get_block_size(rip->i_dev);
   rdahed_inode = NIL_INODE;	/* turn off read ahead */
+  bytes = (unsigned) rip->i_ra_win * block_size;
+  rip->i_ra_end = rdahedpos + bytes;
   if ( (b = read_map(rip, rdahedpos)) == NO_BLOCK) return;	/* at EOF */
-  bp = rahead(rip, b, rdahedpos, block_size);
+  bp = rahead(rip, b, rdahedpos, bytes);
+
+  /* Nobody asked for this block yet either.  If it was just fetched, count
+   * it as read ahead, not as a miss.
+   */
+  if (bp->b_type == NO_TYPE && !bp->b_prefetched) {
+	bp->b_prefetched = TRUE;
+	fs_stats.fss_ra_blocks++;
+  }
   put_block(bp, PARTIAL_DATA_BLOCK);
 }
 
+/*===========================================================================*
+ *				ra_update				     *
+ *===========================================================================*/
+PRIVATE void ra_update(rip, start, position, block_size)
+register struct inode *rip;	/* inode of the file that was read */
+off_t start;			/* where the read started */
+off_t position;			/* where it stopped */
+int block_size;			/* block size of the file system */
+{
+/* Adapt the read ahead window of a file to a read that was just done.  The
+ * window doubles on each read that starts where the previous one stopped.  A
+ * read elsewhere halves it if the reads before were sequential, as when two
+ * processes read the same file, and otherwise turns read ahead off.  When less
+ * than half of the window is left beyond the position, read_ahead() is told to
+ * fetch the next window.
+ */
+  int sequential, max_win;
+
+  sequential = (start == rip->i_ra_pos || start == 0);
+  if (sequential) {
+	rip->i_ra_win = (rip->i_ra_win == 0 ? RA_MIN_BLOCKS : 2 * rip->i_ra_win);
+  } else if (rip->i_ra_hist & 1) {
+	rip->i_ra_win /= 2;
+  } else {
+	rip->i_ra_win = 0;
+  }
+  rip->i_ra_hist = (rip->i_ra_hist << 1) | sequential;
+  rip->i_ra_pos = position;
+
+  /* Don't let one file take more than a quarter of the cache. */
+  max_win = MIN(RA_MAX_BLOCKS, nr_bufs / 4);
+  if (rip->i_ra_win > max_win) rip->i_ra_win = max_win;
+  if (rip->i_ra_win == 0) {
+	rip->i_ra_end = position;
+	return;
+  }
+
+  /* Continue after what was read ahead before, if that is still ahead. */
+  if (rip->i_ra_end < position) rip->i_ra_end = position;
+  if (rip->i_ra_end >= rip->i_size) return;
+  if (rip->i_ra_end - position >= (off_t) rip->i_ra_win * block_size / 2)
+	return;
+  rdahed_inode = rip;
+  rdahedpos = rip->i_ra_end - rip->i_ra_end % block_size;
+}
+
 /*===========================================================================*
  *				rahead					     *
  *===========================================================================*/
@@ -457,21 +673,20 @@ unsigned bytes_ahead;		/* bytes beyond position for immediate use */
 {
 /* Fetch a block from the cache or the device.  If a physical read is
  * required, prefetch as many more blocks as convenient into the cache.
- * This usually covers bytes_ahead and is at least BLOCKS_MINIMUM.
+ * This usually covers bytes_ahead, which is the rest of the request for a
+ * read, and the read ahead window of the file for read_ahead().
  * The device driver may decide it knows better and stop reading at a
  * cylinder boundary (or after an error).  Rw_scattered() puts an optional
  * flag on all reads to allow this.
  */
   int block_size;
-/* Minimum number of blocks to prefetch. */
-# define BLOCKS_MINIMUM		(NR_BUFS < 50 ? 18 : 32)
-  int block_spec, scale, read_q_size;
+  int block_spec, scale, read_q_size, i, gap;
   unsigned int blocks_ahead, fragment;
   block_t block, blocks_left;
   off_t ind1_pos;
   dev_t dev;
   struct buf *bp;
-  static struct buf *read_q[NR_BUFS];
+  static struct buf *read_q[NR_IOREQS];
 
   block_spec = (rip->i_mode & I_TYPE) == I_BLOCK_SPECIAL;
   if (block_spec) {
@@ -530,33 +745,54 @@ unsigned bytes_ahead;		/* bytes beyond position for immediate use */
   /* No more than the maximum request. */
   if (blocks_ahead > NR_IOREQS) blocks_ahead = NR_IOREQS;
 
-  /* Read at least the minimum number of blocks, but not after a seek. */
-  if (blocks_ahead < BLOCKS_MINIMUM && rip->i_seek == NO_SEEK)
-	blocks_ahead = BLOCKS_MINIMUM;
-
   /* Can't go past end of file. */
   if (blocks_ahead > blocks_left) blocks_ahead = blocks_left;
 
   read_q_size = 0;
+  read_q[read_q_size++] = bp;
 
-  /* Acquire block buffers. */
-  for (;;) {
-	read_q[read_q_size++] = bp;
-
-	if (--blocks_ahead == 0) break;
-
-	/* Don't trash the cache, leave 4 free. */
-	if (bufs_in_use >= NR_BUFS - 4) break;
-
+  /* Acquire block buffers.  Don't trash the cache, leave 4 free. */
+  gap = 0;
+  while (--blocks_ahead > 0 && bufs_in_use < nr_bufs - 4) {
 	block++;
 
+	/* Block already in the cache?  Rw_scattered() reads across a few of
+	 * those, so only get out at a longer run.  Only look, don't touch it.
+	 */
+	if (in_cache(dev, block)) {
+		if (++gap > RW_GAP_BLOCKS) break;
+		continue;
+	}
+
 	bp = get_block(dev, block, PREFETCH);
-	if (bp->b_dev != NO_DEV) {
-		/* Oops, block already in the cache, get out. */
-		put_block(bp, FULL_DATA_BLOCK);
-		break;
+	if (bp->b_dev == NO_DEV) {
+		read_q[read_q_size++] = bp;
+		gap = 0;
+		continue;
 	}
+
+	/* Found in the second level cache, that is read ahead as well. */
+	bp->b_prefetched = TRUE;
+	fs_stats.fss_ra_blocks++;
+	put_block(bp, FULL_DATA_BLOCK);
+	if (++gap > RW_GAP_BLOCKS) break;
   }
+  /* All but the first block are read ahead.  Note which ones got read, to
+   * see later how many of them were of any use.
+   */
+  for (i = 1; i < read_q_size; i++) read_q[i]->b_prefetched = TRUE;
+
+  /* Keep the block that was asked for while rw_scattered() releases the
+   * buffers, so that its miss is counted once, by the caller's put_block().
+   */
+  bp = read_q[0];
+  bp->b_count++;
   rw_scattered(dev, read_q, read_q_size, READING);
+  for (i = 1; i < read_q_size; i++)
+	if (read_q[i]->b_dev == dev) fs_stats.fss_ra_blocks++;
+  if (bp->b_dev == dev) return(bp);
+
+  /* It could not be read with the others, try again on its own. */
+  put_block(bp, PARTIAL_DATA_BLOCK);
   return(get_block(dev, baseblock, NORMAL));
 }
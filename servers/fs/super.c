@@ -5,6 +5,7 @@
  *
  * The entry points into this file are
  *   alloc_bit:       somebody wants to allocate a zone or inode; find one
+ *   alloc_run:       allocate a run of consecutive zones
  *   free_bit:        indicate that a zone or inode is available for allocation
  *   get_super:       search the 'superblock' table for a device
  *   mounted:         tells if file inode is on mounted (or ROOT) file system
@@ -19,6 +20,8 @@
 #include "super.h"
 #include "const.h"
 
+FORWARD _PROTOTYPE( int first_zero, (unsigned k)				);
+
 /*===========================================================================*
  *				alloc_bit				     *
  *===========================================================================*/
@@ -71,7 +74,7 @@ bit_t origin;			/* number of bit to start searching at */
 
 		/* Find and allocate the free bit. */
 		k = conv2(sp->s_native, (int) *wptr);
-		for (i = 0; (k & (1 << i)) != 0; ++i) {}
+		i = first_zero(k);
 
 		/* Bit number from the start of the bit map. */
 		b = ((bit_t) block * FS_BITS_PER_BLOCK(sp->s_block_size))
@@ -95,6 +98,61 @@ bit_t origin;			/* number of bit to start searching at */
   return(NO_BIT);		/* no bit could be allocated */
 }
 
+/*===========================================================================*
+ *				alloc_run				     *
+ *===========================================================================*/
+PUBLIC bit_t alloc_run(sp, count)
+struct super_block *sp;		/* the filesystem to allocate from */
+int count;			/* # zones wanted, at most FS_BITCHUNK_BITS */
+{
+/* Allocate 'count' consecutive zones and return the bit number of the first.
+ * Only a word of the zone map in which all zones are free is used, so the
+ * search can skip a word at a time.  No word below s_zrun is entirely free,
+ * so the search starts there.  NO_BIT is returned if no free word is left.
+ */
+
+  block_t start_block;		/* first bit block */
+  bit_t map_bits;		/* how many bits are there in the bit map? */
+  unsigned block, word;
+  struct buf *bp;
+  bitchunk_t *wptr, *wlim;
+  bit_t b;
+
+  if (sp->s_rd_only)
+	panic(__FILE__,"can't allocate bit on read-only filesys.", NO_NUM);
+
+  start_block = START_BLOCK + sp->s_imap_blocks;
+  map_bits = sp->s_zones - (sp->s_firstdatazone - 1);
+
+  block = sp->s_zrun / FS_BITS_PER_BLOCK(sp->s_block_size);
+  word = (sp->s_zrun % FS_BITS_PER_BLOCK(sp->s_block_size)) / FS_BITCHUNK_BITS;
+
+  for (; block < sp->s_zmap_blocks; block++, word = 0) {
+	bp = get_block(sp->s_dev, start_block + block, NORMAL);
+	wlim = &bp->b_bitmap[FS_BITMAP_CHUNKS(sp->s_block_size)];
+
+	for (wptr = &bp->b_bitmap[word]; wptr < wlim; wptr++) {
+		if (*wptr != 0) continue;
+
+		/* Bit number from the start of the bit map. */
+		b = ((bit_t) block * FS_BITS_PER_BLOCK(sp->s_block_size))
+		    + (wptr - &bp->b_bitmap[0]) * FS_BITCHUNK_BITS;
+		if (b + FS_BITCHUNK_BITS > map_bits) break;
+
+		/* Allocate the first 'count' bits of the word. */
+		*wptr = conv2(sp->s_native, (int)
+			(count < FS_BITCHUNK_BITS ? (1 << count) - 1 : ~0));
+		bp->b_dirt = DIRTY;
+		put_block(bp, MAP_BLOCK);
+		sp->s_zrun = b;
+		return(b);
+	}
+	put_block(bp, MAP_BLOCK);
+  }
+  sp->s_zrun = map_bits;	/* nothing free until zones are freed */
+  return(NO_BIT);
+}
+
 /*===========================================================================*
  *				free_bit				     *
  *===========================================================================*/
@@ -138,6 +196,10 @@ bit_t bit_returned;		/* number of bit to insert into the map */
   bp->b_dirt = DIRTY;
 
   put_block(bp, MAP_BLOCK);
+
+  /* A zone map word that is now entirely free can be used for a run. */
+  if (map == ZMAP && k == 0 && bit_returned - bit < sp->s_zrun)
+	sp->s_zrun = bit_returned - bit;
 }
 
 /*===========================================================================*
@@ -302,6 +364,7 @@ register struct super_block *sp; /* pointer to a superblock */
 
   sp->s_isearch = 0;		/* inode searches initially start at 0 */
   sp->s_zsearch = 0;		/* zone searches initially start at 0 */
+  sp->s_zrun = 0;		/* and so do searches for free runs */
   sp->s_version = version;
   sp->s_native  = native;
 
@@ -317,3 +380,25 @@ register struct super_block *sp; /* pointer to a superblock */
   sp->s_dev = dev;		/* restore device number */
   return(OK);
 }
+
+/*===========================================================================*
+ *				first_zero				     *
+ *===========================================================================*/
+PRIVATE int first_zero(k)
+unsigned k;			/* bit map word that is not all ones */
+{
+/* Return the number of the lowest zero bit in a bit map word.  The word is
+ * halved until the bit is found, instead of testing one bit after another.
+ */
+  int i, n;
+
+  k = ~k;
+  i = 0;
+  for (n = FS_BITCHUNK_BITS / 2; n > 0; n /= 2) {
+	if ((k & ((1 << n) - 1)) == 0) {
+		k >>= n;
+		i += n;
+	}
+  }
+  return(i);
+}
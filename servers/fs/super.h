@@ -52,6 +52,7 @@ EXTERN struct super_block {
   int s_nindirs;		/* # indirect zones per indirect block */
   bit_t s_isearch;		/* inodes below this bit number are in use */
   bit_t s_zsearch;		/* all zones below this bit number are in use*/
+  bit_t s_zrun;			/* no free zone map word below this bit */
 } super_block[NR_SUPERS];
 
 #define NIL_SUPER (struct super_block *) 0
@@ -8,6 +8,7 @@
  *   panic:       something awful has occurred;  MINIX cannot continue
  *   conv2:	  do byte swapping on a 16-bit int
  *   conv4:	  do byte swapping on a 32-bit long
+ *   count_in:	  count a value in a statistics histogram
  */
 
 #include "fs.h"
@@ -138,3 +139,20 @@ long x;				/* 32-bit long to be byte swapped */
   return(l);
 }
 
+
+/*===========================================================================*
+ *				count_in				     *
+ *===========================================================================*/
+PUBLIC void count_in(histogram, buckets, value)
+u32_t *histogram;		/* counters with power of 2 buckets */
+int buckets;			/* number of counters */
+u32_t value;			/* value to count */
+{
+/* Count a value in the bucket from the highest power of 2 not above it. The
+ * last bucket takes all values that are larger.
+ */
+  int i;
+
+  for (i = 0; value > 1 && i < buckets - 1; value >>= 1) i++;
+  histogram[i]++;
+}
@@ -5,6 +5,7 @@
  *   do_write:     call read_write to perform the WRITE system call
  *   clear_zone:   erase a zone in the middle of a file
  *   new_block:    acquire a new block
+ *   free_prealloc: free the zones reserved for a file that it did not use
  */
 
 #include "fs.h"
@@ -20,6 +21,8 @@ FORWARD _PROTOTYPE( int write_map, (struct inode *rip, off_t position,
 
 FORWARD _PROTOTYPE( void wr_indir, (struct buf *bp, int index, zone_t zone) );
 
+FORWARD _PROTOTYPE( zone_t next_zone, (struct inode *rip, zone_t z)	);
+
 /*===========================================================================*
  *				do_write				     *
  *===========================================================================*/
@@ -46,6 +49,7 @@ zone_t new_zone;		/* zone # to be inserted */
   struct buf *bp;
 
   rip->i_dirt = DIRTY;		/* inode will be changed */
+  clear_runs(rip);		/* and so will its zones */
   bp = NIL_BUF;
   scale = rip->i_sp->s_log_zone_size;		/* for zone-block conversion */
   	/* relative zone # to insert */
@@ -214,7 +218,12 @@ off_t position;			/* file pointer */
 	} else {
 		z = rip->i_zone[0];	/* hunt near first zone */
 	}
-	if ( (z = alloc_zone(rip->i_dev, z)) == NO_ZONE) return(NIL_BUF);
+	if (position >= rip->i_size) {
+		z = next_zone(rip, z);		/* file grows at its end */
+	} else {
+		z = alloc_zone(rip->i_dev, z);	/* hole in the file */
+	}
+	if (z == NO_ZONE) return(NIL_BUF);
 	if ( (r = write_map(rip, position, z)) != OK) {
 		free_zone(rip->i_dev, z);
 		err_code = r;
@@ -234,6 +243,46 @@ off_t position;			/* file pointer */
   return(bp);
 }
 
+/*===========================================================================*
+ *				next_zone				     *
+ *===========================================================================*/
+PRIVATE zone_t next_zone(rip, z)
+register struct inode *rip;	/* file that grows at its end */
+zone_t z;			/* zone to allocate near if there is no run */
+{
+/* Allocate a zone for a file that grows at its end.  It is taken from a run
+ * of PREALLOC_ZONES consecutive zones that is reserved for the file, so that
+ * the file is contiguous on the disk even if other files grow at the same
+ * time.  If there is no free run left, a single zone is allocated.
+ */
+  struct super_block *sp;
+  bit_t b;
+
+  if (rip->i_prealloc == 0) {
+	sp = rip->i_sp;
+	if ( (b = alloc_run(sp, PREALLOC_ZONES)) == NO_BIT)
+		return(alloc_zone(rip->i_dev, z));
+	rip->i_pzone = sp->s_firstdatazone - 1 + (zone_t) b;
+	rip->i_prealloc = PREALLOC_ZONES;
+  }
+  rip->i_prealloc--;
+  return(rip->i_pzone++);
+}
+
+/*===========================================================================*
+ *				free_prealloc				     *
+ *===========================================================================*/
+PUBLIC void free_prealloc(rip)
+register struct inode *rip;	/* inode that is released or truncated */
+{
+/* Free the zones that were reserved for a file but not used. */
+
+  while (rip->i_prealloc > 0) {
+	free_zone(rip->i_dev, rip->i_pzone++);
+	rip->i_prealloc--;
+  }
+}
+
 /*===========================================================================*
  *				zero_block				     *
  *===========================================================================*/
@@ -241,6 +290,6 @@ PUBLIC void zero_block(bp)
 register struct buf *bp;	/* pointer to buffer to zero */
 {
 /* Zero a block. */
-  memset(bp->b_data, 0, MAX_BLOCK_SIZE);
+  memset(bp->b_data, 0, buf_size);
   bp->b_dirt = DIRTY;
 }
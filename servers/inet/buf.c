@@ -30,8 +30,11 @@ THIS_FILE
 #ifndef BUF32K_NR
 #define BUF32K_NR	0
 #endif
+#ifndef BUFRX_NR
+#define BUFRX_NR	64	/* receive buffers, see bf_rxreq */
+#endif
+#define BUFRX_S		1536	/* a tagged ethernet packet fits */
 
-#define ACC_NR		((BUF512_NR+BUF2K_NR+BUF32K_NR)*3)
 #define CLIENT_NR	7
 
 #define DECLARE_TYPE(Tag, Type, Size)					\
@@ -41,10 +44,13 @@ THIS_FILE
 		char buf_data[Size];					\
 	} Type
 
-#if BUF_USEMALLOC
-#define DECLARE_STORAGE(Type, Ident, Nitems)				\
+/* The number of buffers in a pool is only known after inet.conf is read,
+ * so the storage is allocated by bf_init.
+ */
+#define DECLARE_STORAGE(Type, Ident)					\
 	PRIVATE Type *Ident
 
+#if BUF_USEMALLOC
 #define ALLOC_STORAGE(Ident, Nitems, Label)				\
 	do								\
 	{								\
@@ -54,39 +60,65 @@ THIS_FILE
 			ip_panic(( "unable to alloc %s", Label ));	\
 	} while(0)
 #else
-#define DECLARE_STORAGE(Type, Ident, Nitems)				\
-	PRIVATE Type Ident[Nitems]
-
 #define ALLOC_STORAGE(Ident, Nitems, Label)				\
-	(void)0
+	do								\
+	{								\
+		Ident= alloc(sizeof(*Ident) * Nitems);			\
+		if (Ident == (void *)-1)				\
+			ip_panic(( "unable to alloc %d %s", Nitems, Label )); \
+	} while(0)
 #endif
 
+/* Keep track of the use of a pool */
+#define POOL_ALLOC(Pool)						\
+	do								\
+	{								\
+		bf_stat.bfs_pool[Pool].bps_allocs++;			\
+		if (++bf_stat.bfs_pool[Pool].bps_inuse >		\
+			bf_stat.bfs_pool[Pool].bps_hiwat)		\
+		{							\
+			bf_stat.bfs_pool[Pool].bps_hiwat=		\
+				bf_stat.bfs_pool[Pool].bps_inuse;	\
+		}							\
+	} while(0)
+#define POOL_FREE(Pool)		(bf_stat.bfs_pool[Pool].bps_inuse--)
+
 #if BUF512_NR
 DECLARE_TYPE(buf512, buf512_t, 512);
 PRIVATE acc_t *buf512_freelist;
-DECLARE_STORAGE(buf512_t, buffers512, BUF512_NR);
+DECLARE_STORAGE(buf512_t, buffers512);
+PRIVATE int buf512_nr;
 FORWARD void bf_512free ARGS(( acc_t *acc ));
 #endif
 #if BUF2K_NR
 DECLARE_TYPE(buf2K, buf2K_t, (2*1024));
 PRIVATE acc_t *buf2K_freelist;
-DECLARE_STORAGE(buf2K_t, buffers2K, BUF2K_NR);
+DECLARE_STORAGE(buf2K_t, buffers2K);
 FORWARD void bf_2Kfree ARGS(( acc_t *acc ));
 #endif
 #if BUF32K_NR
 DECLARE_TYPE(buf32K, buf32K_t, (32*1024));
 PRIVATE acc_t *buf32K_freelist;
-DECLARE_STORAGE(buf32K_t, buffers32K, BUF32K_NR);
+DECLARE_STORAGE(buf32K_t, buffers32K);
 FORWARD void bf_32Kfree ARGS(( acc_t *acc ));
 #endif
+#if BUFRX_NR
+DECLARE_TYPE(bufrx, bufrx_t, BUFRX_S);
+PRIVATE acc_t *bufrx_freelist;
+DECLARE_STORAGE(bufrx_t, buffersrx);
+PRIVATE int bufrx_nr;
+FORWARD void bf_rxfree ARGS(( acc_t *acc ));
+#endif
 
 PRIVATE acc_t *acc_freelist;
-DECLARE_STORAGE(acc_t, accessors, ACC_NR);
+DECLARE_STORAGE(acc_t, accessors);
+PRIVATE int acc_nr;
 
 PRIVATE bf_freereq_t freereq[CLIENT_NR];
 PRIVATE size_t bf_buf_gran;
 
 PUBLIC size_t bf_free_bufsize;
+PUBLIC bf_stat_t bf_stat;
 PUBLIC acc_t *bf_temporary_acc;
 PUBLIC acc_t *bf_linkcheck_acc;
 
@@ -112,12 +144,27 @@ FORWARD int report_buffer ARGS(( buf_t *buf, char *label, int i ));
 PUBLIC void bf_init()
 {
 	int i;
-	size_t buf_s;
+	size_t buf_s, rx_s;
 	acc_t *acc;
 
 	bf_buf_gran= BUF_S;
 	buf_s= 0;
 
+	assert(BF_PRI_NR == MAX_BUFREQ_PRI);
+	memset(&bf_stat, '\0', sizeof(bf_stat));
+
+	/* Size the pools, inet.conf may ask for more or fewer buffers */
+	acc_nr= BUF2K_NR + BUF32K_NR;
+#if BUF512_NR
+	buf512_nr= buf512_conf_nr != -1 ? buf512_conf_nr : BUF512_NR;
+	acc_nr += buf512_nr;
+#endif
+#if BUFRX_NR
+	bufrx_nr= bufrx_conf_nr != -1 ? bufrx_conf_nr : BUFRX_NR;
+	acc_nr += bufrx_nr;
+#endif
+	acc_nr *= 3;
+
 	for (i=0;i<CLIENT_NR;i++)
 		freereq[i]=0;
 #ifdef BUF_CONSISTENCY_CHECK
@@ -126,7 +173,7 @@ PUBLIC void bf_init()
 #endif
 
 #if BUF512_NR
-	ALLOC_STORAGE(buffers512, BUF512_NR, "512B-buffers");
+	ALLOC_STORAGE(buffers512, buf512_nr, "512B-buffers");
 #endif
 #if BUF2K_NR
 	ALLOC_STORAGE(buffers2K, BUF2K_NR, "2K-buffers");
@@ -134,10 +181,14 @@ PUBLIC void bf_init()
 #if BUF32K_NR
 	ALLOC_STORAGE(buffers32K, BUF32K_NR, "32K-buffers");
 #endif
-	ALLOC_STORAGE(accessors, ACC_NR, "accs");
+#if BUFRX_NR
+	if (bufrx_nr)
+		ALLOC_STORAGE(buffersrx, bufrx_nr, "receive buffers");
+#endif
+	ALLOC_STORAGE(accessors, acc_nr, "accs");
 
 	acc_freelist= NULL;
-	for (i=0;i<ACC_NR;i++)
+	for (i=0;i<acc_nr;i++)
 	{
 		memset(&accessors[i], '\0', sizeof(accessors[i]));
 
@@ -146,9 +197,11 @@ PUBLIC void bf_init()
 		acc_freelist= &accessors[i];
 	}
 
-#define INIT_BUFFERS(Ident, Nitems, Freelist, Freefunc)			\
+#define INIT_BUFFERS(Ident, Nitems, Freelist, Freefunc, Pool)		\
 	do								\
 	{								\
+		bf_stat.bfs_pool[Pool].bps_size= sizeof(Ident[0].buf_data); \
+		bf_stat.bfs_pool[Pool].bps_nr= Nitems;			\
 		Freelist= NULL;						\
 		for (i=0;i<Nitems;i++)					\
 		{							\
@@ -177,17 +230,34 @@ PUBLIC void bf_init()
 	} while(0)
 
 #if BUF512_NR
-	INIT_BUFFERS(buffers512, BUF512_NR, buf512_freelist, bf_512free);
+	INIT_BUFFERS(buffers512, buf512_nr, buf512_freelist, bf_512free,
+		BF_POOL_512);
 #endif
 #if BUF2K_NR
-	INIT_BUFFERS(buffers2K, BUF2K_NR, buf2K_freelist, bf_2Kfree);
+	INIT_BUFFERS(buffers2K, BUF2K_NR, buf2K_freelist, bf_2Kfree,
+		BF_POOL_2K);
 #endif
 #if BUF32K_NR
-	INIT_BUFFERS(buffers32K, BUF32K_NR, buf32K_freelist, bf_32Kfree);
+	INIT_BUFFERS(buffers32K, BUF32K_NR, buf32K_freelist, bf_32Kfree,
+		BF_POOL_32K);
+#endif
+#if BUFRX_NR
+	/* Receive buffers are only handed out by bf_rxreq, they don't
+	 * count for BUF_S.
+	 */
+	rx_s= buf_s;
+	INIT_BUFFERS(buffersrx, bufrx_nr, bufrx_freelist, bf_rxfree,
+		BF_POOL_RX);
+	buf_s= rx_s;
 #endif
 
 #undef INIT_BUFFERS
 
+	/* What is left are the accessors for bf_dupacc */
+	bf_stat.bfs_pool[BF_POOL_ACC].bps_size= sizeof(acc_t);
+	for (acc= acc_freelist; acc; acc= acc->acc_next)
+		bf_stat.bfs_pool[BF_POOL_ACC].bps_nr++;
+
 	assert (buf_s == BUF_S);
 }
 
@@ -242,11 +312,12 @@ size_t size;
 		new_acc= NULL;
 
 		/* Note the tricky dangling else... */
-#define ALLOC_BUF(Freelist, Bufsize)					\
+#define ALLOC_BUF(Freelist, Bufsize, Pool)				\
 	if (Freelist && (Bufsize == BUF_S || size <= Bufsize))		\
 	{								\
 		new_acc= Freelist;					\
 		Freelist= new_acc->acc_next;				\
+		POOL_ALLOC(Pool);					\
 									\
 		assert(new_acc->acc_linkC == 0);			\
 		new_acc->acc_linkC= 1;					\
@@ -258,22 +329,24 @@ size_t size;
 
 		/* Sort attempts by buffer size */
 #if BUF512_NR
-		ALLOC_BUF(buf512_freelist, 512)
+		ALLOC_BUF(buf512_freelist, 512, BF_POOL_512)
 #endif
 #if BUF2K_NR
-		ALLOC_BUF(buf2K_freelist, 2*1024)
+		ALLOC_BUF(buf2K_freelist, 2*1024, BF_POOL_2K)
 #endif
 #if BUF32K_NR
-		ALLOC_BUF(buf32K_freelist, 32*1024)
+		ALLOC_BUF(buf32K_freelist, 32*1024, BF_POOL_32K)
 #endif
 #undef ALLOC_BUF
 		{
 			DBLOCK(2, printf("freeing buffers\n"));
 
+			bf_stat.bfs_memfail++;
 			bf_free_bufsize= 0;
 			for (i=0; bf_free_bufsize<size && i<MAX_BUFREQ_PRI;
 				i++)
 			{
+				bf_stat.bfs_freereq[i]++;
 				for (j=0; j<CLIENT_NR; j++)
 				{
 					if (freereq[j])
@@ -288,6 +361,7 @@ size_t size;
 #if DEBUG && 0
  { printf("last level was level %d\n", i-1); }
 #endif
+			bf_stat.bfs_freed += bf_free_bufsize;
 			if (bf_free_bufsize<size)
 				ip_panic(( "not enough buffers freed" ));
 
@@ -320,6 +394,59 @@ size_t size;
 	return head;
 }
 
+/*
+bf_rxreq
+
+Get a buffer for a packet from an ethernet driver. If possible the packet
+gets a single contiguous receive buffer, which the driver can fill with one
+copy and which is passed on as it is. Otherwise this is bf_memreq.
+*/
+
+#ifndef BUF_TRACK_ALLOC_FREE
+PUBLIC acc_t *bf_rxreq(size)
+#else
+PUBLIC acc_t *_bf_rxreq(clnt_file, clnt_line, size)
+char *clnt_file;
+int clnt_line;
+#endif
+size_t size;
+{
+#if BUFRX_NR
+	acc_t *new_acc;
+	buf_t *buf;
+
+	assert (size>0);
+
+	if (bufrx_freelist && size <= BUFRX_S)
+	{
+		new_acc= bufrx_freelist;
+		bufrx_freelist= new_acc->acc_next;
+		POOL_ALLOC(BF_POOL_RX);
+
+		assert(new_acc->acc_linkC == 0);
+		new_acc->acc_linkC= 1;
+		buf= new_acc->acc_buffer;
+		assert(buf->buf_linkC == 0);
+		buf->buf_linkC= 1;
+
+#ifdef BUF_TRACK_ALLOC_FREE
+		new_acc->acc_alloc_file= clnt_file;
+		new_acc->acc_alloc_line= clnt_line;
+		buf->buf_alloc_file= clnt_file;
+		buf->buf_alloc_line= clnt_line;
+#endif
+
+		new_acc->acc_offset= 0;
+		new_acc->acc_length= size;
+		new_acc->acc_next= NULL;
+		return new_acc;
+	}
+	if (bufrx_nr > 0 && size <= BUFRX_S)
+		bf_stat.bfs_rxfail++;
+#endif
+	return bf_memreq(size);
+}
+
 /*
 bf_small_memreq
 */
@@ -378,6 +505,7 @@ acc_t *acc;
 			next_acc= acc->acc_next;
 			acc->acc_next= acc_freelist;
 			acc_freelist= acc;
+			POOL_FREE(BF_POOL_ACC);
 #ifdef BUF_CONSISTENCY_CHECK
 			if (inet_buf_debug)
 			{
@@ -422,6 +550,7 @@ register acc_t *acc_ptr;
 	}
 	new_acc= acc_freelist;
 	acc_freelist= new_acc->acc_next;
+	POOL_ALLOC(BF_POOL_ACC);
 
 	*new_acc= *acc_ptr;
 	if (acc_ptr->acc_next)
@@ -447,7 +576,7 @@ assert(acc_ptr);
 
 	while (acc_ptr)
 	{
-assert(acc_ptr >= accessors && acc_ptr <= &accessors[ACC_NR-1]);
+assert(acc_ptr >= accessors && acc_ptr <= &accessors[acc_nr-1]);
 		size += acc_ptr->acc_length;
 		acc_ptr= acc_ptr->acc_next;
 	}
@@ -830,6 +959,7 @@ acc_t *acc;
 #endif
 	acc->acc_next= buf512_freelist;
 	buf512_freelist= acc;
+	POOL_FREE(BF_POOL_512);
 }
 #endif
 #if BUF2K_NR
@@ -842,6 +972,7 @@ acc_t *acc;
 #endif
 	acc->acc_next= buf2K_freelist;
 	buf2K_freelist= acc;
+	POOL_FREE(BF_POOL_2K);
 }
 #endif
 #if BUF32K_NR
@@ -854,6 +985,24 @@ acc_t *acc;
 #endif
 	acc->acc_next= buf32K_freelist;
 	buf32K_freelist= acc;
+	POOL_FREE(BF_POOL_32K);
+}
+#endif
+
+#if BUFRX_NR
+PRIVATE void bf_rxfree(acc)
+acc_t *acc;
+{
+#ifdef BUF_CONSISTENCY_CHECK 
+	if (inet_buf_debug)
+		memset(acc->acc_buffer->buf_data_p, 0xa5, BUFRX_S);
+#endif
+	/* A receive buffer is no use to bf_memreq */
+	bf_free_bufsize -= BUFRX_S;
+
+	acc->acc_next= bufrx_freelist;
+	bufrx_freelist= acc;
+	POOL_FREE(BF_POOL_RX);
 }
 #endif
 
@@ -898,12 +1047,15 @@ PUBLIC int bf_consistency_check()
 #if BUF32K_NR
 	count_free_bufs(buf32K_freelist);
 #endif
+#if BUFRX_NR
+	count_free_bufs(bufrx_freelist);
+#endif
 
 	error= 0;
 
 	/* Report about accessors */
 	silent= 0;
-	for (i=0, acc= accessors; i<ACC_NR; i++, acc++)
+	for (i=0, acc= accessors; i<acc_nr; i++, acc++)
 	{
 		if (acc->acc_generation != buf_generation)
 		{
@@ -954,7 +1106,7 @@ PUBLIC int bf_consistency_check()
 	/* Report about buffers */
 #if BUF512_NR
 	{
-		for (i= 0; i<BUF512_NR; i++)
+		for (i= 0; i<buf512_nr; i++)
 		{
 			error |= report_buffer(&buffers512[i].buf_header,
 				"512-buffer", i);
@@ -979,6 +1131,15 @@ PUBLIC int bf_consistency_check()
 		}
 	}
 #endif
+#if BUFRX_NR
+	{
+		for (i= 0; i<bufrx_nr; i++)
+		{
+			error |= report_buffer(&buffersrx[i].buf_header,
+				"receive buffer", i);
+		}
+	}
+#endif
 
 	return !error;
 }
@@ -1117,7 +1278,7 @@ acc_t *acc;
 	int i;
 
 	buf_t *buffer;
-	for (i= 0; i<ACC_NR && acc; i++, acc= acc->acc_next)
+	for (i= 0; i<acc_nr && acc; i++, acc= acc->acc_next)
 	{
 		if (acc->acc_linkC <= 0)
 		{
@@ -1173,8 +1334,10 @@ PRIVATE void free_accs()
 	DBLOCK(1, printf("free_accs\n"));
 
 assert(bf_linkcheck(bf_linkcheck_acc));
+	bf_stat.bfs_accfail++;
 	for (i=0; !acc_freelist && i<MAX_BUFREQ_PRI; i++)
 	{
+		bf_stat.bfs_freereq[i]++;
 		for (j=0; j<CLIENT_NR; j++)
 		{
 			bf_free_bufsize= 0;
@@ -1244,7 +1407,7 @@ acc_t *acc;
 
 	if (!acc)
 		return 1;
-	if (acc < accessors || acc >= &accessors[ACC_NR])
+	if (acc < accessors || acc >= &accessors[acc_nr])
 		return 0;
 	acc_nr= acc-accessors;
 	return acc == &accessors[acc_nr];
@@ -83,6 +83,7 @@ typedef struct acc
 
 extern acc_t *bf_temporary_acc;
 extern acc_t *bf_linkcheck_acc;
+extern bf_stat_t bf_stat;
 
 /* For debugging... */
 
@@ -91,6 +92,7 @@ extern acc_t *bf_linkcheck_acc;
 #ifndef BUF_IMPLEMENTATION
 
 #define bf_memreq(a) _bf_memreq(this_file, __LINE__, a)
+#define bf_rxreq(a) _bf_rxreq(this_file, __LINE__, a)
 #define bf_cut(a,b,c) _bf_cut(this_file, __LINE__, a, b, c)
 #define bf_delhead(a,b) _bf_delhead(this_file, __LINE__, a, b)
 #define bf_packIffLess(a,b) _bf_packIffLess(this_file, __LINE__, \
@@ -141,6 +143,14 @@ acc_t *_bf_memreq ARGS(( char *clnt_file, int clnt_line,
 #endif
 /* the result is an acc with linkC == 1 */
 
+#ifndef BUF_TRACK_ALLOC_FREE
+acc_t *bf_rxreq ARGS(( unsigned size));
+#else
+acc_t *_bf_rxreq ARGS(( char *clnt_file, int clnt_line,
+			unsigned size));
+#endif
+/* like bf_memreq, but the result is a single acc if possible */
+
 #ifndef BUF_TRACK_ALLOC_FREE
 acc_t *bf_dupacc ARGS(( acc_t *acc ));
 #else
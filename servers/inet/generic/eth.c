@@ -1038,6 +1038,7 @@ PRIVATE void eth_bufcheck()
 	{
 		bf_check_acc(eth_port_table[i].etp_rd_pack);
 		bf_check_acc(eth_port_table[i].etp_wr_pack);
+		osdep_eth_bufcheck(&eth_port_table[i]);
 	}
 	for (i= 0, eth_fd= eth_fd_table; i<ETH_FD_NR; i++, eth_fd++)
 	{
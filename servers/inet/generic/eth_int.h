@@ -53,6 +53,9 @@ void eth_set_rec_conf ARGS(( eth_port_t *eth_port, u32_t flags ));
 void eth_restart_write ARGS(( eth_port_t *eth_port ));
 void eth_loop_ev ARGS(( event_t *ev, ev_arg_t ev_arg ));
 void eth_reg_vlan ARGS(( eth_port_t *eth_port, eth_port_t *vlan_port ));
+#ifdef BUF_CONSISTENCY_CHECK
+void osdep_eth_bufcheck ARGS(( eth_port_t *eth_port ));
+#endif
 
 #endif /* ETH_INT_H */
 
@@ -27,6 +27,17 @@ PUBLIC tcp_fd_t tcp_fd_table[TCP_FD_NR];
 PUBLIC tcp_conn_t tcp_conn_table[TCP_CONN_NR];
 PUBLIC sr_cancel_t tcp_cancel_f;
 
+PRIVATE tcp_conn_t *tcp_est_hash[TCP_EST_HASH_NR];
+PRIVATE tcp_conn_t *tcp_lsn_hash[TCP_LSN_HASH_NR];
+
+/* A bit for every local port, indexed in network byte order.  A clear bit
+ * means that no fd or connection uses the port.  Bits are set when a port
+ * is taken and only cleared by is_unused_port after a full check.
+ */
+PRIVATE u8_t tcp_port_used[0x10000/8];
+#define port_used_byte(port)	tcp_port_used[(u16_t)(port) >> 3]
+#define port_used_bit(port)	(1 << ((port) & 7))
+
 FORWARD void tcp_main ARGS(( tcp_port_t *port ));
 FORWARD int tcp_select ARGS(( int fd, unsigned operations ));
 FORWARD acc_t *tcp_get_data ARGS(( int fd, size_t offset,
@@ -49,6 +60,9 @@ FORWARD void reply_thr_get ARGS(( tcp_fd_t *tcp_fd, int reply,
 FORWARD tcp_conn_t *find_conn_entry ARGS(( Tcpport_t locport,
 	ipaddr_t locaddr, Tcpport_t remport, ipaddr_t readaddr ));
 FORWARD tcp_conn_t *find_empty_conn ARGS(( void ));
+FORWARD tcp_conn_t **est_chain ARGS(( Tcpport_t locport,
+	ipaddr_t remaddr, Tcpport_t remport ));
+FORWARD tcp_conn_t **lsn_chain ARGS(( Tcpport_t locport ));
 FORWARD tcp_conn_t *find_best_conn ARGS(( ip_hdr_t *ip_hdr, 
 	tcp_hdr_t *tcp_hdr ));
 FORWARD tcp_conn_t *new_conn_for_queue ARGS(( tcp_fd_t *tcp_fd ));
@@ -70,7 +84,7 @@ PUBLIC void tcp_prep()
 
 PUBLIC void tcp_init()
 {
-	int i, j, k, ifno;
+	int i, ifno;
 	tcp_fd_t *tcp_fd;
 	tcp_port_t *tcp_port;
 	tcp_conn_t *tcp_conn;
@@ -86,11 +100,17 @@ PUBLIC void tcp_init()
 	}
 
 	for (i=0, tcp_conn= tcp_conn_table; i<TCP_CONN_NR; i++,
-		tcp_fd++)
+		tcp_conn++)
 	{
 		tcp_conn->tc_flags= TCF_EMPTY;
 		tcp_conn->tc_busy= 0;
+		tcp_conn->tc_hash_next= NULL;
+		tcp_conn->tc_hash_head= NULL;
 	}
+	for (i= 0; i<TCP_EST_HASH_NR; i++)
+		tcp_est_hash[i]= NULL;
+	for (i= 0; i<TCP_LSN_HASH_NR; i++)
+		tcp_lsn_hash[i]= NULL;
 
 #ifndef BUF_CONSISTENCY_CHECK
 	bf_logon(tcp_buffree);
@@ -107,14 +127,6 @@ PUBLIC void tcp_init()
 		tcp_port->tp_snd_head= NULL;
 		tcp_port->tp_snd_tail= NULL;
 		ev_init(&tcp_port->tp_snd_event);
-		for (j= 0; j<TCP_CONN_HASH_NR; j++)
-		{
-			for (k= 0; k<4; k++)
-			{
-				tcp_port->tp_conn_hash[j][k]=
-					&tcp_conn_table[0];
-			}
-		}
 
 		ifno= ip_conf[tcp_port->tp_ipdev].ic_ifno;
 		sr_add_minor(if2minor(ifno, TCP_DEV_OFF),
@@ -500,16 +512,14 @@ acc_t *data;
 size_t datalen;
 {
 	tcp_port_t *tcp_port;
-	tcp_conn_t *tcp_conn, **conn_p;
+	tcp_conn_t *tcp_conn;
 	ip_hdr_t *ip_hdr;
 	tcp_hdr_t *tcp_hdr;
 	acc_t *ip_pack, *tcp_pack;
 	size_t ip_datalen, tcp_datalen, ip_hdr_len, tcp_hdr_len;
 	u16_t sum, mtu;
-	u32_t bits;
-	int i, hash;
-	ipaddr_t srcaddr, dstaddr, ipaddr, mask;
-	tcpport_t srcport, dstport;
+	int i;
+	ipaddr_t ipaddr, mask;
 
 	tcp_port= &tcp_port_table[fd];
 
@@ -610,78 +620,14 @@ size_t datalen;
 		return;
 	}
 
-	srcaddr= ip_hdr->ih_src;
-	dstaddr= ip_hdr->ih_dst;
-	srcport= tcp_hdr->th_srcport;
-	dstport= tcp_hdr->th_dstport;
-	bits= srcaddr ^ dstaddr ^ srcport ^ dstport;
-	bits= (bits >> 16) ^ bits;
-	bits= (bits >> 8) ^ bits;
-	hash= ((bits >> TCP_CONN_HASH_SHIFT) ^ bits) & (TCP_CONN_HASH_NR-1);
-	conn_p= tcp_port->tp_conn_hash[hash];
-	if (conn_p[0]->tc_locport == dstport &&
-		conn_p[0]->tc_remport == srcport &&
-		conn_p[0]->tc_remaddr == srcaddr &&
-		conn_p[0]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[0];
-	}
-	else if (conn_p[1]->tc_locport == dstport &&
-		conn_p[1]->tc_remport == srcport &&
-		conn_p[1]->tc_remaddr == srcaddr &&
-		conn_p[1]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
-	}
-	else if (conn_p[2]->tc_locport == dstport &&
-		conn_p[2]->tc_remport == srcport &&
-		conn_p[2]->tc_remaddr == srcaddr &&
-		conn_p[2]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[2];
-		conn_p[2]= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
-	}
-	else if (conn_p[3]->tc_locport == dstport &&
-		conn_p[3]->tc_remport == srcport &&
-		conn_p[3]->tc_remaddr == srcaddr &&
-		conn_p[3]->tc_locaddr == dstaddr)
-	{
-		tcp_conn= conn_p[3];
-		conn_p[3]= conn_p[2];
-		conn_p[2]= conn_p[1];
-		conn_p[1]= conn_p[0];
-		conn_p[0]= tcp_conn;
-	}
-	else
-		tcp_conn= NULL;
-	if ((tcp_conn != NULL && tcp_conn->tc_state == TCS_CLOSED) ||
-		(tcp_hdr->th_flags & THF_SYN))
-	{
-		tcp_conn= NULL;
-	}
-
-	if (tcp_conn == NULL)
+	tcp_conn= find_best_conn(ip_hdr, tcp_hdr);
+	if (!tcp_conn)
 	{
-		tcp_conn= find_best_conn(ip_hdr, tcp_hdr);
-		if (!tcp_conn)
-		{
-			/* listen backlog hack */
-			bf_afree(ip_pack);
-			bf_afree(tcp_pack);
-			bf_afree(data);
-			return;
-		}
-		if (tcp_conn->tc_state != TCS_CLOSED)
-		{
-			conn_p[3]= conn_p[2];
-			conn_p[2]= conn_p[1];
-			conn_p[1]= conn_p[0];
-			conn_p[0]= tcp_conn;
-		}
+		/* listen backlog hack */
+		bf_afree(ip_pack);
+		bf_afree(tcp_pack);
+		bf_afree(data);
+		return;
 	}
 	assert(tcp_conn->tc_busy == 0);
 	tcp_conn->tc_busy++;
@@ -1105,6 +1051,8 @@ assert (new_di_flags & NWTC_REMPORT_MASK);
 	}
 				
 	tcp_fd->tf_tcpconf= newconf;
+	port_used_byte(newconf.nwtc_locport) |=
+		port_used_bit(newconf.nwtc_locport);
 
 	if ((all_flags & NWTC_ACC_MASK) &&
 		((all_flags & NWTC_LOCPORT_MASK) == NWTC_LP_SET ||
@@ -1271,6 +1219,9 @@ tcpport_t port;
 	tcp_fd_t *tcp_fd;
 	tcp_conn_t *tcp_conn;
 
+	if (!(port_used_byte(port) & port_used_bit(port)))
+		return TRUE;
+
 	for (i= 0, tcp_fd= tcp_fd_table; i<TCP_FD_NR; i++,
 		tcp_fd++)
 	{
@@ -1288,6 +1239,7 @@ tcpport_t port;
 		if (tcp_conn->tc_locport == port)
 			return FALSE;
 	}
+	port_used_byte(port) &= ~port_used_bit(port);
 	return TRUE;
 }
 
@@ -1399,14 +1351,12 @@ tcpport_t remport;
 ipaddr_t remaddr;
 {
 	tcp_conn_t *tcp_conn;
-	int i, state;
+	int state;
 
 	assert(remport);
 	assert(remaddr);
-	for (i=tcp_conf_nr, tcp_conn= tcp_conn_table+i; i<TCP_CONN_NR;
-		i++, tcp_conn++)
-		/* the first tcp_conf_nr connections are reserved for
-			RSTs */
+	for (tcp_conn= *est_chain(locport, remaddr, remport); tcp_conn;
+		tcp_conn= tcp_conn->tc_hash_next)
 	{
 		if (tcp_conn->tc_flags == TCF_EMPTY)
 			continue;
@@ -1427,6 +1377,87 @@ ipaddr_t remaddr;
 	return NULL;
 }
 
+/*
+tcp_conn_hash
+
+Put a connection on the hash chain that matches its current addresses and
+ports. This function has to be called whenever they change, except for
+tc_locaddr which is not part of the hash.
+*/
+
+PUBLIC void tcp_conn_hash(tcp_conn)
+tcp_conn_t *tcp_conn;
+{
+	tcp_conn_t **head, **link;
+	tcpport_t locport;
+
+	if (tcp_conn < tcp_conn_table+tcp_conf_nr)
+		return;	/* connections reserved for RSTs are not hashed */
+
+	if (tcp_conn->tc_hash_head)
+	{
+		for (link= tcp_conn->tc_hash_head; *link != tcp_conn;
+			link= &(*link)->tc_hash_next)
+		{
+			assert(*link);
+		}
+		*link= tcp_conn->tc_hash_next;
+	}
+
+	locport= tcp_conn->tc_locport;
+	port_used_byte(locport) |= port_used_bit(locport);
+	if (locport && tcp_conn->tc_remport && tcp_conn->tc_remaddr)
+	{
+		head= est_chain(locport, tcp_conn->tc_remaddr,
+			tcp_conn->tc_remport);
+	}
+	else
+		head= lsn_chain(locport);
+
+	/* Keep the chain in table order, lookups rely on that to pick the
+	 * same connection as a scan of the table did.
+	 */
+	for (link= head; *link && *link < tcp_conn;
+		link= &(*link)->tc_hash_next)
+	{
+		;
+	}
+	tcp_conn->tc_hash_next= *link;
+	*link= tcp_conn;
+	tcp_conn->tc_hash_head= head;
+}
+
+/*
+est_chain
+*/
+
+PRIVATE tcp_conn_t **est_chain(locport, remaddr, remport)
+tcpport_t locport;
+ipaddr_t remaddr;
+tcpport_t remport;
+{
+	u32_t bits;
+
+	bits= remaddr ^ remport ^ ((u32_t)locport << 16);
+	bits= (bits >> 16) ^ bits;
+	bits= (bits >> TCP_EST_HASH_SHIFT) ^ bits;
+	return &tcp_est_hash[bits & (TCP_EST_HASH_NR-1)];
+}
+
+/*
+lsn_chain
+*/
+
+PRIVATE tcp_conn_t **lsn_chain(locport)
+tcpport_t locport;
+{
+	unsigned bits;
+
+	bits= locport;
+	bits= (bits >> TCP_LSN_HASH_SHIFT) ^ bits;
+	return &tcp_lsn_hash[bits & (TCP_LSN_HASH_NR-1)];
+}
+
 PRIVATE void read_ip_packets(tcp_port)
 tcp_port_t *tcp_port;
 {
@@ -1456,7 +1487,7 @@ tcp_hdr_t *tcp_hdr;
 {
 	
 	int best_level, new_level;
-	tcp_conn_t *best_conn, *listen_conn, *tcp_conn;
+	tcp_conn_t *best_conn, *listen_conn, *tcp_conn, **chain;
 	tcp_fd_t *tcp_fd;
 	int i;
 	ipaddr_t locaddr;
@@ -1473,77 +1504,87 @@ tcp_hdr_t *tcp_hdr;
 			 */
 		locport= 0;
 		
-	best_level= 0;
+	/* First check for open and abandoned connections. */
 	best_conn= NULL;
-	listen_conn= NULL;
-	for (i= tcp_conf_nr, tcp_conn= tcp_conn_table+i;
-		i<TCP_CONN_NR; i++, tcp_conn++)
-		/* the first tcp_conf_nr connections are reserved for
-			RSTs */
+	for (tcp_conn= *est_chain(locport, remaddr, remport); tcp_conn;
+		tcp_conn= tcp_conn->tc_hash_next)
 	{
 		if (!(tcp_conn->tc_flags & TCF_INUSE))
 			continue;
-		/* First fast check for open connections. */
-		if (tcp_conn->tc_locaddr == locaddr && 
-			tcp_conn->tc_locport == locport &&
-			tcp_conn->tc_remport == remport &&
-			tcp_conn->tc_remaddr == remaddr &&
-			tcp_conn->tc_fd)
+		if (tcp_conn->tc_locaddr != locaddr ||
+			tcp_conn->tc_locport != locport ||
+			tcp_conn->tc_remport != remport ||
+			tcp_conn->tc_remaddr != remaddr)
 		{
-			return tcp_conn;
+			continue;
 		}
+		if (tcp_conn->tc_fd)
+			return tcp_conn;
 
-		/* Now check for listens and abandoned connections. */
-		if (tcp_conn->tc_locaddr != locaddr)
+		/* We found an abandoned connection, take the one with
+		 * the highest ISS.
+		 */
+		if (best_conn && tcp_Lmod4G(tcp_conn->tc_ISS,
+			best_conn->tc_ISS))
 		{
 			continue;
 		}
-		new_level= 0;
-		if (tcp_conn->tc_locport)
+		best_conn= tcp_conn;
+	}
+
+	/* Now check for listens, first on this port and then on any port.
+	 * A listen on this port always has a higher level.
+	 */
+	best_level= 0;
+	listen_conn= NULL;
+	chain= lsn_chain(locport);
+	while (tcp_hdr->th_flags & THF_SYN)
+	{
+		for (tcp_conn= *chain; tcp_conn;
+			tcp_conn= tcp_conn->tc_hash_next)
 		{
-			if (tcp_conn->tc_locport != locport)
+			if (!(tcp_conn->tc_flags & TCF_INUSE))
+				continue;
+			if (tcp_conn->tc_locaddr != locaddr)
 			{
 				continue;
 			}
-			new_level += 4;
-		}
-		if (tcp_conn->tc_remport)
-		{
-			if (tcp_conn->tc_remport != remport)
+			new_level= 0;
+			if (tcp_conn->tc_locport)
 			{
-				continue;
+				if (tcp_conn->tc_locport != locport)
+				{
+					continue;
+				}
+				new_level += 4;
 			}
-			new_level += 1;
-		}
-		if (tcp_conn->tc_remaddr)
-		{
-			if (tcp_conn->tc_remaddr != remaddr)
+			if (tcp_conn->tc_remport)
 			{
-				continue;
+				if (tcp_conn->tc_remport != remport)
+				{
+					continue;
+				}
+				new_level += 1;
 			}
-			new_level += 2;
-		}
-		if (new_level<best_level)
-			continue;
-		if (new_level != 7 && tcp_conn->tc_state != TCS_LISTEN)
-			continue;
-		if (new_level == 7)
-			/* We found an abandoned connection */
-		{
-		 	assert(!tcp_conn->tc_fd);
-			if (best_conn && tcp_Lmod4G(tcp_conn->tc_ISS,
-				best_conn->tc_ISS))
+			if (tcp_conn->tc_remaddr)
 			{
-				continue;
+				if (tcp_conn->tc_remaddr != remaddr)
+				{
+					continue;
+				}
+				new_level += 2;
 			}
-			best_conn= tcp_conn;
-			continue;
+			if (new_level<best_level)
+				continue;
+			if (tcp_conn->tc_state != TCS_LISTEN)
+				continue;
+			best_level= new_level;
+			listen_conn= tcp_conn;
+			assert(listen_conn->tc_fd != NULL);
 		}
-		if (!(tcp_hdr->th_flags & THF_SYN))
-			continue;
-		best_level= new_level;
-		listen_conn= tcp_conn;
-		assert(listen_conn->tc_fd != NULL);
+		if (chain == lsn_chain(0))
+			break;
+		chain= lsn_chain(0);
 	}
 
 	if (listen_conn && listen_conn->tc_fd->tf_flags & TFF_LISTENQ &&
@@ -2661,6 +2702,8 @@ tcp_conn_t *tcp_conn;
 
 	clck_untimer(&tcp_conn->tc_transmit_timer);
 	tcp_conn->tc_transmit_seq= 0;
+
+	tcp_conn_hash(tcp_conn);
 }
 
 PRIVATE u32_t tcp_rand32()
@@ -9,8 +9,15 @@ Copyright 1995 Philip Homburg
 
 #define IP_TCP_MIN_HDR_SIZE	(IP_MIN_HDR_SIZE+TCP_MIN_HDR_SIZE)
 
-#define TCP_CONN_HASH_SHIFT	4
-#define TCP_CONN_HASH_NR	(1 << TCP_CONN_HASH_SHIFT)
+/* Incoming segments are matched to connections through two hash tables.
+ * Connections with a complete 4-tuple are hashed on the local port and the
+ * remote address and port, everything else (listens) on the local port
+ * alone.  Both sizes MUST BE POWERS OF 2.
+ */
+#define TCP_EST_HASH_SHIFT	9
+#define TCP_EST_HASH_NR		(1 << TCP_EST_HASH_SHIFT)
+#define TCP_LSN_HASH_SHIFT	6
+#define TCP_LSN_HASH_NR		(1 << TCP_LSN_HASH_SHIFT)
 
 typedef struct tcp_port
 {
@@ -25,7 +32,6 @@ typedef struct tcp_port
 	struct tcp_conn *tp_snd_head;
 	struct tcp_conn *tp_snd_tail;
 	event_t tp_snd_event;
-	struct tcp_conn *tp_conn_hash[TCP_CONN_HASH_NR][4];
 } tcp_port_t;
 
 #define TPF_EMPTY	0x0
@@ -97,6 +103,8 @@ typedef struct tcp_conn
 	ipaddr_t tc_locaddr;
 	tcpport_t tc_remport;
 	ipaddr_t tc_remaddr;
+	struct tcp_conn *tc_hash_next;	/* next on the same hash chain */
+	struct tcp_conn **tc_hash_head;	/* chain we are on, or NULL */
 
 	int tc_connInprogress;
 	int tc_orglisten;
@@ -245,9 +253,18 @@ void tcp_reply_read ARGS(( tcp_fd_t *tcp_fd, size_t reply ));
 void tcp_notreach ARGS(( tcp_conn_t *tcp_conn ));
 void tcp_mtu_exceeded ARGS(( tcp_conn_t *tcp_conn ));
 void tcp_mtu_incr ARGS(( tcp_conn_t *tcp_conn ));
+void tcp_conn_hash ARGS(( tcp_conn_t *tcp_conn ));
 
+/* Both can be raised from the command line, e.g. -DTCP_CONN_NR=2048 for a
+ * server with many connections in TIME_WAIT.  Lookups do not scan the
+ * tables, so they do not get slower.
+ */
+#ifndef TCP_FD_NR
 #define TCP_FD_NR	(10*IP_PORT_MAX)
+#endif
+#ifndef TCP_CONN_NR
 #define TCP_CONN_NR	(2*TCP_FD_NR)
+#endif
 
 EXTERN tcp_port_t *tcp_port_table;
 EXTERN tcp_conn_t tcp_conn_table[TCP_CONN_NR];
@@ -148,6 +148,7 @@ LISTEN:
 			tcp_conn->tc_locport= tcp_hdr->th_dstport;
 			tcp_conn->tc_remaddr= ip_hdr->ih_src;
 			tcp_conn->tc_remport= tcp_hdr->th_srcport;
+			tcp_conn_hash(tcp_conn);
 			tcp_conn_write(tcp_conn, 1);
 
 			DIFBLOCK(0x10, seg_seq == 0,
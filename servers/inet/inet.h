@@ -63,6 +63,7 @@ typedef int ioreq_t;
 #include <net/gen/udp_io.h>
 
 #include <net/gen/arp_io.h>
+#include <net/gen/buf_stat.h>
 #include <net/ioctl.h>
 
 #include "const.h"
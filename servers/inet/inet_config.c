@@ -37,6 +37,9 @@ int ip_conf_nr;
 int tcp_conf_nr;
 int udp_conf_nr;
 
+int buf512_conf_nr= -1;
+int bufrx_conf_nr= -1;
+
 int ip_forward_directed_bcast= 0;	/* Default is off */
 
 static u8_t iftype[IP_PORT_MAX];	/* Interface in use as? */
@@ -221,6 +224,25 @@ void read_conf(void)
 	icp= ip_conf;
 
 	while (token(0), word[0] != 0) {
+		if (strcmp(word, "buffers") == 0) {
+			token(1);
+			buf512_conf_nr= number(word, BUF_CONF_MAX);
+			if (buf512_conf_nr < BUF_CONF_MIN) {
+				printf("inet: need at least %d buffers\n",
+					BUF_CONF_MIN);
+				error();
+			}
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
+		if (strcmp(word, "rxbuffers") == 0) {
+			token(1);
+			bufrx_conf_nr= number(word, BUFRX_CONF_MAX);
+			token(0);
+			if (word[0] != ';' && word[0] != 0) error();
+			continue;
+		}
 		if (strncmp(word, "eth", 3) == 0) {
 			ecp->ec_ifno= ifno= number(word+3, IP_PORT_MAX-1);
 			type= NETTYPE_ETH;
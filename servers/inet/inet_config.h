@@ -24,6 +24,12 @@ extern int udp_conf_nr;		/* Number of configured UDP layers */
 
 extern dev_t ip_dev;		/* Device number of /dev/ip */
 
+#define BUF_CONF_MIN	64	/* Fewest 512 byte buffers to run with */
+#define BUF_CONF_MAX	8192	/* Most 512 byte buffers */
+#define BUFRX_CONF_MAX	1024	/* Most receive buffers */
+extern int buf512_conf_nr;	/* Number of 512 byte buffers, -1 if default */
+extern int bufrx_conf_nr;	/* Number of receive buffers, -1 if default */
+
 struct eth_conf
 {
 	char *ec_task;		/* Kernel ethernet task name if nonnull */
@@ -29,6 +29,16 @@ FORWARD _PROTOTYPE( void eth_recvev, (event_t *ev, ev_arg_t ev_arg) );
 FORWARD _PROTOTYPE( void eth_sendev, (event_t *ev, ev_arg_t ev_arg) );
 FORWARD _PROTOTYPE( eth_port_t *find_port, (message *m) );
 FORWARD _PROTOTYPE( void eth_restart, (eth_port_t *eth_port, int tasknr) );
+FORWARD _PROTOTYPE( void init_batch, (eth_port_t *eth_port) );
+FORWARD _PROTOTYPE( void free_batch, (eth_port_t *eth_port) );
+FORWARD _PROTOTYPE( void write_batch, (eth_port_t *eth_port, acc_t *pack) );
+FORWARD _PROTOTYPE( void start_write_batch, (eth_port_t *eth_port) );
+FORWARD _PROTOTYPE( void write_batch_int, (eth_port_t *eth_port) );
+FORWARD _PROTOTYPE( void setup_read_batch, (eth_port_t *eth_port) );
+FORWARD _PROTOTYPE( void read_batch_int, (eth_port_t *eth_port, int count) );
+FORWARD _PROTOTYPE( int dl_sendrec, (eth_port_t *eth_port, message *mp) );
+FORWARD _PROTOTYPE( void queue_sendrepl, (eth_port_t *eth_port,
+							message *mp) );
 
 PUBLIC void osdep_eth_init()
 {
@@ -43,6 +53,7 @@ PUBLIC void osdep_eth_init()
 	{
 		if (eth_is_vlan(ecp))
 			continue;
+		init_batch(eth_port);
 #ifdef __minix_vmd
 		r= sys_findproc(ecp->ec_task, &tasknr, 0);
 #else /* Minix 3 */
@@ -102,6 +113,7 @@ PUBLIC void osdep_eth_init()
 		}
 
 		eth_port->etp_ethaddr= *(ether_addr_t *)mess.m3_ca1;
+		eth_port->etp_osdep.etp_batch= !!(mess.DL_PORTS & DL_BATCH);
 
 		sr_add_minor(if2minor(ecp->ec_ifno, ETH_DEV_OFF),
 			i, eth_open, eth_close, eth_read, 
@@ -121,6 +133,7 @@ PUBLIC void osdep_eth_init()
 	{
 		if (!eth_is_vlan(ecp))
 			continue;
+		init_batch(eth_port);
 
  		eth_port->etp_osdep.etp_port= ecp->ec_port;
 		eth_port->etp_osdep.etp_task= ANY;
@@ -177,6 +190,12 @@ acc_t *pack;
 	assert(!eth_port->etp_vlan);
 
 	assert(eth_port->etp_wr_pack == NULL);
+
+	if (eth_port->etp_osdep.etp_batch)
+	{
+		write_batch(eth_port, pack);
+		return;
+	}
 	eth_port->etp_wr_pack= pack;
 
 	iovec= eth_port->etp_osdep.etp_wr_iovec;
@@ -242,9 +261,7 @@ acc_t *pack;
 		if (block_msg.DL_STAT & DL_PACK_SEND)
 		{
 			assert(loc_port != eth_port);
-			loc_port->etp_osdep.etp_sendrepl= block_msg;
-			ev_arg.ev_ptr= loc_port;
-			ev_enqueue(&loc_port->etp_sendev, eth_sendev, ev_arg);
+			queue_sendrepl(loc_port, &block_msg);
 		}
 		if (block_msg.DL_STAT & DL_PACK_RECV)
 		{
@@ -506,6 +523,12 @@ eth_port_t *eth_port;
 	int multicast;
 	u8_t *eth_dst_ptr;
 
+	if (eth_port->etp_osdep.etp_batch)
+	{
+		write_batch_int(eth_port);
+		return;
+	}
+
 	pack= eth_port->etp_wr_pack;
 	eth_port->etp_wr_pack= NULL;
 
@@ -531,6 +554,14 @@ int count;
 {
 	acc_t *pack, *cut_pack;
 
+	if (eth_port->etp_osdep.etp_batch)
+	{
+		read_batch_int(eth_port, count);
+		eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
+		setup_read(eth_port);
+		return;
+	}
+
 	pack= eth_port->etp_rd_pack;
 	eth_port->etp_rd_pack= NULL;
 
@@ -560,12 +591,18 @@ eth_port_t *eth_port;
 	assert(!eth_port->etp_vlan);
 	assert(!(eth_port->etp_flags & (EPF_READ_IP|EPF_READ_SP)));
 
+	if (eth_port->etp_osdep.etp_batch)
+	{
+		setup_read_batch(eth_port);
+		return;
+	}
+
 	do
 	{
 		assert (!eth_port->etp_rd_pack);
 
 		iovec= eth_port->etp_osdep.etp_rd_iovec;
-		pack= bf_memreq (ETH_MAX_PACK_SIZE_TAGGED);
+		pack= bf_rxreq (ETH_MAX_PACK_SIZE_TAGGED);
 
 		for (i=0, pack_ptr= pack; i<RD_IOVEC && pack_ptr;
 			i++, pack_ptr= pack_ptr->acc_next)
@@ -607,12 +644,7 @@ eth_port_t *eth_port;
 			assert(block_msg.DL_STAT &
 				(DL_PACK_SEND|DL_PACK_RECV));
 			if (block_msg.DL_STAT & DL_PACK_SEND)
-			{
-				loc_port->etp_osdep.etp_sendrepl= block_msg;
-				ev_arg.ev_ptr= loc_port;
-				ev_enqueue(&loc_port->etp_sendev, eth_sendev,
-					ev_arg);
-			}
+				queue_sendrepl(loc_port, &block_msg);
 			if (block_msg.DL_STAT & DL_PACK_RECV)
 			{
 				if (recv_debug)
@@ -669,11 +701,7 @@ eth_port_t *eth_port;
 		}
 
 		if (mess1.DL_STAT & DL_PACK_SEND)
-		{
-			eth_port->etp_osdep.etp_sendrepl= mess1;
-			ev_arg.ev_ptr= eth_port;
-			ev_enqueue(&eth_port->etp_sendev, eth_sendev, ev_arg);
-		}
+			queue_sendrepl(eth_port, &mess1);
 	} while (!(eth_port->etp_flags & EPF_READ_IP));
 	eth_port->etp_flags |= EPF_READ_SP;
 }
@@ -712,7 +740,8 @@ ev_arg_t ev_arg;
 	message *m_ptr;
 
 	eth_port= ev_arg.ev_ptr;
-	assert(ev == &eth_port->etp_sendev);
+	assert(ev == &eth_port->etp_sendev ||
+		ev == &eth_port->etp_osdep.etp_batchev);
 	m_ptr= &eth_port->etp_osdep.etp_sendrepl;
 
 	assert (m_ptr->m_type == DL_TASK_REPLY);
@@ -805,6 +834,12 @@ int tasknr;
 
 	eth_port->etp_ethaddr= *(ether_addr_t *)mess.m3_ca1;
 
+	/* The new driver may not batch, or batch differently, and the
+	 * old one dropped whatever it was doing.
+	 */
+	free_batch(eth_port);
+	eth_port->etp_osdep.etp_batch= !!(mess.DL_PORTS & DL_BATCH);
+
 	eth_port->etp_flags |= EPF_ENABLED;
 	if (eth_port->etp_wr_pack)
 	{
@@ -821,6 +856,408 @@ int tasknr;
 	setup_read (eth_port);
 }
 
+/*
+init_batch
+*/
+
+PRIVATE void init_batch(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	int i;
+
+	osp= &eth_port->etp_osdep;
+	osp->etp_batch= FALSE;
+	ev_init(&osp->etp_batchev);
+	osp->etp_wr_nr= 0;
+	osp->etp_wr_qnr= 0;
+	osp->etp_wr_full= FALSE;
+	for (i= 0; i<DL_BATCH_MAX; i++)
+		osp->etp_rd_batch[i]= NULL;
+}
+
+/*
+free_batch
+*/
+
+PRIVATE void free_batch(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	int i, reading;
+
+	osp= &eth_port->etp_osdep;
+	for (i= 0; i<osp->etp_wr_nr; i++)
+		bf_afree(osp->etp_wr_batch[i]);
+	for (i= 0; i<osp->etp_wr_qnr; i++)
+		bf_afree(osp->etp_wr_queue[i]);
+	osp->etp_wr_nr= 0;
+	osp->etp_wr_qnr= 0;
+
+	/* A packet that waited for the next batch is freed together with
+	 * etp_wr_pack by the caller.
+	 */
+	osp->etp_wr_full= FALSE;
+
+	reading= FALSE;
+	for (i= 0; i<DL_BATCH_MAX; i++)
+	{
+		if (!osp->etp_rd_batch[i])
+			continue;
+		bf_afree(osp->etp_rd_batch[i]);
+		osp->etp_rd_batch[i]= NULL;
+		reading= TRUE;
+	}
+	if (reading)
+		eth_port->etp_flags &= ~(EPF_READ_IP|EPF_READ_SP);
+}
+
+/*
+write_batch
+
+Packets that arrive while a batch is being sent are collected for the next
+one. Only when that one is full as well is the packet kept in etp_wr_pack,
+which stops eth.c from sending more.
+*/
+
+PRIVATE void write_batch(eth_port, pack)
+eth_port_t *eth_port;
+acc_t *pack;
+{
+	osdep_eth_port_t *osp;
+
+	osp= &eth_port->etp_osdep;
+	if (osp->etp_wr_nr != 0 && osp->etp_wr_qnr == DL_BATCH_MAX-1)
+	{
+		eth_port->etp_wr_pack= pack;
+		osp->etp_wr_full= TRUE;
+		return;
+	}
+	osp->etp_wr_queue[osp->etp_wr_qnr++]= pack;
+	if (osp->etp_wr_nr == 0)
+		start_write_batch(eth_port);
+}
+
+/*
+start_write_batch
+*/
+
+PRIVATE void start_write_batch(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	acc_t *pack, *pack_ptr;
+	iovec_t *iovec;
+	dl_pack_t *desc;
+	message mess1;
+	ev_arg_t ev_arg;
+	int i, j, r;
+
+	osp= &eth_port->etp_osdep;
+	assert(osp->etp_wr_nr == 0);
+	assert(osp->etp_wr_qnr > 0 && osp->etp_wr_qnr <= DL_BATCH_MAX);
+
+	for (i= 0; i<osp->etp_wr_qnr; i++)
+	{
+		pack= osp->etp_wr_queue[i];
+		for (j= 0, pack_ptr= pack; pack_ptr; j++,
+			pack_ptr= pack_ptr->acc_next)
+		{
+			;	/* count the fragments */
+		}
+		if (j >= IOVEC_NR)
+			pack= bf_pack(pack);	/* packet is too fragmented */
+		osp->etp_wr_batch[i]= pack;
+
+		iovec= osp->etp_wr_biovec[i];
+		desc= &osp->etp_wr_desc[i];
+		desc->dlp_size= 0;
+		for (j= 0, pack_ptr= pack; pack_ptr; j++,
+			pack_ptr= pack_ptr->acc_next)
+		{
+			iovec[j].iov_addr= (vir_bytes)ptr2acc_data(pack_ptr);
+			desc->dlp_size += iovec[j].iov_size=
+				pack_ptr->acc_length;
+		}
+		assert(j < IOVEC_NR);
+		assert(desc->dlp_size >= ETH_MIN_PACK_SIZE);
+		desc->dlp_iovec= (vir_bytes)iovec;
+		desc->dlp_count= j;
+	}
+	osp->etp_wr_nr= osp->etp_wr_qnr;
+	osp->etp_wr_qnr= 0;
+
+	mess1.m_type= DL_WRITEVB;
+	mess1.DL_PORT= osp->etp_port;
+	mess1.DL_PROC= this_proc;
+	mess1.DL_COUNT= osp->etp_wr_nr;
+	mess1.DL_MODE= DL_NOMODE;
+	mess1.DL_ADDR= (char *)osp->etp_wr_desc;
+
+	r= dl_sendrec(eth_port, &mess1);
+	if (r < 0)
+	{
+		printf("start_write_batch: sendrec to %d failed: %d\n",
+			osp->etp_task, r);
+		return;
+	}
+
+	assert(mess1.m_type == DL_TASK_REPLY &&
+		mess1.DL_PORT == osp->etp_port &&
+		mess1.DL_PROC == this_proc);
+	assert((mess1.DL_STAT >> 16) == OK);
+
+	if (mess1.DL_STAT & DL_PACK_RECV)
+	{
+		osp->etp_recvrepl= mess1;
+		ev_arg.ev_ptr= eth_port;
+		ev_enqueue(&osp->etp_recvev, eth_recvev, ev_arg);
+	}
+
+	/* Even if the whole batch is sent, finish it from the event queue.
+	 * We may be called from eth.c halfway through restarting writes.
+	 */
+	if (mess1.DL_STAT & DL_PACK_SEND)
+		queue_sendrepl(eth_port, &mess1);
+}
+
+/*
+write_batch_int
+*/
+
+PRIVATE void write_batch_int(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	acc_t *pack;
+	int i, multicast;
+	u8_t *eth_dst_ptr;
+
+	osp= &eth_port->etp_osdep;
+	for (i= 0; i<osp->etp_wr_nr; i++)
+	{
+		pack= osp->etp_wr_batch[i];
+		eth_dst_ptr= (u8_t *)ptr2acc_data(pack);
+		multicast= (*eth_dst_ptr & 1);
+		if (multicast || (osp->etp_recvconf & NWEO_EN_PROMISC))
+		{
+			assert(!no_ethWritePort);
+			no_ethWritePort= 1;
+			eth_arrive(eth_port, pack, bf_bufsize(pack));
+			assert(no_ethWritePort);
+			no_ethWritePort= 0;
+		}
+		else
+			bf_afree(pack);
+	}
+	osp->etp_wr_nr= 0;
+
+	if (osp->etp_wr_full)
+	{
+		assert(osp->etp_wr_qnr < DL_BATCH_MAX);
+		osp->etp_wr_queue[osp->etp_wr_qnr++]= eth_port->etp_wr_pack;
+		eth_port->etp_wr_pack= NULL;
+		osp->etp_wr_full= FALSE;
+	}
+	if (osp->etp_wr_qnr > 0)
+		start_write_batch(eth_port);
+
+	/* etp_wr_pack may also hold a looped back packet */
+	if (eth_port->etp_wr_pack == NULL)
+		eth_restart_write(eth_port);
+}
+
+/*
+setup_read_batch
+*/
+
+PRIVATE void setup_read_batch(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	acc_t *pack, *pack_ptr;
+	iovec_t *iovec;
+	dl_pack_t *desc;
+	message mess1;
+	int i, j, r;
+
+	osp= &eth_port->etp_osdep;
+	do
+	{
+		for (i= 0; i<DL_BATCH_MAX; i++)
+		{
+			pack= osp->etp_rd_batch[i];
+			if (!pack)
+			{
+				pack= bf_rxreq(ETH_MAX_PACK_SIZE_TAGGED);
+				osp->etp_rd_batch[i]= pack;
+			}
+
+			iovec= osp->etp_rd_biovec[i];
+			for (j=0, pack_ptr= pack; j<RD_IOVEC && pack_ptr;
+				j++, pack_ptr= pack_ptr->acc_next)
+			{
+				iovec[j].iov_addr=
+					(vir_bytes)ptr2acc_data(pack_ptr);
+				iovec[j].iov_size=
+					(vir_bytes)pack_ptr->acc_length;
+			}
+			assert (!pack_ptr);
+
+			desc= &osp->etp_rd_desc[i];
+			desc->dlp_iovec= (vir_bytes)iovec;
+			desc->dlp_count= j;
+			desc->dlp_size= 0;
+		}
+
+		mess1.m_type= DL_READVB;
+		mess1.DL_PORT= osp->etp_port;
+		mess1.DL_PROC= this_proc;
+		mess1.DL_COUNT= DL_BATCH_MAX;
+		mess1.DL_ADDR= (char *)osp->etp_rd_desc;
+
+		r= dl_sendrec(eth_port, &mess1);
+		if (r < 0)
+		{
+			printf("setup_read_batch: sendrec to %d failed: %d\n",
+				osp->etp_task, r);
+			eth_port->etp_flags |= EPF_READ_IP;
+			continue;
+		}
+
+		assert (mess1.m_type == DL_TASK_REPLY &&
+			mess1.DL_PORT == osp->etp_port &&
+			mess1.DL_PROC == this_proc);
+		compare((mess1.DL_STAT >> 16), ==, OK);
+
+		if (mess1.DL_STAT & DL_PACK_RECV)
+			read_batch_int(eth_port, mess1.DL_COUNT);
+		else
+			eth_port->etp_flags |= EPF_READ_IP;
+
+		if (mess1.DL_STAT & DL_PACK_SEND)
+			queue_sendrepl(eth_port, &mess1);
+	} while (!(eth_port->etp_flags & EPF_READ_IP));
+	eth_port->etp_flags |= EPF_READ_SP;
+}
+
+/*
+read_batch_int
+
+The driver filled the first 'count' buffers of the batch and stored the
+size of each packet in its descriptor.
+*/
+
+PRIVATE void read_batch_int(eth_port, count)
+eth_port_t *eth_port;
+int count;
+{
+	osdep_eth_port_t *osp;
+	acc_t *pack, *cut_pack;
+	size_t size;
+	int i;
+
+	osp= &eth_port->etp_osdep;
+	assert(count >= 0 && count <= DL_BATCH_MAX);
+	for (i= 0; i<count; i++)
+	{
+		pack= osp->etp_rd_batch[i];
+		osp->etp_rd_batch[i]= NULL;
+		size= osp->etp_rd_desc[i].dlp_size;
+
+		cut_pack= bf_cut(pack, 0, size);
+		bf_afree(pack);
+
+		assert(!no_ethWritePort);
+		no_ethWritePort= 1;
+		eth_arrive(eth_port, cut_pack, size);
+		assert(no_ethWritePort);
+		no_ethWritePort= 0;
+	}
+}
+
+/*
+dl_sendrec
+
+Send a request to the driver. If the driver is sending to us at the same
+time, accept its message first and queue it for later processing.
+*/
+
+PRIVATE int dl_sendrec(eth_port, mp)
+eth_port_t *eth_port;
+message *mp;
+{
+	eth_port_t *loc_port;
+	message block_msg;
+	ev_arg_t ev_arg;
+	int r;
+
+	for (;;)
+	{
+		r= sendrec(eth_port->etp_osdep.etp_task, mp);
+		if (r != ELOCKED)
+			return r;
+
+		/* ethernet task is sending to this task, I hope */
+		r= receive(eth_port->etp_osdep.etp_task, &block_msg);
+		if (r < 0)
+			ip_panic(("unable to receive"));
+
+		loc_port= find_port(&block_msg);
+		assert(block_msg.DL_STAT & (DL_PACK_SEND|DL_PACK_RECV));
+		if (block_msg.DL_STAT & DL_PACK_SEND)
+			queue_sendrepl(loc_port, &block_msg);
+		if (block_msg.DL_STAT & DL_PACK_RECV)
+		{
+			loc_port->etp_osdep.etp_recvrepl= block_msg;
+			ev_arg.ev_ptr= loc_port;
+			ev_enqueue(&loc_port->etp_osdep.etp_recvev,
+				eth_recvev, ev_arg);
+		}
+	}
+}
+
+/*
+queue_sendrepl
+
+A batching port has its own event, etp_sendev may be busy with a looped
+back packet.
+*/
+
+PRIVATE void queue_sendrepl(eth_port, mp)
+eth_port_t *eth_port;
+message *mp;
+{
+	ev_arg_t ev_arg;
+
+	eth_port->etp_osdep.etp_sendrepl= *mp;
+	ev_arg.ev_ptr= eth_port;
+	if (eth_port->etp_osdep.etp_batch)
+	{
+		ev_enqueue(&eth_port->etp_osdep.etp_batchev, eth_sendev,
+			ev_arg);
+	}
+	else
+		ev_enqueue(&eth_port->etp_sendev, eth_sendev, ev_arg);
+}
+
+#ifdef BUF_CONSISTENCY_CHECK
+PUBLIC void osdep_eth_bufcheck(eth_port)
+eth_port_t *eth_port;
+{
+	osdep_eth_port_t *osp;
+	int i;
+
+	osp= &eth_port->etp_osdep;
+	for (i= 0; i<osp->etp_wr_nr; i++)
+		bf_check_acc(osp->etp_wr_batch[i]);
+	for (i= 0; i<osp->etp_wr_qnr; i++)
+		bf_check_acc(osp->etp_wr_queue[i]);
+	for (i= 0; i<DL_BATCH_MAX; i++)
+		bf_check_acc(osp->etp_rd_batch[i]);
+}
+#endif
+
 /*
  * $PchId: mnx_eth.c,v 1.16 2005/06/28 14:24:37 philip Exp $
  */
@@ -24,6 +24,20 @@ typedef struct osdep_eth_port
 	event_t etp_recvev;
 	message etp_sendrepl;
 	message etp_recvrepl;
+
+	/* Batched I/O, used if the driver does DL_READVB and DL_WRITEVB */
+	int etp_batch;
+	event_t etp_batchev;
+	int etp_wr_nr;			/* packets being written */
+	int etp_wr_qnr;			/* packets waiting for the next batch */
+	int etp_wr_full;		/* etp_wr_pack waits for the next batch */
+	struct acc *etp_wr_batch[DL_BATCH_MAX];
+	struct acc *etp_wr_queue[DL_BATCH_MAX];
+	dl_pack_t etp_wr_desc[DL_BATCH_MAX];
+	iovec_t etp_wr_biovec[DL_BATCH_MAX][IOVEC_NR];
+	struct acc *etp_rd_batch[DL_BATCH_MAX];
+	dl_pack_t etp_rd_desc[DL_BATCH_MAX];
+	iovec_t etp_rd_biovec[DL_BATCH_MAX][RD_IOVEC];
 } osdep_eth_port_t;
 
 #endif /* INET__OSDEP_ETH_H */
@@ -43,6 +43,7 @@ PRIVATE struct export_param_list inet_ex_list[]=
 	QP_VARIABLE(tcp_cancel_f),
 	QP_VECTOR(udp_port_table, udp_port_table, ip_conf_nr),
 	QP_VARIABLE(udp_fd_table),
+	QP_VARIABLE(bf_stat),
 	QP_END()
 };
 
@@ -12,7 +12,7 @@
 /* Define hooks for the debugging dumps. This table maps function keys
  * onto a specific dump and provides a description for it.
  */
-#define NHOOKS 19
+#define NHOOKS 21
 
 struct hook_entry {
 	int key;
@@ -38,6 +38,8 @@ struct hook_entry {
 	{ SF6,	rproc_dmp, "Reincarnation server process table" },
 	{ SF7,  holes_dmp, "Memory free list" },
 	{ SF8,  data_store_dmp, "Data store contents" },
+	{ SF9,  callq_dmp, "IPC caller queue lengths" },
+	{ SF10, fsstats_dmp, "File system statistics" },
 };
 
 /*===========================================================================*
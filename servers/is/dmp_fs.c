@@ -3,6 +3,7 @@
  * The entry points into this file are
  *   dtab_dump:   	display device <-> driver mappings	  
  *   fproc_dump:   	display FS process table	  
+ *   fsstats_dmp:   	display FS statistics
  *
  * Created:
  *   Oct 01, 2004:	by Jorrit N. Herder
@@ -80,3 +81,54 @@ PUBLIC void dtab_dmp()
     }
 }
 
+
+/*===========================================================================*
+ *				fsstats_dmp				     *
+ *===========================================================================*/
+PUBLIC void fsstats_dmp()
+{
+  static char *names[_NR_BLOCK_TYPES] = {
+	"inode", "directory", "indirect", "map", NULL, "full data", "partial data"
+  };
+  struct fs_stats fss;
+  u32_t total;
+  int i;
+
+  if (getsysinfo(FS_PROC_NR, SI_FS_STATS, &fss) != OK) {
+	printf("IS: warning: couldn't get FS statistics\n");
+	return;
+  }
+
+  printf("File System (FS) statistics\n");
+  printf("%d buffers, %d protected, %d dirty; %lu demoted, %lu dirty evicted\n",
+	fss.fss_nr_bufs, fss.fss_protected, fss.fss_dirty,
+	(unsigned long) fss.fss_demoted, (unsigned long) fss.fss_dirty_evicts);
+  printf("Block type        Hits    Misses  Hit%%\n");
+  for (i = 0; i < _NR_BLOCK_TYPES; i++) {
+	if (names[i] == NULL) continue;
+	total = fss.fss_hits[i] + fss.fss_misses[i];
+	printf("%-12s  %8lu  %8lu  %3lu%%\n", names[i],
+		(unsigned long) fss.fss_hits[i],
+		(unsigned long) fss.fss_misses[i],
+		total == 0 ? 0L : (unsigned long) fss.fss_hits[i] * 100 / total);
+  }
+  printf("Read ahead: %lu blocks, %lu used\n",
+	(unsigned long) fss.fss_ra_blocks, (unsigned long) fss.fss_ra_hits);
+  printf("Scattered I/O: %lu calls, %lu blocks, %lu transfers\n",
+	(unsigned long) fss.fss_scatter_calls,
+	(unsigned long) fss.fss_scatter_blocks,
+	(unsigned long) fss.fss_scatter_xfers);
+  printf("  blocks per call:");
+  for (i = 0; i < _NR_FS_BATCH; i++)
+	printf(" %d%s:%lu", 1 << i, i == _NR_FS_BATCH - 1 ? "+" : "",
+		(unsigned long) fss.fss_batch[i]);
+  printf("\nRequests: %lu, %lu kcycles\n",
+	(unsigned long) fss.fss_calls, (unsigned long) fss.fss_call_kcycles);
+  printf("  kcycles per request:");
+  for (i = 0; i < _NR_FS_LATENCY; i++) {
+	if (i % 8 == 0 && i != 0) printf("\n ");
+	printf(" %d%s:%lu", 1 << i, i == _NR_FS_LATENCY - 1 ? "+" : "",
+		(unsigned long) fss.fss_latency[i]);
+  }
+  printf("\n");
+}
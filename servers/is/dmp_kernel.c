@@ -254,6 +254,32 @@ PUBLIC void sched_dmp()
   printf("\n");
 }
 
+/*===========================================================================*
+ *				callq_dmp    				     *
+ *===========================================================================*/
+PUBLIC void callq_dmp()
+{
+  register struct proc *rp;
+  int r;
+
+  /* First obtain a fresh copy of the current process table. */
+  if ((r = sys_getproctab(proc)) != OK) {
+      report("IS","warning: couldn't get copy of process table", r);
+      return;
+  }
+
+  printf("Caller queue lengths of processes that ever had senders queued.\n");
+  printf("\n--nr-name---- -queued- -max-\n");
+  for (rp = BEG_PROC_ADDR; rp < END_PROC_ADDR; rp++) {
+	if (isemptyp(rp) || rp->p_caller_max == 0) continue;
+	if (proc_nr(rp) < 0) 	printf("[%2d] ", proc_nr(rp));
+	else 			printf(" %2d  ", proc_nr(rp));
+	printf(" %-8.8s %6d %5d\n",
+	       rp->p_name, rp->p_caller_len, rp->p_caller_max);
+  }
+  printf("\n");
+}
+
 /*===========================================================================*
  *				kenv_dmp				     *
  *===========================================================================*/
@@ -299,6 +325,11 @@ PUBLIC void kenv_dmp()
     printf("- version:      %.6s\n", kinfo.version); 
 #if DEBUG_LOCK_CHECK
     printf("- relocking:    %d\n", kinfo.relocking); 
+#endif
+#if DEBUG_IPC_STATS
+    printf("- notify_lookups: %lu\n", kinfo.notify_lookups); 
+    printf("- notify_scans:   %lu\n", kinfo.notify_scans); 
+    printf("- sendrec_fast:   %lu\n", kinfo.sendrec_fast); 
 #endif
     printf("\n");
 }
@@ -135,6 +135,16 @@ PUBLIC void holes_dmp(void)
 		100*(total_bytes/100-largest_bytes/100)/total_bytes,
 		(pmi.pmi_hi_watermark/1024 << CLICK_SHIFT));
 
+	printf("\nHoles on the free lists: %d (swap %d)\n",
+		pmi.pmi_nr_holes, pmi.pmi_class_holes[_NR_HOLE_CLASSES]);
+	for(h = 0; h < _NR_HOLE_CLASSES; h++) {
+		if(pmi.pmi_class_holes[h] == 0) continue;
+		printf("  >= %7ld kB: %3d\n",
+			((long) CLICK_SIZE << h) / 1024, pmi.pmi_class_holes[h]);
+	}
+	printf("Allocations: %lu, lists probed: %lu, failed: %lu\n",
+		pmi.pmi_allocs, pmi.pmi_alloc_probes, pmi.pmi_alloc_fails);
+
 	return;
 }
 
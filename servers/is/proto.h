@@ -17,6 +17,7 @@ _PROTOTYPE( void image_dmp, (void)					);
 _PROTOTYPE( void irqtab_dmp, (void)					);
 _PROTOTYPE( void kmessages_dmp, (void)					);
 _PROTOTYPE( void sched_dmp, (void)					);
+_PROTOTYPE( void callq_dmp, (void)					);
 _PROTOTYPE( void monparams_dmp, (void)					);
 _PROTOTYPE( void kenv_dmp, (void)					);
 _PROTOTYPE( void timing_dmp, (void)					);
@@ -29,6 +30,7 @@ _PROTOTYPE( void holes_dmp, (void)					);
 /* dmp_fs.c */
 _PROTOTYPE( void dtab_dmp, (void)					);
 _PROTOTYPE( void fproc_dmp, (void)					);
+_PROTOTYPE( void fsstats_dmp, (void)					);
 
 /* dmp_rs.c */
 _PROTOTYPE( void rproc_dmp, (void)					);
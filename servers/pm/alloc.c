@@ -1,18 +1,23 @@
 /* This file is concerned with allocating and freeing arbitrary-size blocks of
  * physical memory on behalf of the FORK and EXEC system calls.  The key data
  * structure used is the hole table, which maintains a list of holes in memory.
- * It is kept sorted in order of increasing memory address. The addresses
- * it contains refers to physical memory, starting at absolute address 0
- * (i.e., they are not relative to the start of PM).  During system
+ * The addresses it contains refers to physical memory, starting at absolute 
+ * address 0 (i.e., they are not relative to the start of PM).  During system
  * initialization, that part of memory containing the interrupt vectors,
  * kernel, and PM are "allocated" to mark them as not available and to
  * remove them from the hole list.
  *
+ * Holes are kept on segregated free lists: list 'c' holds the holes with a 
+ * length of at least 2^c and less than 2^(c+1) clicks. An allocation looks 
+ * only at the list of its own size class, and otherwise takes the first hole 
+ * of the next nonempty, larger class. To merge a freed block with its 
+ * neighbours, the holes are also hashed on their base and end addresses.
+ * The holes in the swap area have a free list of their own.
+ *
  * The entry points into this file are:
  *   alloc_mem:	allocate a given sized chunk of memory
  *   free_mem:	release a previously allocated chunk of memory
  *   mem_init:	initialize the tables when PM start up
- *   max_hole:	returns the largest hole currently available
  *   mem_holes_copy: for outsiders who want a copy of the hole-list
  */
 
@@ -31,11 +36,24 @@
 
 #define NIL_HOLE (struct hole *) 0
 
+#define NR_HOLE_HASH	64		/* must be a power of 2 */
+#define hole_hash(c)	(((c) ^ ((c) >> 6)) & (NR_HOLE_HASH - 1))
+#define SWAP_CLASS	_NR_HOLE_CLASSES	/* free list of the swap area */
+
 PRIVATE struct hole hole[_NR_HOLES];
 PRIVATE u32_t high_watermark = 0;
 
-PRIVATE struct hole *hole_head;	/* pointer to first hole */
+PRIVATE struct hole *free_list[_NR_HOLE_CLASSES + 1];	/* size classes */
+PRIVATE struct hole *base_hash[NR_HOLE_HASH];	/* holes by h_base */
+PRIVATE struct hole *end_hash[NR_HOLE_HASH];	/* holes by h_base + h_len */
 PRIVATE struct hole *free_slots;/* ptr to list of unused table slots */
+PRIVATE struct {		/* fragmentation statistics */
+  int nr_holes;			/* number of holes on the lists */
+  int class_holes[_NR_HOLE_CLASSES + 1];	/* holes per size class */
+  u32_t allocs;			/* number of allocation requests */
+  u32_t alloc_probes;		/* holes or lists looked at */
+  u32_t alloc_fails;		/* requests that could not be met */
+} stats;
 #if ENABLE_SWAP
 PRIVATE int swap_fd = -1;	/* file descriptor of open swap file/device */
 PRIVATE u32_t swap_offset;	/* offset to start of swap area on swap file */
@@ -47,8 +65,14 @@ PRIVATE struct mproc *outswap = &mproc[0]; 	 /* outswap candidate? */
 #define swap_base ((phys_clicks) -1)
 #endif /* ENABLE_SWAP */
 
-FORWARD _PROTOTYPE( void del_slot, (struct hole *prev_ptr, struct hole *hp) );
-FORWARD _PROTOTYPE( void merge, (struct hole *hp)			    );
+FORWARD _PROTOTYPE( int hole_class, (phys_clicks clicks)		    );
+FORWARD _PROTOTYPE( void hole_link, (struct hole *hp)			    );
+FORWARD _PROTOTYPE( void hole_unlink, (struct hole *hp)		    );
+FORWARD _PROTOTYPE( struct hole *hole_find, (struct hole **table,
+			phys_clicks addr, int by_end)			    );
+FORWARD _PROTOTYPE( phys_clicks take_hole, (struct hole *hp,
+			phys_clicks clicks)				    );
+FORWARD _PROTOTYPE( void del_slot, (struct hole *hp)			    );
 #if ENABLE_SWAP
 FORWARD _PROTOTYPE( int swap_out, (void)				    );
 #else
@@ -61,43 +85,64 @@ FORWARD _PROTOTYPE( int swap_out, (void)				    );
 PUBLIC phys_clicks alloc_mem(clicks)
 phys_clicks clicks;		/* amount of memory requested */
 {
-/* Allocate a block of memory from the free list using first fit. The block
- * consists of a sequence of contiguous bytes, whose length in clicks is
- * given by 'clicks'.  A pointer to the block is returned.  The block is
- * always on a click boundary.  This procedure is called when memory is
- * needed for FORK or EXEC.  Swap other processes out if needed.
+/* Allocate a block of memory from the free lists. The block consists of a
+ * sequence of contiguous bytes, whose length in clicks is given by 'clicks'.
+ * A pointer to the block is returned.  The block is always on a click 
+ * boundary.  This procedure is called when memory is needed for FORK or 
+ * EXEC.  Swap other processes out if needed.
  */
-  register struct hole *hp, *prev_ptr;
-  phys_clicks old_base;
+  register struct hole *hp;
+  int c;
 
+  stats.allocs++;
   do {
-        prev_ptr = NIL_HOLE;
-	hp = hole_head;
-	while (hp != NIL_HOLE && hp->h_base < swap_base) {
-		if (hp->h_len >= clicks) {
-			/* We found a hole that is big enough.  Use it. */
-			old_base = hp->h_base;	/* remember where it started */
-			hp->h_base += clicks;	/* bite a piece off */
-			hp->h_len -= clicks;	/* ditto */
-
-			/* Remember new high watermark of used memory. */
-			if(hp->h_base > high_watermark)
-				high_watermark = hp->h_base;
-
-			/* Delete the hole if used up completely. */
-			if (hp->h_len == 0) del_slot(prev_ptr, hp);
-
-			/* Return the start address of the acquired block. */
-			return(old_base);
-		}
-
-		prev_ptr = hp;
-		hp = hp->h_next;
+	/* Holes in the class of the request may be too small. Use the first
+	 * one that is big enough.
+	 */
+	c = hole_class(clicks);
+	for (hp = free_list[c]; hp != NIL_HOLE; hp = hp->h_next) {
+		stats.alloc_probes++;
+		if (hp->h_len >= clicks) return(take_hole(hp, clicks));
+	}
+
+	/* Any hole in a larger class will do. */
+	while (++c < _NR_HOLE_CLASSES) {
+		stats.alloc_probes++;
+		if ((hp = free_list[c]) != NIL_HOLE)
+			return(take_hole(hp, clicks));
 	}
   } while (swap_out());		/* try to swap some other process out */
+  stats.alloc_fails++;
   return(NO_MEM);
 }
 
+/*===========================================================================*
+ *				take_hole				     *
+ *===========================================================================*/
+PRIVATE phys_clicks take_hole(hp, clicks)
+register struct hole *hp;	/* hole that is big enough */
+phys_clicks clicks;		/* amount of memory requested */
+{
+/* Bite a block of 'clicks' off the start of a hole and return its address.
+ * The rest of the hole moves to the free list of its new size class.
+ */
+  phys_clicks old_base;
+
+  hole_unlink(hp);
+  old_base = hp->h_base;	/* remember where it started */
+  hp->h_base += clicks;		/* bite a piece off */
+  hp->h_len -= clicks;		/* ditto */
+
+  /* Remember new high watermark of used memory. */
+  if (hp->h_base < swap_base && hp->h_base > high_watermark)
+	high_watermark = hp->h_base;
+
+  /* Delete the hole if used up completely. */
+  if (hp->h_len == 0) del_slot(hp);
+  else hole_link(hp);
+  return(old_base);
+}
+
 /*===========================================================================*
  *				free_mem				     *
  *===========================================================================*/
@@ -106,101 +151,135 @@ phys_clicks base;		/* base address of block to free */
 phys_clicks clicks;		/* number of clicks to free */
 {
 /* Return a block of free memory to the hole list.  The parameters tell where
- * the block starts in physical memory and how big it is.  The block is added
- * to the hole list.  If it is contiguous with an existing hole on either end,
- * it is merged with the hole or holes.
+ * the block starts in physical memory and how big it is.  If it is 
+ * contiguous with an existing hole on either end, it is merged with the 
+ * hole or holes. The neighbours are found through the address hashes.
  */
-  register struct hole *hp, *new_ptr, *prev_ptr;
+  register struct hole *hp;
 
   if (clicks == 0) return;
-  if ( (new_ptr = free_slots) == NIL_HOLE) 
-  	panic(__FILE__,"hole table full", NO_NUM);
-  new_ptr->h_base = base;
-  new_ptr->h_len = clicks;
-  free_slots = new_ptr->h_next;
-  hp = hole_head;
-
-  /* If this block's address is numerically less than the lowest hole currently
-   * available, or if no holes are currently available, put this hole on the
-   * front of the hole list.
-   */
-  if (hp == NIL_HOLE || base <= hp->h_base) {
-	/* Block to be freed goes on front of the hole list. */
-	new_ptr->h_next = hp;
-	hole_head = new_ptr;
-	merge(new_ptr);
-	return;
+
+  /* Absorb the hole that ends where this block starts. */
+  if ((hp = hole_find(end_hash, base, TRUE)) != NIL_HOLE) {
+	hole_unlink(hp);
+	base = hp->h_base;
+	clicks += hp->h_len;
+	del_slot(hp);
   }
 
-  /* Block to be returned does not go on front of hole list. */
-  prev_ptr = NIL_HOLE;
-  while (hp != NIL_HOLE && base > hp->h_base) {
-	prev_ptr = hp;
-	hp = hp->h_next;
+  /* Absorb the hole that starts where this block ends. */
+  if ((hp = hole_find(base_hash, base + clicks, FALSE)) != NIL_HOLE) {
+	hole_unlink(hp);
+	clicks += hp->h_len;
+	del_slot(hp);
   }
 
-  /* We found where it goes.  Insert block after 'prev_ptr'. */
-  new_ptr->h_next = prev_ptr->h_next;
-  prev_ptr->h_next = new_ptr;
-  merge(prev_ptr);		/* sequence is 'prev_ptr', 'new_ptr', 'hp' */
+  if ( (hp = free_slots) == NIL_HOLE) 
+  	panic(__FILE__,"hole table full", NO_NUM);
+  free_slots = hp->h_next;
+  hp->h_base = base;
+  hp->h_len = clicks;
+  hole_link(hp);
 }
 
 /*===========================================================================*
- *				del_slot				     *
+ *				hole_class				     *
  *===========================================================================*/
-PRIVATE void del_slot(prev_ptr, hp)
-/* pointer to hole entry just ahead of 'hp' */
-register struct hole *prev_ptr;
-/* pointer to hole entry to be removed */
-register struct hole *hp;	
+PRIVATE int hole_class(clicks)
+phys_clicks clicks;		/* length of a hole */
 {
-/* Remove an entry from the hole list.  This procedure is called when a
- * request to allocate memory removes a hole in its entirety, thus reducing
- * the numbers of holes in memory, and requiring the elimination of one
- * entry in the hole list.
+/* Return the size class for a hole of the given length: the position of the 
+ * highest bit set, limited to the number of classes.
  */
-  if (hp == hole_head)
-	hole_head = hp->h_next;
-  else
-	prev_ptr->h_next = hp->h_next;
+  int c = 0;
 
-  hp->h_next = free_slots;
-  hp->h_base = hp->h_len = 0;
-  free_slots = hp;
+  while ((clicks >>= 1) != 0 && c < _NR_HOLE_CLASSES - 1) c++;
+  return(c);
 }
 
 /*===========================================================================*
- *				merge					     *
+ *				hole_link				     *
  *===========================================================================*/
-PRIVATE void merge(hp)
-register struct hole *hp;	/* ptr to hole to merge with its successors */
+PRIVATE void hole_link(hp)
+register struct hole *hp;	/* hole to enter in the tables */
 {
-/* Check for contiguous holes and merge any found.  Contiguous holes can occur
- * when a block of memory is freed, and it happens to abut another hole on
- * either or both ends.  The pointer 'hp' points to the first of a series of
- * three holes that can potentially all be merged together.
- */
-  register struct hole *next_ptr;
+/* Put a hole on the front of its free list, and in both address hashes. */
+  struct hole **headp;
+  int h;
+
+  hp->h_class = (hp->h_base >= swap_base) ? SWAP_CLASS : hole_class(hp->h_len);
+  headp = &free_list[hp->h_class];
+  hp->h_prev = NIL_HOLE;
+  if ((hp->h_next = *headp) != NIL_HOLE) (*headp)->h_prev = hp;
+  *headp = hp;
+
+  h = hole_hash(hp->h_base);
+  hp->h_bnext = base_hash[h];
+  base_hash[h] = hp;
+  h = hole_hash(hp->h_base + hp->h_len);
+  hp->h_enext = end_hash[h];
+  end_hash[h] = hp;
+
+  stats.nr_holes++;
+  stats.class_holes[hp->h_class]++;
+}
 
-  /* If 'hp' points to the last hole, no merging is possible.  If it does not,
-   * try to absorb its successor into it and free the successor's table entry.
-   */
-  if ( (next_ptr = hp->h_next) == NIL_HOLE) return;
-  if (hp->h_base + hp->h_len == next_ptr->h_base) {
-	hp->h_len += next_ptr->h_len;	/* first one gets second one's mem */
-	del_slot(hp, next_ptr);
-  } else {
-	hp = next_ptr;
-  }
+/*===========================================================================*
+ *				hole_unlink				     *
+ *===========================================================================*/
+PRIVATE void hole_unlink(hp)
+register struct hole *hp;	/* hole to remove from the tables */
+{
+/* Remove a hole from its free list and from both address hashes. */
+  struct hole **xpp;
+
+  if (hp->h_prev != NIL_HOLE) hp->h_prev->h_next = hp->h_next;
+  else free_list[hp->h_class] = hp->h_next;
+  if (hp->h_next != NIL_HOLE) hp->h_next->h_prev = hp->h_prev;
+
+  for (xpp = &base_hash[hole_hash(hp->h_base)]; *xpp != hp;
+	xpp = &(*xpp)->h_bnext) ;
+  *xpp = hp->h_bnext;
+  for (xpp = &end_hash[hole_hash(hp->h_base + hp->h_len)]; *xpp != hp;
+	xpp = &(*xpp)->h_enext) ;
+  *xpp = hp->h_enext;
+
+  stats.nr_holes--;
+  stats.class_holes[hp->h_class]--;
+}
 
-  /* If 'hp' now points to the last hole, return; otherwise, try to absorb its
-   * successor into it.
-   */
-  if ( (next_ptr = hp->h_next) == NIL_HOLE) return;
-  if (hp->h_base + hp->h_len == next_ptr->h_base) {
-	hp->h_len += next_ptr->h_len;
-	del_slot(hp, next_ptr);
+/*===========================================================================*
+ *				hole_find				     *
+ *===========================================================================*/
+PRIVATE struct hole *hole_find(table, addr, by_end)
+struct hole **table;		/* base_hash or end_hash */
+phys_clicks addr;		/* address to look for */
+int by_end;			/* TRUE to match on the end of the hole */
+{
+/* Look up the hole that starts or ends at the given address. */
+  register struct hole *hp;
+
+  for (hp = table[hole_hash(addr)]; hp != NIL_HOLE;
+	hp = by_end ? hp->h_enext : hp->h_bnext) {
+	if ((by_end ? hp->h_base + hp->h_len : hp->h_base) == addr) break;
   }
+  return(hp);
+}
+
+/*===========================================================================*
+ *				del_slot				     *
+ *===========================================================================*/
+PRIVATE void del_slot(hp)
+register struct hole *hp;	/* pointer to hole entry to be removed */
+{
+/* Return an entry to the list of unused table slots. This procedure is called
+ * when a request to allocate memory removes a hole in its entirety, or when 
+ * holes are merged, thus reducing the numbers of holes in memory. The entry
+ * must already have been removed from the free lists and hashes.
+ */
+  hp->h_next = free_slots;
+  hp->h_base = hp->h_len = 0;
+  free_slots = hp;
 }
 
 /*===========================================================================*
@@ -210,14 +289,14 @@ PUBLIC void mem_init(chunks, free)
 struct memory *chunks;		/* list of free memory chunks */
 phys_clicks *free;		/* memory size summaries */
 {
-/* Initialize hole lists.  There are two lists: 'hole_head' points to a linked
- * list of all the holes (unused memory) in the system; 'free_slots' points to
- * a linked list of table entries that are not in use.  Initially, the former
- * list has one entry for each chunk of physical memory, and the second
- * list links together the remaining table slots.  As memory becomes more
- * fragmented in the course of time (i.e., the initial big holes break up into
- * smaller holes), new table slots are needed to represent them.  These slots
- * are taken from the list headed by 'free_slots'.
+/* Initialize hole lists.  The free lists contain the holes (unused memory) 
+ * in the system; 'free_slots' points to a linked list of table entries that
+ * are not in use.  Initially, the free lists have one entry for each chunk 
+ * of physical memory, and the second list links together the remaining table
+ * slots.  As memory becomes more fragmented in the course of time (i.e., the
+ * initial big holes break up into smaller holes), new table slots are needed
+ * to represent them.  These slots are taken from the list headed by 
+ * 'free_slots'.
  */
   int i;
   register struct hole *hp;
@@ -228,40 +307,46 @@ phys_clicks *free;		/* memory size summaries */
 	hp->h_base = hp->h_len = 0;
   }
   hole[_NR_HOLES-1].h_next = NIL_HOLE;
-  hole_head = NIL_HOLE;
   free_slots = &hole[0];
 
+#if ENABLE_SWAP
+  /* The swap area is represented as a hole above and separate of regular
+   * memory.  A hole at the size of the swap file is allocated on "swapon".
+   * The swap base must be known before any hole is put on a free list.
+   */
+  for (i=NR_MEMS-1; i>=0; i--) {
+	if (chunks[i].size > 0 && swap_base < chunks[i].base + chunks[i].size) 
+		swap_base = chunks[i].base + chunks[i].size;
+  }
+  swap_base++;				/* make separate */
+  swap_maxsize = 0 - swap_base;		/* maximum we can possibly use */
+#endif
+
   /* Use the chunks of physical memory to allocate holes. */
   *free = 0;
   for (i=NR_MEMS-1; i>=0; i--) {
   	if (chunks[i].size > 0) {
 		free_mem(chunks[i].base, chunks[i].size);
 		*free += chunks[i].size;
-#if ENABLE_SWAP
-		if (swap_base < chunks[i].base + chunks[i].size) 
-			swap_base = chunks[i].base + chunks[i].size;
-#endif
 	}
   }
-
-#if ENABLE_SWAP
-  /* The swap area is represented as a hole above and separate of regular
-   * memory.  A hole at the size of the swap file is allocated on "swapon".
-   */
-  swap_base++;				/* make separate */
-  swap_maxsize = 0 - swap_base;		/* maximum we can possibly use */
-#endif
 }
 
 /*===========================================================================*
  *				mem_holes_copy				     *
  *===========================================================================*/
-PUBLIC int mem_holes_copy(struct hole *holecopies, size_t *bytes, u32_t *hi)
+PUBLIC int mem_holes_copy(pmi)
+struct pm_mem_info *pmi;	/* where to store hole table and statistics */
 {
-	if(*bytes < sizeof(hole)) return ENOSPC;
-	memcpy(holecopies, hole, sizeof(hole));
-	*bytes = sizeof(hole);
-	*hi = high_watermark;
+/* Copy the hole table and the fragmentation statistics for outsiders. */
+	memcpy(pmi->pmi_holes, hole, sizeof(hole));
+	pmi->pmi_hi_watermark = high_watermark;
+	pmi->pmi_nr_holes = stats.nr_holes;
+	memcpy(pmi->pmi_class_holes, stats.class_holes,
+		sizeof(stats.class_holes));
+	pmi->pmi_allocs = stats.allocs;
+	pmi->pmi_alloc_probes = stats.alloc_probes;
+	pmi->pmi_alloc_fails = stats.alloc_fails;
 	return OK;
 }
 
@@ -293,7 +378,7 @@ PUBLIC int swap_off()
 {
 /* Turn swapping off. */
   struct mproc *rmp;
-  struct hole *hp, *prev_ptr;
+  struct hole *hp;
 
   if (swap_fd == -1) return(OK);	/* can't turn off what isn't on */
 
@@ -308,12 +393,10 @@ PUBLIC int swap_off()
 	if (rmp->mp_flags & ONSWAP) return(ENOMEM);
   }
 
-  /* Yes.  Remove the swap hole and close the swap file descriptor. */
-  for (hp = hole_head; hp != NIL_HOLE; prev_ptr = hp, hp = hp->h_next) {
-	if (hp->h_base >= swap_base) {
-		del_slot(prev_ptr, hp);
-		hp = hole_head;
-	}
+  /* Yes.  Remove the swap holes and close the swap file descriptor. */
+  while ((hp = free_list[SWAP_CLASS]) != NIL_HOLE) {
+	hole_unlink(hp);
+	del_slot(hp);
   }
   close(swap_fd);
   swap_fd = -1;
@@ -395,7 +478,7 @@ PRIVATE int swap_out()
  * on a system call that PM handles, like wait(), pause() or sigsuspend().
  */
   struct mproc *rmp;
-  struct hole *hp, *prev_ptr;
+  struct hole *hp;
   phys_clicks old_base, new_base, size;
   off_t off;
   int proc_nr;
@@ -408,22 +491,19 @@ PRIVATE int swap_out()
 	if (!(rmp->mp_flags & (PAUSED | WAITING | SIGSUSPENDED))) continue;
 
 	/* Already on swap or otherwise to be avoided? */
-	if (rmp->mp_flags & (DONT_SWAP | TRACED | REPLY | ONSWAP)) continue;
+	if (rmp->mp_flags & (DONT_SWAP | TRACED | REPLY | ONSWAP | VFORKED))
+		continue;
 
 	/* Got one, find a swap hole and swap it out. */
 	proc_nr = (rmp - mproc);
 	size = rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len
 		- rmp->mp_seg[D].mem_vir;
 
-	prev_ptr = NIL_HOLE;
-	for (hp = hole_head; hp != NIL_HOLE; prev_ptr = hp, hp = hp->h_next) {
-		if (hp->h_base >= swap_base && hp->h_len >= size) break;
+	for (hp = free_list[SWAP_CLASS]; hp != NIL_HOLE; hp = hp->h_next) {
+		if (hp->h_len >= size) break;
 	}
 	if (hp == NIL_HOLE) continue;	/* oops, not enough swapspace */
-	new_base = hp->h_base;
-	hp->h_base += size;
-	hp->h_len -= size;
-	if (hp->h_len == 0) del_slot(prev_ptr, hp);
+	new_base = take_hole(hp, size);
 
 	off = swap_offset + ((off_t) (new_base - swap_base) << CLICK_SHIFT);
 	lseek(swap_fd, off, SEEK_SET);
@@ -329,16 +329,22 @@ phys_bytes tot_bytes;		/* total memory to allocate, including gap */
   new_base = alloc_mem(text_clicks + tot_clicks);
   if (new_base == NO_MEM) return(ENOMEM);
 
-  /* We've got memory for the new core image.  Release the old one. */
+  /* We've got memory for the new core image.  Release the old one, or give
+   * it back to the parent if it was borrowed through VFORK.
+   */
   rmp = mp;
 
-  if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
-	/* No other process shares the text segment, so free it. */
-	free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+  if (rmp->mp_flags & VFORKED) {
+	vfork_done(rmp);
+  } else {
+	if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
+		/* No other process shares the text segment, so free it. */
+		free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+	}
+	/* Free the data and stack segments. */
+	free_mem(rmp->mp_seg[D].mem_phys, rmp->mp_seg[S].mem_vir
+		+ rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
   }
-  /* Free the data and stack segments. */
-  free_mem(rmp->mp_seg[D].mem_phys,
-   rmp->mp_seg[S].mem_vir + rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
 
   /* We have now passed the point of no return.  The old core image has been
    * forever lost, memory for a new core image has been allocated.  Set up
@@ -1,13 +1,17 @@
 /* This file deals with creating processes (via FORK) and deleting them (via
  * EXIT/WAIT).  When a process forks, a new slot in the 'mproc' table is
  * allocated for it, and a copy of the parent's core image is made for the
- * child.  Then the kernel and file system are informed.  A process is removed
+ * child.  Then the kernel and file system are informed.  After a VFORK, the
+ * child uses the parent's core image instead, and the parent is suspended
+ * until the child gives the image back by doing an EXEC or EXIT.
+ * A process is removed
  * from the 'mproc' table when two events have occurred: (1) it has exited or
  * been killed by a signal, and (2) the parent has done a WAIT.  If the process
  * exits first, it continues to occupy a slot until the parent does a WAIT.
  *
  * The entry points into this file are:
- *   do_fork:	 perform the FORK system call
+ *   do_fork:	 perform the FORK or VFORK system call
+ *   vfork_done: give a borrowed core image back and wake up the parent
  *   do_pm_exit: perform the EXIT system call (by calling pm_exit())
  *   pm_exit:	 actually do the exiting
  *   do_wait:	 perform the WAITPID or WAIT system call
@@ -33,7 +37,7 @@ PUBLIC int do_fork()
 /* The process pointed to by 'mp' has forked.  Create a child process. */
   register struct mproc *rmp;	/* pointer to parent */
   register struct mproc *rmc;	/* pointer to child */
-  int child_nr, s;
+  int child_nr, s, vfork;
   phys_clicks prog_clicks, child_base;
   phys_bytes prog_bytes, parent_abs, child_abs;	/* Intel only */
   pid_t new_pid;
@@ -49,19 +53,29 @@ PUBLIC int do_fork()
   	return(EAGAIN);
   }
 
-  /* Determine how much memory to allocate.  Only the data and stack need to
-   * be copied, because the text segment is either shared or of zero length.
+  /* A VFORK child borrows the parent's image.  A process that runs on a
+   * borrowed image itself cannot lend it out again, so it gets a real FORK.
    */
-  prog_clicks = (phys_clicks) rmp->mp_seg[S].mem_len;
-  prog_clicks += (rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
-  prog_bytes = (phys_bytes) prog_clicks << CLICK_SHIFT;
-  if ( (child_base = alloc_mem(prog_clicks)) == NO_MEM) return(ENOMEM);
+  vfork = (call_nr == VFORK && !(rmp->mp_flags & VFORKED));
 
-  /* Create a copy of the parent's core image for the child. */
-  child_abs = (phys_bytes) child_base << CLICK_SHIFT;
-  parent_abs = (phys_bytes) rmp->mp_seg[D].mem_phys << CLICK_SHIFT;
-  s = sys_abscopy(parent_abs, child_abs, prog_bytes);
-  if (s < 0) panic(__FILE__,"do_fork can't copy", s);
+  if (vfork) {
+	child_base = rmp->mp_seg[D].mem_phys;
+  } else {
+	/* Determine how much memory to allocate.  Only the data and stack
+	 * need to be copied, because the text segment is either shared or of
+	 * zero length.
+	 */
+	prog_clicks = (phys_clicks) rmp->mp_seg[S].mem_len;
+	prog_clicks += (rmp->mp_seg[S].mem_vir - rmp->mp_seg[D].mem_vir);
+	prog_bytes = (phys_bytes) prog_clicks << CLICK_SHIFT;
+	if ((child_base = alloc_mem(prog_clicks)) == NO_MEM) return(ENOMEM);
+
+	/* Create a copy of the parent's core image for the child. */
+	child_abs = (phys_bytes) child_base << CLICK_SHIFT;
+	parent_abs = (phys_bytes) rmp->mp_seg[D].mem_phys << CLICK_SHIFT;
+	s = sys_abscopy(parent_abs, child_abs, prog_bytes);
+	if (s < 0) panic(__FILE__,"do_fork can't copy", s);
+  }
 
   /* Find a slot in 'mproc' for the child process.  A slot must exist. */
   for (rmc = &mproc[0]; rmc < &mproc[NR_PROCS]; rmc++)
@@ -101,9 +115,36 @@ PUBLIC int do_fork()
   /* Reply to child to wake it up. */
   setreply(child_nr, 0);		/* only parent gets details */
   rmp->mp_reply.procnr = child_nr;	/* child's process number */
+
+  /* The parent of a VFORK child waits until its image is given back. */
+  if (vfork) {
+	rmc->mp_flags |= VFORKED;
+	rmp->mp_flags |= VFORK_WAIT;
+	return(SUSPEND);
+  }
   return(new_pid);		 	/* child's pid */
 }
 
+/*===========================================================================*
+ *				vfork_done				     *
+ *===========================================================================*/
+PUBLIC void vfork_done(rmc)
+register struct mproc *rmc;	/* VFORK child that is done with the image */
+{
+/* A VFORK child has loaded a new core image or is exiting, so the image of
+ * its parent is no longer in use.  Complete the parent's VFORK call.
+ */
+  register struct mproc *rmp = &mproc[rmc->mp_parent];
+
+  rmc->mp_flags &= ~VFORKED;
+  rmp->mp_flags &= ~VFORK_WAIT;
+  rmp->mp_reply.procnr = (int) (rmc - mproc);
+  setreply(rmc->mp_parent, rmc->mp_pid);
+
+  /* Signals caught while the stack was borrowed have been held back. */
+  check_pending(rmp);
+}
+
 /*===========================================================================*
  *				do_pm_exit				     *
  *===========================================================================*/
@@ -130,7 +171,7 @@ int exit_status;		/* the process' exit status (for parent) */
   register int proc_nr;
   int parent_waiting, right_child;
   pid_t pidarg, procgrp;
-  struct mproc *p_mp;
+  struct mproc *p_mp, *rmc;
   clock_t t[5];
 
   proc_nr = (int) (rmp - mproc);	/* get process slot number */
@@ -154,15 +195,28 @@ int exit_status;		/* the process' exit status (for parent) */
   /* Pending reply messages for the dead process cannot be delivered. */
   rmp->mp_flags &= ~REPLY;
   
-  /* Release the memory occupied by the child. */
-  if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
-	/* No other process shares the text segment, so free it. */
-	free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+  /* Release the memory occupied by the child.  An image borrowed through
+   * VFORK goes back to the parent.  If the process is the parent of a VFORK
+   * child, the child takes the image over instead.
+   */
+  if (rmp->mp_flags & VFORKED) {
+	vfork_done(rmp);
+  } else if (rmp->mp_flags & VFORK_WAIT) {
+	for (rmc = &mproc[0]; rmc < &mproc[NR_PROCS]; rmc++) {
+		if ((rmc->mp_flags & (IN_USE | VFORKED)) == (IN_USE | VFORKED)
+				&& rmc->mp_parent == proc_nr)
+			rmc->mp_flags &= ~VFORKED;
+	}
+  } else {
+	if (find_share(rmp, rmp->mp_ino, rmp->mp_dev, rmp->mp_ctime) == NULL) {
+		/* No other process shares the text segment, so free it. */
+		free_mem(rmp->mp_seg[T].mem_phys, rmp->mp_seg[T].mem_len);
+	}
+	/* Free the data and stack segments. */
+	free_mem(rmp->mp_seg[D].mem_phys,
+	    rmp->mp_seg[S].mem_vir 
+	      + rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
   }
-  /* Free the data and stack segments. */
-  free_mem(rmp->mp_seg[D].mem_phys,
-      rmp->mp_seg[S].mem_vir 
-        + rmp->mp_seg[S].mem_len - rmp->mp_seg[D].mem_vir);
 
   /* The process slot can only be freed if the parent has done a WAIT. */
   rmp->mp_exitstatus = (char) exit_status;
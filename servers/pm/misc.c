@@ -62,7 +62,6 @@ PUBLIC int do_getsysinfo()
   size_t len;
   static struct pm_mem_info pmi;
   int s, r;
-  size_t holesize;
 
   switch(m_in.info_what) {
   case SI_KINFO:			/* kernel info is obtained via PM */
@@ -80,9 +79,7 @@ PUBLIC int do_getsysinfo()
         len = sizeof(struct mproc) * NR_PROCS;
         break;
   case SI_MEM_ALLOC:
-  	holesize = sizeof(pmi.pmi_holes);
-	if((r=mem_holes_copy(pmi.pmi_holes, &holesize,
-	   &pmi.pmi_hi_watermark)) != OK)
+	if((r=mem_holes_copy(&pmi)) != OK)
 		return r;
 	src_addr = (vir_bytes) &pmi;
 	len = sizeof(pmi);
@@ -70,6 +70,8 @@ EXTERN struct mproc {
 #define SWAPIN	 	0x800	/* set if on the "swap this in" queue */
 #define DONT_SWAP      0x1000   /* never swap out this process */
 #define PRIV_PROC      0x2000   /* system process, special privileges */
+#define VFORKED        0x4000   /* runs on the parent's image after VFORK */
+#define VFORK_WAIT     0x8000   /* set by VFORK, cleared by child exec/exit */
 
 #define NIL_MPROC ((struct mproc *) 0)
 
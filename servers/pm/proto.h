@@ -20,7 +20,7 @@ _PROTOTYPE( void swap_inqueue, (struct mproc *rmp)			);
 #define swap_in()			((void)0)
 #define swap_inqueue(rmp)		((void)0)
 #endif /* !SWAP */
-_PROTOTYPE(int mem_holes_copy, (struct hole *, size_t *, u32_t *)	);
+_PROTOTYPE(int mem_holes_copy, (struct pm_mem_info *pmi)		);
 
 /* break.c */
 _PROTOTYPE( int adjust, (struct mproc *rmp,
@@ -48,6 +48,7 @@ _PROTOTYPE( int do_fork, (void)						);
 _PROTOTYPE( int do_pm_exit, (void)					);
 _PROTOTYPE( int do_waitpid, (void)					);
 _PROTOTYPE( void pm_exit, (struct mproc *rmp, int exit_status)		);
+_PROTOTYPE( void vfork_done, (struct mproc *rmc)			);
 
 /* getset.c */
 _PROTOTYPE( int do_getset, (void)					);
@@ -416,6 +416,11 @@ int signo;			/* signal to send to process (1 to _NSIG) */
 	return;
   }
 #endif
+  if ((rmp->mp_flags & VFORK_WAIT) && sigismember(&rmp->mp_catch, signo)) {
+	/* A VFORK child runs on this stack, leave signal pending. */
+	sigaddset(&rmp->mp_sigpending, signo);
+	return;
+  }
   sigflags = rmp->mp_sigact[signo].sa_flags;
   if (sigismember(&rmp->mp_catch, signo)) {
 	if (rmp->mp_flags & SIGSUSPENDED)
@@ -0,0 +1,76 @@
+/*
+ * Test name: asynspeed.c
+ *
+ * Objective: Measure the cost of batched asynchronous messages.
+ *
+ * Description: This program posts messages to its own asynchronous message
+ * ring with sys_asynsend() and drains them again with sys_asynrecv(), using
+ * batches of increasing size. For each batch size the number of messages
+ * per second is printed. A batch size of one costs two kernel calls per
+ * message; larger batches amortize them. Only system processes have a 
+ * message ring, so this program must be started as a service:
+ *
+ *	service up /usr/src/test/asynspeed
+ */
+
+#include <lib.h>
+#include <minix/syslib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SECONDS		5	/* duration of each measurement */
+#define MAX_BATCH	16	/* must not exceed the kernel's ring size */
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(unsigned long measure, (int batch));
+
+message vec[MAX_BATCH];
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+	int batch;
+	unsigned long msgs;
+
+	printf("Asynchronous message rate, %d seconds per batch size.\n",
+		SECONDS);
+	for (batch = 1; batch <= MAX_BATCH; batch *= 2) {
+		msgs = measure(batch);
+		printf("batch %2d: %8lu messages per second\n", batch,
+			msgs / SECONDS);
+	}
+	return(0);
+}
+
+unsigned long measure(batch)
+int batch;
+{
+	time_t start_time;
+	unsigned long msgs = 0;
+	int i, r, posted, received;
+
+	for (i = 0; i < batch; i++) vec[i].m_type = i;
+
+	start_time = time(NULL);
+	while (time(NULL) == start_time) ;
+	start_time = time(NULL);
+
+	while (time(NULL) - start_time < SECONDS) {
+		for (i = 0; i < 100; i++) {
+			if ((r = sys_asynsend(SELF, vec, batch, &posted)) != OK ||
+			    (r = sys_asynrecv(vec, batch, &received)) != OK) {
+				fprintf(stderr, "asynspeed: kernel call failed: %d\n", r);
+				exit(1);
+			}
+			if (posted != batch || received != batch) {
+				fprintf(stderr, "asynspeed: posted %d, received %d\n",
+					posted, received);
+				exit(1);
+			}
+			msgs += batch;
+		}
+	}
+	return(msgs);
+}
@@ -0,0 +1,125 @@
+/*
+ * Test name: cksumspeed.c
+ *
+ * Objective: Measure the speed of the Internet checksum routine oneC_sum().
+ *
+ * Description: This program computes the checksum of buffers of the sizes
+ * that inet sees most, an IP header, a small packet, a buffer, a TCP
+ * segment and a large UDP packet, at each of the four alignments with
+ * respect to a 32 bit word. It first checks the result against a simple
+ * implementation of RFC 1071, then calls oneC_sum() for a number of seconds
+ * and prints the throughput. Run it with the old and new library to compare.
+ * It can also be compiled on another system together with lib/ip/oneC_sum.c
+ * if the Minix types are provided.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <net/gen/oneCsum.h>
+
+#define SECONDS		1	/* default duration of each measurement */
+#define MAXSIZE		8192	/* largest buffer */
+#define BATCH		100	/* calls between checks of the clock */
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(u16_t ref_sum, (u8_t *data, size_t size));
+_PROTOTYPE(void measure, (size_t size, int align, int seconds));
+
+size_t sizes[] = { 20, 64, 512, 1460, MAXSIZE };
+u32_t space[(MAXSIZE + 8) / sizeof(u32_t)];
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+	u8_t *data;
+	int seconds = SECONDS;
+	int i, a;
+	size_t s, n;
+	u16_t sum, ref;
+
+	if (argc == 2) seconds = atoi(argv[1]);
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: cksumspeed [seconds]\n");
+		exit(1);
+	}
+
+	srand(1);
+	data = (u8_t *) space;
+	for (n = 0; n < sizeof(space); n++) data[n] = rand() >> 4;
+
+	/* Check all sizes up to 200 and some others at each alignment. */
+	for (a = 0; a < 4; a++) {
+		for (n = 0; n < MAXSIZE; n = n < 200 ? n + 1 : n * 3 / 2) {
+			sum = oneC_sum(0, data + a, n);
+			ref = ref_sum(data + a, n);
+			if (sum != ref) {
+				fprintf(stderr,
+		"cksumspeed: size %u align %d: sum %04x should be %04x\n",
+					(unsigned) n, a, sum, ref);
+				exit(1);
+			}
+		}
+	}
+
+	printf("Checksum throughput in kilobytes per second, %d s each:\n",
+		seconds);
+	printf("%6s %10s %10s %10s %10s\n", "size", "align 0", "align 1",
+		"align 2", "align 3");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		s = sizes[i];
+		printf("%6u", (unsigned) s);
+		for (a = 0; a < 4; a++) measure(s, a, seconds);
+		printf("\n");
+	}
+	return(0);
+}
+
+u16_t ref_sum(data, size)
+u8_t *data;
+size_t size;
+{
+/* Add up 16 bit words, in the byte order of this machine, the way RFC 1071
+ * describes it.
+ */
+	u32_t sum = 0;
+	u16_t word;
+	size_t n;
+
+	for (n = 0; n < size; n += 2) {
+		((u8_t *) &word)[0] = data[n];
+		((u8_t *) &word)[1] = n + 1 < size ? data[n + 1] : 0;
+		sum += word;
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return(sum);
+}
+
+void measure(size, align, seconds)
+size_t size;
+int align;
+int seconds;
+{
+	u8_t *data = (u8_t *) space + align;
+	time_t start_time, end_time;
+	unsigned long calls = 0;
+	u16_t sum = 0;
+	int i;
+
+	/* Wait for the start of a new second to get a sharper measurement. */
+	start_time = time(NULL);
+	while ((end_time = time(NULL)) == start_time) ;
+	start_time = end_time;
+
+	do {
+		for (i = 0; i < BATCH; i++) sum = oneC_sum(sum, data, size);
+		calls += BATCH;
+		end_time = time(NULL);
+	} while (end_time - start_time < seconds);
+
+	printf(" %10lu", (unsigned long) (calls * (double) size / 1024
+		/ (end_time - start_time)));
+	fflush(stdout);
+}
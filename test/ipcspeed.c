@@ -0,0 +1,63 @@
+/*
+ * Test name: ipcspeed.c
+ *
+ * Objective: Measure the round trip time of the message passing primitives.
+ *
+ * Description: This program does null SENDREC round trips to the process
+ * manager, which answers GETPID requests without any further work. The
+ * requests are done for a number of seconds and the number of round trips 
+ * per second is printed. Run it on the old and new kernel to compare.
+ */
+
+#include <lib.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SECONDS	10		/* default duration of the measurement */
+#define BATCH	1000		/* round trips between checks of the clock */
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+	message m;
+	time_t start_time, end_time;
+	unsigned long trips = 0;
+	int seconds = SECONDS;
+	int i;
+
+	if (argc == 2) seconds = atoi(argv[1]);
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: ipcspeed [seconds]\n");
+		exit(1);
+	}
+
+	printf("Doing null SENDREC round trips to PM for %d seconds.\n",
+		seconds);
+
+	/* Wait for the start of a new second to get a sharper measurement. */
+	start_time = time(NULL);
+	while ((end_time = time(NULL)) == start_time) ;
+	start_time = end_time;
+
+	do {
+		for (i = 0; i < BATCH; i++) {
+			if (_syscall(MM, GETPID, &m) < 0) {
+				fprintf(stderr, "ipcspeed: sendrec failed\n");
+				exit(1);
+			}
+		}
+		trips += BATCH;
+		end_time = time(NULL);
+	} while (end_time - start_time < seconds);
+
+	printf("%lu round trips in %ld seconds: %lu round trips per second\n",
+		trips, (long) (end_time - start_time),
+		trips / (unsigned long) (end_time - start_time));
+	return(0);
+}
@@ -0,0 +1,553 @@
+/*
+ * Test name: rwscatter.c
+ *
+ * Objective: Test the way the file system cache transfers runs of blocks
+ * with rw_scattered(), and the write behind that is built on it.
+ *
+ * Description: This program includes servers/fs/cache.c and replaces
+ * dev_io() by a mock device that keeps its blocks in memory. The mock checks
+ * every I/O vector it is given: each element must hold whole blocks, each
+ * block must land in the buffer that holds it in the cache, and only gaps in
+ * a read may go to a scratch block. It can cut a transfer short after a
+ * number of blocks, leaving the bytes it did not transfer in the elements as
+ * a driver does. The subtests cover the sort order, the merging of buffers
+ * that are next to each other in memory, gaps of RW_GAP_BLOCKS blocks and
+ * one more, gaps in a write with a missing or busy block, partial transfers,
+ * and a device that takes nothing. The file system is not touched, so this
+ * can also be compiled on another system with the Minix headers:
+ *
+ *	cc -nostdinc -I../include -D_EM_WSIZE=4 -D_EM_PSIZE=4 rwscatter.c
+ */
+
+#define _TABLE			/* the globals of the cache live here */
+#include "../servers/fs/cache.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEV		0x0301	/* the mock device */
+#define BLOCK		1024	/* block size of the mock device */
+#define NBUFS		64	/* buffers in the cache */
+#define DISK_BLOCKS	256	/* blocks on the mock device */
+#define MAX_CALLS	64	/* transfers remembered */
+#define MAX_ERROR	4
+
+_PROTOTYPE(void reset, (void));
+_PROTOTYPE(struct buf *dirty, (block_t b));
+_PROTOTYPE(struct buf *cached, (block_t b));
+_PROTOTYPE(void fill, (struct buf *bp, block_t b));
+_PROTOTYPE(int on_disk, (block_t b));
+_PROTOTYPE(void test_sort, (void));
+_PROTOTYPE(void test_merge, (void));
+_PROTOTYPE(void test_wgap, (void));
+_PROTOTYPE(void test_rgap, (void));
+_PROTOTYPE(void test_partial, (void));
+_PROTOTYPE(void test_stuck, (void));
+_PROTOTYPE(void e, (int n));
+
+int errct = 0;
+int subtest;
+
+struct buf bufs[NBUFS];
+struct buf *hash[NBUFS];
+struct buf *queue[NBUFS];
+char data[NBUFS * BLOCK];
+char disk[DISK_BLOCKS][BLOCK];
+char written[DISK_BLOCKS];	/* blocks the mock has written */
+
+int limit;			/* blocks per transfer, or -1 for all */
+int calls;			/* transfers since reset() */
+block_t call_block[MAX_CALLS];	/* first block of each transfer */
+int call_blocks[MAX_CALLS];	/* blocks asked for in each transfer */
+int call_elems[MAX_CALLS];	/* vector elements in each transfer */
+int timer_sets;			/* fs_set_timer() calls */
+
+int main()
+{
+	printf("Test rwscatter ");
+
+	buf = bufs;
+	max_bufs = NBUFS;
+	buf_hash = hash;
+	nr_buf_hash = NBUFS;
+	dirty_q = queue;
+	buf_data = data;
+	buf_bytes = sizeof(data);
+
+	test_sort();
+	test_merge();
+	test_wgap();
+	test_rgap();
+	test_partial();
+	test_stuck();
+
+	if (errct == 0) {
+		printf("ok\n");
+		return(0);
+	}
+	printf("%d errors\n", errct);
+	return(1);
+}
+
+void reset()
+{
+/* Empty the cache and the record of transfers.  The next get_block() calls
+ * take bufs[0], bufs[1], and so on, so a test knows which buffers are next to
+ * each other in memory.
+ */
+	int i, b;
+
+	for (i = 0; i < nr_bufs; i++) {
+		if (bufs[i].b_count != 0) e(900);
+		bufs[i].b_dirt = CLEAN;
+	}
+	buf_size = 0;
+	if (set_blocksize(BLOCK) != OK || nr_bufs != NBUFS) e(901);
+	for (b = 0; b < DISK_BLOCKS; b++) {
+		memset(disk[b], 0, BLOCK);
+		disk[b][0] = 'D';
+		disk[b][1] = b;
+		written[b] = 0;
+	}
+	limit = -1;
+	calls = 0;
+}
+
+struct buf *dirty(b)
+block_t b;
+{
+/* Put block b in the cache with new contents and release it dirty. */
+	struct buf *bp;
+
+	bp = get_block(DEV, b, NO_READ);
+	fill(bp, b);
+	bp->b_dirt = DIRTY;
+	put_block(bp, FULL_DATA_BLOCK);
+	return(bp);
+}
+
+struct buf *cached(b)
+block_t b;
+{
+/* Put block b in the cache, clean, with the contents it has on disk. */
+	struct buf *bp;
+
+	bp = get_block(DEV, b, NO_READ);
+	memcpy(bp->b_data, disk[b], BLOCK);
+	put_block(bp, FULL_DATA_BLOCK);
+	return(bp);
+}
+
+void fill(bp, b)
+struct buf *bp;
+block_t b;
+{
+	memset(bp->b_data, 0, BLOCK);
+	bp->b_data[0] = 'B';
+	bp->b_data[1] = b;
+	bp->b_data[BLOCK - 1] = b;
+}
+
+int on_disk(b)
+block_t b;
+{
+/* Tell if block b on disk has the contents fill() gave it. */
+	return(disk[b][0] == 'B' && disk[b][1] == (char) b
+					&& disk[b][BLOCK - 1] == (char) b);
+}
+
+/*===========================================================================*
+ *				the mock device				     *
+ *===========================================================================*/
+int dev_io(op, dev, proc, buffer, pos, bytes, flags)
+int op;
+Dev_t dev;
+int proc;
+void *buffer;
+off_t pos;
+int bytes;
+int flags;
+{
+	iovec_t *iop;
+	vir_bytes addr, off, size;
+	block_t b;
+	int i, k, left;
+	char *p;
+
+	if (op != DEV_GATHER && op != DEV_SCATTER) e(800);
+	if (dev != DEV || proc != FS_PROC_NR) e(801);
+	if (pos % BLOCK != 0 || bytes <= 0 || bytes > NR_IOREQS) e(802);
+	b = pos / BLOCK;
+	if (calls < MAX_CALLS) {
+		call_block[calls] = b;
+		call_blocks[calls] = 0;
+		call_elems[calls] = bytes;
+	}
+	left = limit;
+
+	for (iop = buffer, i = 0; i < bytes; i++, iop++) {
+		size = iop->iov_size;
+		if (size == 0 || size % BLOCK != 0) e(803);
+		for (k = 0; k < size / BLOCK; k++, b++) {
+			if (b >= DISK_BLOCKS) { e(804); return(OK); }
+			if (calls < MAX_CALLS) call_blocks[calls]++;
+
+			/* Find the buffer of this part of the element. */
+			addr = iop->iov_addr + k * BLOCK;
+			off = addr - (vir_bytes) buf_data;
+			if (off < buf_bytes) {
+				if (off % BLOCK != 0) e(805);
+				if (buf[off / BLOCK].b_blocknr != b) e(806);
+				if (op == DEV_SCATTER
+					&& buf[off / BLOCK].b_dev != DEV) e(807);
+				p = buf_data + off;
+			} else {
+				/* The scratch block of a gap in a read. */
+				if (op != DEV_GATHER || size != BLOCK) e(808);
+				p = NULL;
+			}
+
+			if (left == 0) continue;
+			if (op == DEV_SCATTER) {
+				memcpy(disk[b], p, BLOCK);
+				written[b] = 1;
+			} else if (p != NULL) {
+				memcpy(p, disk[b], BLOCK);
+			}
+			iop->iov_size -= BLOCK;
+			if (left > 0) left--;
+		}
+	}
+	calls++;
+	return(OK);
+}
+
+/*===========================================================================*
+ *				the subtests				     *
+ *===========================================================================*/
+void test_sort()
+{
+/* Blocks too far apart to be joined are written one by one, in order. */
+	int i, n;
+	block_t b;
+
+	subtest = 1;
+	reset();
+	n = 32;
+	for (i = 0; i < n; i++) {
+		b = 10 + 6 * ((i * 13) % n);	/* gaps of 5 blocks */
+		queue[i] = dirty(b);
+	}
+	rw_scattered(DEV, queue, n, WRITING);
+	if (calls != n) e(1);
+	for (i = 0; i < n && i < calls; i++) {
+		if (call_block[i] != 10 + 6 * i) e(2);
+		if (call_blocks[i] != 1 || call_elems[i] != 1) e(3);
+		if (!on_disk(10 + 6 * i)) e(4);
+	}
+	if (nr_dirty != 0) e(5);
+	for (i = 0; i < n; i++) if (bufs[i].b_dirt != CLEAN) e(6);
+}
+
+void test_merge()
+{
+	int i;
+
+	/* Consecutive blocks in consecutive buffers form one element. */
+	subtest = 2;
+	reset();
+	for (i = 0; i < 8; i++) queue[i] = dirty(20 + i);
+	rw_scattered(DEV, queue, 8, WRITING);
+	if (calls != 1 || call_block[0] != 20) e(1);
+	if (call_blocks[0] != 8 || call_elems[0] != 1) e(2);
+	for (i = 0; i < 8; i++) if (!on_disk(20 + i)) e(3);
+
+	/* Out of order in memory: 12 10 11 14 13 in bufs 0-4.  Sorted, only
+	 * 10 and 11 are next to each other in memory.
+	 */
+	subtest = 3;
+	reset();
+	queue[0] = dirty(12);
+	queue[1] = dirty(10);
+	queue[2] = dirty(11);
+	queue[3] = dirty(14);
+	queue[4] = dirty(13);
+	rw_scattered(DEV, queue, 5, WRITING);
+	if (calls != 1 || call_block[0] != 10) e(1);
+	if (call_blocks[0] != 5 || call_elems[0] != 4) e(2);
+	for (i = 10; i <= 14; i++) if (!on_disk(i)) e(3);
+	if (nr_dirty != 0) e(4);
+}
+
+void test_wgap()
+{
+	struct buf *bp;
+	int i;
+
+	/* A gap of RW_GAP_BLOCKS cached blocks is written along. */
+	subtest = 4;
+	reset();
+	queue[0] = dirty(30);
+	for (i = 1; i <= RW_GAP_BLOCKS; i++) cached(30 + i);
+	queue[1] = dirty(30 + RW_GAP_BLOCKS + 1);
+	rw_scattered(DEV, queue, 2, WRITING);
+	if (calls != 1 || call_blocks[0] != RW_GAP_BLOCKS + 2) e(1);
+	if (call_elems[0] != 1) e(2);
+	if (!on_disk(30) || !on_disk(30 + RW_GAP_BLOCKS + 1)) e(3);
+	for (i = 1; i <= RW_GAP_BLOCKS; i++) {
+		if (!written[30 + i]) e(4);
+		if (disk[30 + i][0] != 'D' || disk[30 + i][1] != 30 + i) e(5);
+	}
+
+	/* One more block of gap is not. */
+	subtest = 5;
+	reset();
+	queue[0] = dirty(40);
+	for (i = 1; i <= RW_GAP_BLOCKS + 1; i++) cached(40 + i);
+	queue[1] = dirty(40 + RW_GAP_BLOCKS + 2);
+	rw_scattered(DEV, queue, 2, WRITING);
+	if (calls != 2) e(1);
+	if (call_blocks[0] != 1 || call_blocks[1] != 1) e(2);
+	for (i = 1; i <= RW_GAP_BLOCKS + 1; i++) if (written[40 + i]) e(3);
+
+	/* A gap with a block that is not in the cache is not bridged. */
+	subtest = 6;
+	reset();
+	queue[0] = dirty(50);
+	cached(51);
+	cached(53);
+	queue[1] = dirty(54);
+	rw_scattered(DEV, queue, 2, WRITING);
+	if (calls != 2 || call_block[1] != 54) e(1);
+	if (written[51] || written[52] || written[53]) e(2);
+	if (!on_disk(50) || !on_disk(54)) e(3);
+
+	/* Nor is a gap with a block that is in use. */
+	subtest = 7;
+	reset();
+	queue[0] = dirty(60);
+	cached(61);
+	cached(62);
+	cached(63);
+	queue[1] = dirty(64);
+	bp = get_block(DEV, 62, NORMAL);
+	rw_scattered(DEV, queue, 2, WRITING);
+	if (calls != 2 || call_block[1] != 64) e(1);
+	if (written[61] || written[62] || written[63]) e(2);
+	put_block(bp, FULL_DATA_BLOCK);
+}
+
+void test_rgap()
+{
+	int i;
+
+	/* A gap of RW_GAP_BLOCKS is read into the scratch block, one element
+	 * per block, and the blocks around it are read into their buffers.
+	 */
+	subtest = 8;
+	reset();
+	queue[0] = get_block(DEV, 70, PREFETCH);
+	queue[1] = get_block(DEV, 70 + RW_GAP_BLOCKS + 1, PREFETCH);
+	rw_scattered(DEV, queue, 2, READING);
+	if (calls != 1 || call_block[0] != 70) e(1);
+	if (call_blocks[0] != RW_GAP_BLOCKS + 2) e(2);
+	if (call_elems[0] != RW_GAP_BLOCKS + 2) e(3);
+	if (!in_cache(DEV, 70) || !in_cache(DEV, 70 + RW_GAP_BLOCKS + 1)) e(4);
+	for (i = 1; i <= RW_GAP_BLOCKS; i++) if (in_cache(DEV, 70 + i)) e(5);
+	if (bufs[0].b_data[1] != 70) e(6);
+	if (bufs[1].b_data[1] != 70 + RW_GAP_BLOCKS + 1) e(7);
+	if (bufs_in_use != 0) e(8);
+
+	/* One more block of gap ends the transfer.  A read does only one, and
+	 * releases the buffers it did not get to unread.
+	 */
+	subtest = 9;
+	reset();
+	queue[0] = get_block(DEV, 80, PREFETCH);
+	queue[1] = get_block(DEV, 80 + RW_GAP_BLOCKS + 2, PREFETCH);
+	rw_scattered(DEV, queue, 2, READING);
+	if (calls != 1 || call_blocks[0] != 1) e(1);
+	if (!in_cache(DEV, 80)) e(2);
+	if (in_cache(DEV, 80 + RW_GAP_BLOCKS + 2)) e(3);
+	if (bufs_in_use != 0) e(4);
+}
+
+void test_partial()
+{
+	int i;
+
+	/* A write that is cut short in the middle of an element is carried
+	 * on from where the device stopped.
+	 */
+	subtest = 10;
+	reset();
+	for (i = 0; i < 8; i++) queue[i] = dirty(90 + i);
+	limit = 3;
+	rw_scattered(DEV, queue, 8, WRITING);
+	if (calls != 3) e(1);
+	if (call_block[0] != 90 || call_block[1] != 93 || call_block[2] != 96)
+		e(2);
+	if (call_blocks[1] != 5 || call_blocks[2] != 2) e(3);
+	for (i = 0; i < 8; i++) {
+		if (!on_disk(90 + i)) e(4);
+		if (bufs[i].b_dirt != CLEAN) e(5);
+	}
+	if (nr_dirty != 0) e(6);
+
+	/* A read that is cut short validates only the blocks it read. */
+	subtest = 11;
+	reset();
+	for (i = 0; i < 5; i++) queue[i] = get_block(DEV, 100 + i, PREFETCH);
+	limit = 2;
+	rw_scattered(DEV, queue, 5, READING);
+	if (calls != 1) e(1);
+	if (!in_cache(DEV, 100) || !in_cache(DEV, 101)) e(2);
+	for (i = 2; i < 5; i++) if (in_cache(DEV, 100 + i)) e(3);
+	if (bufs[1].b_data[1] != 101) e(4);
+	if (bufs_in_use != 0) e(5);
+
+	/* A write that the device does not take at all is given up after one
+	 * transfer, and the blocks stay dirty.
+	 */
+	subtest = 12;
+	reset();
+	for (i = 0; i < 4; i++) queue[i] = dirty(110 + i);
+	limit = 0;
+	rw_scattered(DEV, queue, 4, WRITING);
+	if (calls != 1) e(1);
+	for (i = 0; i < 4; i++) if (bufs[i].b_dirt != DIRTY) e(2);
+	if (nr_dirty != 4) e(3);
+	for (i = 0; i < 4; i++) wb_clean(&bufs[i]);
+}
+
+void test_stuck()
+{
+/* Write behind on a device that takes nothing makes one transfer per pass,
+ * skips the rest of the period, and lets the timer lapse.  Once the device
+ * works again the blocks are written.
+ */
+	int i, n;
+	long clock;
+
+	subtest = 13;
+	reset();
+	n = WB_HIGH_WATER + 8;
+	for (i = 0; i < n; i++) dirty(120 + i);
+	if (nr_dirty != n) e(1);
+	limit = 0;
+	write_behind();
+	if (calls != 1) e(2);
+	write_behind();
+	if (calls != 1) e(3);
+
+	subtest = 14;
+	clock = wb_clock;
+	for (i = 0; i < WB_AGE + 2 && wb_armed; i++) wb_timeout(&wb_timer);
+	if (wb_armed) e(1);
+	if (calls != 2) e(2);
+	if (wb_clock - clock != WB_AGE + 1) e(3);
+	if (nr_dirty != n) e(4);
+
+	subtest = 15;
+	limit = -1;
+	timer_sets = 0;
+	dirty(120 + n);
+	if (!wb_armed || timer_sets != 1) e(1);
+	for (i = 0; i < 2 * WB_AGE + 2 && nr_dirty > 0; i++)
+		wb_timeout(&wb_timer);
+	if (nr_dirty != 0) e(2);
+	for (i = 0; i <= n; i++) if (!on_disk(120 + i)) e(3);
+	for (i = 0; i < WB_AGE + 2 && wb_armed; i++) wb_timeout(&wb_timer);
+	if (wb_armed) e(4);
+}
+
+void e(n)
+int n;
+{
+	printf("Subtest %d, error %d\n", subtest, n);
+	if (errct++ > MAX_ERROR) {
+		printf("Too many errors; test aborted\n");
+		exit(1);
+	}
+}
+
+/*===========================================================================*
+ *			the rest of the file system			     *
+ *===========================================================================*/
+int get_block_size(dev_t dev)
+{
+	return(BLOCK);
+}
+
+int get_block2(bp, only_search)
+struct buf *bp;
+int only_search;
+{
+	return(0);
+}
+
+void put_block2(bp)
+struct buf *bp;
+{
+}
+
+void invalidate2(device)
+Dev_t device;
+{
+}
+
+struct super_block *get_super(dev)
+Dev_t dev;
+{
+	e(990);
+	exit(1);
+}
+
+bit_t alloc_bit(sp, map, origin)
+struct super_block *sp;
+int map;
+bit_t origin;
+{
+	e(991);
+	exit(1);
+}
+
+void free_bit(sp, map, bit_returned)
+struct super_block *sp;
+int map;
+bit_t bit_returned;
+{
+	e(992);
+	exit(1);
+}
+
+void count_in(histogram, buckets, value)
+u32_t *histogram;
+int buckets;
+u32_t value;
+{
+}
+
+void fs_init_timer(tp)
+timer_t *tp;
+{
+}
+
+void fs_set_timer(tp, delta, watchdog, arg)
+timer_t *tp;
+int delta;
+tmr_func_t watchdog;
+int arg;
+{
+	timer_sets++;
+}
+
+void panic(who, mess, num)
+char *who;
+char *mess;
+int num;
+{
+	printf("panic: %s: %s %d\n", who, mess, num);
+	exit(1);
+}
@@ -0,0 +1,129 @@
+/*
+ * Test name: statspeed.c
+ *
+ * Objective: Measure the cost of path name look ups in the file system.
+ *
+ * Description: This program builds a chain of nested directories, each of
+ * which also holds a number of other entries, so that every component has to
+ * be searched for. It then does stat() on the deepest directory, and on a
+ * name that does not exist in it, for a number of seconds each and prints
+ * the number of calls per second. Run it on the old and new file system to
+ * compare. The directories are removed again afterwards.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SECONDS		5	/* default duration of each measurement */
+#define DEPTH		12	/* number of nested directories */
+#define FILLER		40	/* other entries in each directory */
+#define BATCH		100	/* calls between checks of the clock */
+#define TOP		"DIR_STATSPEED"
+
+_PROTOTYPE(int main, (int argc, char *argv[]));
+_PROTOTYPE(void build, (int remove));
+_PROTOTYPE(void measure, (char *what, char *path, int seconds));
+
+char path[DEPTH * 16 + 64];
+
+int main(argc, argv)
+int argc;
+char *argv[];
+{
+	char missing[sizeof(path)];
+	int seconds = SECONDS;
+
+	if (argc == 2) seconds = atoi(argv[1]);
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: statspeed [seconds]\n");
+		exit(1);
+	}
+
+	build(0);
+	printf("Doing stat() on a path of %d components for %d seconds.\n",
+		DEPTH + 1, seconds);
+	measure("existing", path, seconds);
+	sprintf(missing, "%s/nonexistent", path);
+	measure("missing", missing, seconds);
+	build(1);
+	return(0);
+}
+
+void build(remove)
+int remove;
+{
+/* Create the directories and the filler entries, or remove them again. The
+ * deepest path ends up in 'path'.
+ */
+	char name[sizeof(path) + 16];
+	int d, f;
+	size_t len;
+
+	strcpy(path, TOP);
+	for (d = 0; d < DEPTH; d++) {
+		if (!remove && mkdir(path, 0755) < 0) {
+			perror(path);
+			exit(1);
+		}
+		for (f = 0; f < FILLER; f++) {
+			sprintf(name, "%s/filler%02d", path, f);
+			if (remove) {
+				(void) rmdir(name);
+			} else if (mkdir(name, 0755) < 0) {
+				perror(name);
+				exit(1);
+			}
+		}
+		sprintf(path + strlen(path), "/level%02d", d);
+	}
+	if (!remove && mkdir(path, 0755) < 0) {
+		perror(path);
+		exit(1);
+	}
+	if (!remove) return;
+
+	/* Remove the chain from the deepest directory up. */
+	while ((len = strlen(path)) > 0) {
+		(void) rmdir(path);
+		while (len > 0 && path[len - 1] != '/') len--;
+		path[len > 0 ? len - 1 : 0] = '\0';
+	}
+}
+
+void measure(what, name, seconds)
+char *what;
+char *name;
+int seconds;
+{
+	struct stat st;
+	time_t start_time, end_time;
+	unsigned long calls = 0;
+	int i, expect;
+
+	expect = stat(name, &st);
+
+	/* Wait for the start of a new second to get a sharper measurement. */
+	start_time = time(NULL);
+	while ((end_time = time(NULL)) == start_time) ;
+	start_time = end_time;
+
+	do {
+		for (i = 0; i < BATCH; i++) {
+			if (stat(name, &st) != expect) {
+				fprintf(stderr, "statspeed: stat changed\n");
+				exit(1);
+			}
+		}
+		calls += BATCH;
+		end_time = time(NULL);
+	} while (end_time - start_time < seconds);
+
+	printf("%-8s %lu calls in %ld seconds: %lu calls per second\n", what,
+		calls, (long) (end_time - start_time),
+		calls / (unsigned long) (end_time - start_time));
+}